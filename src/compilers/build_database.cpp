@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#include "build_database.h"
+#include "filesystem.h"
+#include "array.h"
+#include "hash.h"
+#include "murmur.h"
+#include "log.h"
+#include <string.h> // strlen
+
+namespace crown
+{
+
+static const uint32_t INVALID = 0xffffffffu;
+
+BuildDatabase::BuildDatabase()
+	: _records(default_allocator())
+	, _inputs(default_allocator())
+	, _names(default_allocator())
+	, _kept(default_allocator())
+	, _lookup(default_allocator())
+{
+}
+
+void BuildDatabase::load(Filesystem& fs, const char* path)
+{
+	array::clear(_records);
+	array::clear(_inputs);
+	array::clear(_names);
+	array::clear(_kept);
+	hash::clear(_lookup);
+
+	if (!fs.exists(path))
+		return;
+
+	File* file = fs.open(path, FOM_READ);
+
+	BuildDatabaseHeader header;
+	header.magic = 0;
+	if (file->size() >= sizeof(header))
+		file->read(&header, sizeof(header));
+
+	const bool ok = header.magic == BUILD_DATABASE_MAGIC
+		&& header.version == BUILD_DATABASE_VERSION
+		&& file->size() == sizeof(header)
+			+ header.num_records * sizeof(BuildRecord)
+			+ header.num_inputs * sizeof(BuildInput)
+			+ header.names_size;
+
+	if (!ok)
+	{
+		CE_LOGI("Ignoring out of date build database: %s", path);
+		fs.close(file);
+		return;
+	}
+
+	array::resize(_records, header.num_records);
+	array::resize(_inputs, header.num_inputs);
+	array::resize(_names, header.names_size);
+	if (header.num_records)
+		file->read(array::begin(_records), header.num_records * sizeof(BuildRecord));
+	if (header.num_inputs)
+		file->read(array::begin(_inputs), header.num_inputs * sizeof(BuildInput));
+	if (header.names_size)
+		file->read(array::begin(_names), header.names_size);
+	fs.close(file);
+
+	for (uint32_t i = 0; i < header.num_records; i++)
+	{
+		array::push_back(_kept, false);
+		hash::set(_lookup, record_key(_records[i].type, _records[i].name), i);
+	}
+}
+
+void BuildDatabase::save(Filesystem& fs, const char* path)
+{
+	// Leave out the records which have not been kept and the
+	// inputs left behind by set()
+	Array<BuildRecord> records(default_allocator());
+	Array<BuildInput> inputs(default_allocator());
+	Array<char> names(default_allocator());
+
+	for (uint32_t i = 0; i < array::size(_records); i++)
+	{
+		if (!_kept[i])
+			continue;
+
+		BuildRecord rec = _records[i];
+		rec.first_input = array::size(inputs);
+
+		for (uint32_t j = 0; j < rec.num_inputs; j++)
+		{
+			BuildInput in = _inputs[_records[i].first_input + j];
+			const char* in_path = input_path(in);
+			in.path = array::size(names);
+			array::push(names, in_path, strlen(in_path) + 1);
+			array::push_back(inputs, in);
+		}
+
+		array::push_back(records, rec);
+	}
+
+	BuildDatabaseHeader header;
+	header.magic = BUILD_DATABASE_MAGIC;
+	header.version = BUILD_DATABASE_VERSION;
+	header.num_records = array::size(records);
+	header.num_inputs = array::size(inputs);
+	header.names_size = array::size(names);
+	header.pad = 0;
+
+	File* file = fs.open(path, FOM_WRITE);
+	file->write(&header, sizeof(header));
+	if (header.num_records)
+		file->write(array::begin(records), header.num_records * sizeof(BuildRecord));
+	if (header.num_inputs)
+		file->write(array::begin(inputs), header.num_inputs * sizeof(BuildInput));
+	if (header.names_size)
+		file->write(array::begin(names), header.names_size);
+	fs.close(file);
+}
+
+BuildRecord* BuildDatabase::find(StringId64 type, StringId64 name)
+{
+	const uint32_t i = hash::get(_lookup, record_key(type, name), INVALID);
+	return i != INVALID ? &_records[i] : NULL;
+}
+
+BuildInput& BuildDatabase::input(const BuildRecord& record, uint32_t i)
+{
+	CE_ASSERT(i < record.num_inputs, "Index out of bounds");
+	return _inputs[record.first_input + i];
+}
+
+const char* BuildDatabase::input_path(const BuildInput& input) const
+{
+	return &_names[input.path];
+}
+
+void BuildDatabase::keep(StringId64 type, StringId64 name)
+{
+	const uint32_t i = hash::get(_lookup, record_key(type, name), INVALID);
+	if (i != INVALID)
+		_kept[i] = true;
+}
+
+void BuildDatabase::set(StringId64 type, StringId64 name, uint32_t version, uint32_t platform
+	, const Array<BuildInput>& inputs, const Array<char>& names)
+{
+	BuildRecord rec;
+	rec.type = type;
+	rec.name = name;
+	rec.version = version;
+	rec.platform = platform;
+	rec.first_input = array::size(_inputs);
+	rec.num_inputs = array::size(inputs);
+
+	const uint32_t names_offset = array::size(_names);
+	array::push(_names, array::begin(names), array::size(names));
+
+	for (uint32_t i = 0; i < array::size(inputs); i++)
+	{
+		BuildInput in = inputs[i];
+		in.path += names_offset;
+		array::push_back(_inputs, in);
+	}
+
+	const uint64_t key = record_key(type, name);
+	const uint32_t i = hash::get(_lookup, key, INVALID);
+	if (i != INVALID)
+	{
+		_records[i] = rec;
+		_kept[i] = true;
+		return;
+	}
+
+	hash::set(_lookup, key, array::size(_records));
+	array::push_back(_records, rec);
+	array::push_back(_kept, true);
+}
+
+uint64_t BuildDatabase::record_key(StringId64 type, StringId64 name)
+{
+	const uint64_t id = name.id();
+	return murmur64(&id, sizeof(id), type.id());
+}
+
+} // namespace crown
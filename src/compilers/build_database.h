@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "types.h"
+#include "container_types.h"
+#include "filesystem_types.h"
+
+#define BUILD_DATABASE_MAGIC   uint32_t(0x42444543) // "CEDB"
+#define BUILD_DATABASE_VERSION uint32_t(1)
+
+/// Bytes of a file hashed by a BuildInput::HEADER input,
+/// enough for the headers of the supported image formats.
+#define BUILD_INPUT_HEADER_SIZE 128
+
+namespace crown
+{
+
+/// A file read while compiling a resource.
+struct BuildInput
+{
+	enum
+	{
+		BUNDLE    = 1 << 0, // The file lives in the bundle directory
+		EXISTENCE = 1 << 1, // Only whether the file exists matters
+		HEADER    = 1 << 2  // Only the first BUILD_INPUT_HEADER_SIZE bytes matter
+	};
+
+	uint32_t path;  // Offset of the path in the names
+	uint32_t flags;
+	uint64_t mtime; // Zero when it can not be trusted
+	uint64_t hash;  // Content hash, or whether the file exists if EXISTENCE
+};
+
+/// What a resource has been compiled from.
+struct BuildRecord
+{
+	StringId64 type;
+	StringId64 name;
+	uint32_t version;
+	uint32_t platform;
+	uint32_t first_input;
+	uint32_t num_inputs;
+};
+
+/// Header of the build database file.
+/// It is followed by BuildDatabaseHeader::num_records BuildRecord,
+/// BuildDatabaseHeader::num_inputs BuildInput and the null-terminated
+/// paths of the inputs.
+struct BuildDatabaseHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t num_records;
+	uint32_t num_inputs;
+	uint32_t names_size;
+	uint32_t pad;
+};
+
+/// Remembers the inputs, compiler version and platform of every compiled
+/// resource so that the resources whose inputs did not change can be skipped.
+class BuildDatabase
+{
+public:
+
+	BuildDatabase();
+
+	/// Reads the database at @a path from @a fs.
+	/// The database is left empty if the file is missing or out of date.
+	void load(Filesystem& fs, const char* path);
+
+	/// Writes the records which have been kept or set since load() to @a path.
+	void save(Filesystem& fs, const char* path);
+
+	/// Returns the record of the resource (@a type, @a name) or NULL.
+	BuildRecord* find(StringId64 type, StringId64 name);
+
+	/// Returns the @a i-th input of @a record.
+	BuildInput& input(const BuildRecord& record, uint32_t i);
+
+	/// Returns the path of the @a input.
+	const char* input_path(const BuildInput& input) const;
+
+	/// Marks the record of the resource (@a type, @a name) to be saved.
+	void keep(StringId64 type, StringId64 name);
+
+	/// Replaces the record of the resource (@a type, @a name).
+	/// The paths of the @a inputs are offsets in @a names.
+	void set(StringId64 type, StringId64 name, uint32_t version, uint32_t platform
+		, const Array<BuildInput>& inputs, const Array<char>& names);
+
+private:
+
+	static uint64_t record_key(StringId64 type, StringId64 name);
+
+private:
+
+	Array<BuildRecord> _records;
+	Array<BuildInput> _inputs;
+	Array<char> _names;
+	Array<bool> _kept;
+	Hash<uint32_t> _lookup;
+};
+
+} // namespace crown
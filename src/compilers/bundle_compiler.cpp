@@ -15,6 +15,15 @@
 #include "compile_options.h"
 #include "resource_registry.h"
 #include "temp_allocator.h"
+#include "bundle_filesystem.h"
+#include "array.h"
+#include "compressed_file.h"
+#include "murmur.h"
+#include "tracking_allocator.h"
+#include "memory.h"
+#include <setjmp.h>
+#include <string.h>
+#include <algorithm>
 
 namespace crown
 {
@@ -22,83 +31,359 @@ namespace crown
 BundleCompiler::BundleCompiler(const char* source_dir, const char* bundle_dir)
 	: _source_fs(source_dir)
 	, _bundle_fs(bundle_dir)
+	, _build_time(0)
+	, _files(NULL)
+	, _platform(Platform::COUNT)
+	, _jobs(default_allocator())
+	, _next_job(0)
+	, _errors(default_allocator())
 {
 	DiskFilesystem temp;
 	temp.create_directory(bundle_dir);
 }
 
-bool BundleCompiler::compile(const char* type, const char* name, Platform::Enum platform)
+void BundleCompiler::commit(const char* src_path, const char* path, CompileOptions& opts)
 {
-	StringId64 _type(type);
-	StringId64 _name(name);
+	const StringId64 _type = opts._type;
+	const StringId64 _name = opts._name;
 
-	TempAllocator512 alloc;
-	DynamicString path(alloc);
-	TempAllocator512 alloc2;
-	DynamicString src_path(alloc2);
+	// Some compilers hand the source to external tools
+	opts.add_input(src_path);
 
-	src_path += name;
-	src_path += ".";
-	src_path += type;
+	write_dependencies(_type, _name, opts._dependencies);
+
+	// Resources used in place must stay uncompressed
+	if (!resource_in_place(_type))
+		compress(path);
+
+	for (uint32_t i = 0; i < array::size(opts._inputs); i++)
+	{
+		BuildInput& in = opts._inputs[i];
+		if (in.flags & BuildInput::EXISTENCE)
+			continue;
+
+		DiskFilesystem& fs = (in.flags & BuildInput::BUNDLE) ? _bundle_fs : _source_fs;
+		in.mtime = trusted_mtime(fs, &opts._input_names[in.path]);
+	}
+
+	ScopedMutex sm(_mutex);
+	_database.set(_type, _name, resource_version(_type), opts._platform, opts._inputs, opts._input_names);
+}
+
+bool BundleCompiler::up_to_date(StringId64 type, StringId64 name, Platform::Enum platform)
+{
+	const BuildRecord* rec = _database.find(type, name);
+	if (rec == NULL || rec->version != resource_version(type) || rec->platform != uint32_t(platform))
+		return false;
+
+	TempAllocator512 ta;
+	DynamicString path(ta);
+	CompileOptions::output_path(type, name, path);
+	if (!_bundle_fs.exists(path.c_str()))
+		return false;
+
+	for (uint32_t i = 0; i < rec->num_inputs; i++)
+	{
+		BuildInput& in = _database.input(*rec, i);
+		const char* in_path = _database.input_path(in);
+		DiskFilesystem& fs = (in.flags & BuildInput::BUNDLE) ? _bundle_fs : _source_fs;
 
-	char res_name[1 + 2*StringId64::STRING_LENGTH];
-	_type.to_string(res_name);
-	res_name[16] = '-';
-	_name.to_string(res_name + 17);
+		const bool found = fs.exists(in_path);
+		if (in.flags & BuildInput::EXISTENCE)
+		{
+			if (found != (in.hash != 0))
+				return false;
+			continue;
+		}
 
-	path::join(CROWN_DATA_DIRECTORY, res_name, path);
+		if (!found)
+			return false;
 
-	CE_LOGI("%s <= %s.%s", res_name, name, type);
+		// Only hash the files which might have changed
+		const uint64_t mtime = fs.last_modified_time(in_path);
+		if (in.mtime != 0 && in.mtime == mtime)
+			continue;
+
+		Buffer buf = (in.flags & BuildInput::HEADER)
+			? CompileOptions::read_header(fs, in_path)
+			: CompileOptions::read(fs, in_path);
+		if (murmur64(array::begin(buf), array::size(buf), 0) != in.hash)
+			return false;
+
+		in.mtime = trusted_mtime(fs, in_path);
+	}
 
-	File* outf = _bundle_fs.open(path.c_str(), FOM_WRITE);
-	CompileOptions opts(_source_fs, outf, platform);
-	resource_on_compile(_type, src_path.c_str(), opts);
-	_bundle_fs.close(outf);
 	return true;
 }
 
-bool BundleCompiler::compile_all(Platform::Enum platform)
+uint64_t BundleCompiler::trusted_mtime(DiskFilesystem& fs, const char* path)
 {
-	Vector<DynamicString> files(default_allocator());
-	BundleCompiler::scan("", files);
+	const uint64_t mtime = fs.last_modified_time(path);
+	return mtime < _build_time ? mtime : 0;
+}
+
+void BundleCompiler::write_dependencies(StringId64 type, StringId64 name, const Array<ResourceDependency>& deps)
+{
+	TempAllocator256 ta;
+	DynamicString path(ta);
+	CompileOptions::dependencies_path(type, name, path);
+
+	File* file = _bundle_fs.open(path.c_str(), FOM_WRITE);
+	BinaryWriter bw(*file);
+	bw.write(array::size(deps));
+	for (uint32_t i = 0; i < array::size(deps); i++)
+		bw.write(deps[i]);
+	_bundle_fs.close(file);
+}
+
+void BundleCompiler::compress(const char* path)
+{
+	Array<char> data(default_allocator());
+	File* file = _bundle_fs.open(path, FOM_READ);
+	const uint32_t size = (uint32_t)file->size();
+	array::resize(data, size);
+	file->read(array::begin(data), size);
+	_bundle_fs.close(file);
+
+	Array<char> output(default_allocator());
+	compressed_file::compress(array::begin(data), size, CompressionCodec::LZ4, output);
 
+	if (array::size(output) >= size)
+		return;
+
+	file = _bundle_fs.open(path, FOM_WRITE);
+	file->write(array::begin(output), array::size(output));
+	_bundle_fs.close(file);
+}
+
+bool BundleCompiler::compile_all(Platform::Enum platform)
+{
 	if (!_source_fs.is_file("crown.config"))
 	{
 		CE_LOGD("'crown.config' does not exist.");
 		return false;
 	}
 
+	// Scanning and dependency lookups hit the source tree hard.
+	// The index is only kept for the duration of the build.
+	_source_fs.enable_index(true);
+
+	Vector<DynamicString> files(default_allocator());
+	BundleCompiler::scan("", files);
+
 	File* src = _source_fs.open("crown.config", FOM_READ);
 	File* dst = _bundle_fs.open("crown.config", FOM_WRITE);
 	src->copy_to(*dst, src->size());
 	_source_fs.close(src);
 	_bundle_fs.close(dst);
 
+	// The configuration has just been written, its time is the start of the build
+	_build_time = _bundle_fs.last_modified_time("crown.config");
+	_database.load(_bundle_fs, CROWN_BUILD_DATABASE);
+
 	if (!_bundle_fs.exists("data"))
 		_bundle_fs.create_directory("data");
 
-	// Compile all resources
-	for (uint32_t i = 0; i < vector::size(files); i++)
+	uint32_t num_compiled = 0;
+	uint32_t num_skipped = 0;
+	array::clear(_errors);
+
+	// Compile all resources. Packages go last because
+	// they need the dependencies of the other resources.
+	for (uint32_t pass = 0; pass < 2; pass++)
+	{
+		array::clear(_jobs);
+
+		for (uint32_t i = 0; i < vector::size(files); i++)
+		{
+			if (files[i].ends_with(".tga")
+				|| files[i].ends_with(".dds")
+				|| files[i].ends_with(".sh")
+				|| files[i].ends_with(".sc")
+				|| files[i].starts_with(".")
+				|| files[i].ends_with(".config")
+				|| files[i].ends_with(".tmp")
+				|| files[i].ends_with(".wav"))
+			continue;
+
+			if (files[i].ends_with(".package") != (pass == 1))
+				continue;
+
+			const char* filename = files[i].c_str();
+			char type[256];
+			char name[256];
+			path::extension(filename, type, 256);
+			path::filename_without_extension(filename, name, 256);
+
+			const StringId64 type_id(type);
+			const StringId64 name_id(name);
+			if (up_to_date(type_id, name_id, platform))
+			{
+				_database.keep(type_id, name_id);
+				num_skipped++;
+				continue;
+			}
+
+			array::push_back(_jobs, i);
+		}
+
+		run_jobs(files, platform);
+		num_compiled += array::size(_jobs);
+	}
+
+	// Resources whose sources are gone are forgotten
+	_database.save(_bundle_fs, CROWN_BUILD_DATABASE);
+
+	// The archive no longer matches the compiled resources and the
+	// engine would keep loading from it. pack() writes a new one.
+	if (_bundle_fs.exists(CROWN_BUNDLE_ARCHIVE))
+		_bundle_fs.delete_file(CROWN_BUNDLE_ARCHIVE);
+
+	_source_fs.enable_index(false);
+
+	for (uint32_t i = 0; i < array::size(_errors); i++)
+		CE_LOGE("Failed to compile %s:\n%s", files[_errors[i].file].c_str(), _errors[i].message);
+
+	CE_LOGI("%d resources compiled, %d up to date, %d failed"
+		, num_compiled - array::size(_errors)
+		, num_skipped
+		, array::size(_errors)
+		);
+	return array::size(_errors) == 0;
+}
+
+void BundleCompiler::run_jobs(const Vector<DynamicString>& files, Platform::Enum platform)
+{
+	_files = &files;
+	_platform = platform;
+	_next_job.store(0);
+
+#if CROWN_DEBUG
+	uint32_t num_threads = os::num_processors();
+	num_threads = num_threads < CROWN_MAX_COMPILER_THREADS ? num_threads : CROWN_MAX_COMPILER_THREADS;
+	num_threads = num_threads < array::size(_jobs) ? num_threads : array::size(_jobs);
+
+	Thread threads[CROWN_MAX_COMPILER_THREADS];
+	for (uint32_t i = 0; i < num_threads; i++)
+		threads[i].start(BundleCompiler::thread_proc, this);
+	for (uint32_t i = 0; i < num_threads; i++)
+		threads[i].stop();
+#else
+	// Failed compiles can not be told apart from good ones without
+	// assertions, compile one at a time as if each were the last
+	run();
+#endif // CROWN_DEBUG
+
+	_files = NULL;
+}
+
+int32_t BundleCompiler::run()
+{
+	for (;;)
 	{
-		if (files[i].ends_with(".tga")
-			|| files[i].ends_with(".dds")
-			|| files[i].ends_with(".sh")
-			|| files[i].ends_with(".sc")
-			|| files[i].starts_with(".")
-			|| files[i].ends_with(".config")
-			|| files[i].ends_with(".tmp")
-			|| files[i].ends_with(".wav"))
-		continue;
-
-		const char* filename = files[i].c_str();
+		const uint32_t job = (uint32_t)_next_job.fetch_add(1);
+		if (job >= array::size(_jobs))
+			return 0;
+
+		const uint32_t file = _jobs[job];
+		const char* filename = (*_files)[file].c_str();
 		char type[256];
 		char name[256];
 		path::extension(filename, type, 256);
 		path::filename_without_extension(filename, name, 256);
 
-		compile(type, name, platform);
+		CompileError err;
+		err.file = file;
+		if (try_compile(type, name, _platform, err.message, sizeof(err.message)))
+			continue;
+
+		ScopedMutex sm(_mutex);
+		array::push_back(_errors, err);
+	}
+}
+
+#if CROWN_DEBUG
+struct CompileAbort
+{
+	jmp_buf env;
+	char* message;
+	uint32_t size;
+};
+
+static void compile_abort(const char* message, void* user_data)
+{
+	CompileAbort* ca = (CompileAbort*)user_data;
+	strncpy(ca->message, message, ca->size - 1);
+	ca->message[ca->size - 1] = '\0';
+	longjmp(ca->env, 1);
+}
+#endif // CROWN_DEBUG
+
+bool BundleCompiler::try_compile(const char* type, const char* name, Platform::Enum platform, char* message, uint32_t size)
+{
+	const StringId64 type_id(type);
+	const StringId64 name_id(name);
+
+	TempAllocator512 ta;
+	DynamicString path(ta);
+	DynamicString src_path(ta);
+	src_path += name;
+	src_path += ".";
+	src_path += type;
+	CompileOptions::output_path(type_id, name_id, path);
+
+	CE_LOGI("%s <= %s.%s", path.c_str() + strlen(CROWN_DATA_DIRECTORY) + 1, name, type);
+
+	// Everything that outlives an abort is created before the compiler
+	// runs, abort() unwinds its stack without calling the destructors.
+	File* output = _bundle_fs.open(path.c_str(), FOM_WRITE);
+	CompileOptions opts(_source_fs, _bundle_fs, output, platform, type_id, name_id);
+
+	// Everything the compiler allocates comes from its own allocator
+	// so that whatever an aborted compile leaves behind can be freed.
+	TrackingAllocator allocator(default_allocator());
+
+	volatile bool ok = false;
+
+	memory_globals::set_thread_allocator(&allocator);
+
+#if CROWN_DEBUG
+	CompileAbort ca;
+	ca.message = message;
+	ca.size = size;
+	error::set_abort_function(compile_abort, &ca);
+
+	if (setjmp(ca.env) == 0)
+	{
+		resource_on_compile(type_id, src_path.c_str(), opts);
+		ok = true;
 	}
 
+	error::set_abort_function(NULL, NULL);
+#else
+	// Assertions are compiled out, there is nothing to catch
+	CE_UNUSED(message);
+	CE_UNUSED(size);
+	resource_on_compile(type_id, src_path.c_str(), opts);
+	ok = true;
+#endif // CROWN_DEBUG
+
+	memory_globals::set_thread_allocator(NULL);
+
+	_bundle_fs.close(output);
+
+	if (!ok)
+	{
+		// Do not leave a partially written resource behind
+		_bundle_fs.delete_file(path.c_str());
+		return false;
+	}
+
+	if (allocator.total_allocated() != 0)
+		CE_LOGW("%s.%s: leaked %d bytes", name, type, allocator.total_allocated());
+
+	// Not part of the compiler, failures in here are fatal
+	commit(src_path.c_str(), path.c_str(), opts);
 	return true;
 }
 
@@ -130,13 +415,107 @@ void BundleCompiler::scan(const char* cur_dir, Vector<DynamicString>& files)
 	}
 }
 
+bool BundleCompiler::pack()
+{
+	Vector<DynamicString> files(default_allocator());
+	_bundle_fs.list_files(CROWN_DATA_DIRECTORY, files);
+
+	Array<BundleEntry> entries(default_allocator());
+
+	for (uint32_t i = 0; i < vector::size(files); i++)
+	{
+		TempAllocator512 ta;
+		DynamicString path(ta);
+		path::join(CROWN_DATA_DIRECTORY, files[i].c_str(), path);
+
+		StringId64 type;
+		StringId64 name;
+		if (!bundle::parse_resource_path(path.c_str(), type, name))
+			continue;
+
+		File* file = _bundle_fs.open(path.c_str(), FOM_READ);
+		BundleEntry entry;
+		entry.type = type.id();
+		entry.name = name.id();
+		entry.offset = 0;
+		entry.size = (uint32_t)file->size();
+		entry.alignment = CROWN_BUNDLE_ALIGNMENT;
+		_bundle_fs.close(file);
+
+		array::push_back(entries, entry);
+	}
+
+	std::sort(array::begin(entries), array::end(entries));
+
+	const uint32_t num_entries = array::size(entries);
+	uint64_t offset = sizeof(BundleHeader) + num_entries * sizeof(BundleEntry);
+	for (uint32_t i = 0; i < num_entries; i++)
+	{
+		offset = (offset + entries[i].alignment - 1) & ~uint64_t(entries[i].alignment - 1);
+		entries[i].offset = offset;
+		offset += entries[i].size;
+	}
+
+	BundleHeader header;
+	header.magic = BUNDLE_MAGIC;
+	header.version = BUNDLE_VERSION;
+	header.num_entries = num_entries;
+	header.pad = 0;
+
+	// A running engine might have the archive mapped, write a new
+	// file and replace the old one only when it is complete.
+	const char* tmp_archive = CROWN_BUNDLE_ARCHIVE ".tmp";
+	File* archive = _bundle_fs.open(tmp_archive, FOM_WRITE);
+	archive->write(&header, sizeof(header));
+	if (num_entries)
+		archive->write(array::begin(entries), num_entries * sizeof(BundleEntry));
+
+	const char zero[CROWN_BUNDLE_ALIGNMENT] = { 0 };
+	uint64_t pos = sizeof(BundleHeader) + num_entries * sizeof(BundleEntry);
+	for (uint32_t i = 0; i < num_entries; i++)
+	{
+		archive->write(zero, entries[i].offset - pos);
+
+		char res_name[1 + 2*StringId64::STRING_LENGTH];
+		StringId64(entries[i].type).to_string(res_name);
+		res_name[16] = '-';
+		StringId64(entries[i].name).to_string(res_name + 17);
+
+		TempAllocator512 ta;
+		DynamicString path(ta);
+		path::join(CROWN_DATA_DIRECTORY, res_name, path);
+
+		File* file = _bundle_fs.open(path.c_str(), FOM_READ);
+		file->copy_to(*archive, entries[i].size);
+		_bundle_fs.close(file);
+
+		pos = entries[i].offset + entries[i].size;
+	}
+
+	_bundle_fs.close(archive);
+
+	TempAllocator512 ta;
+	DynamicString tmp_path(ta);
+	DynamicString archive_path(ta);
+	_bundle_fs.get_absolute_path(tmp_archive, tmp_path);
+	_bundle_fs.get_absolute_path(CROWN_BUNDLE_ARCHIVE, archive_path);
+	os::rename_file(tmp_path.c_str(), archive_path.c_str());
+
+	CE_LOGI("%s <= %d resources", CROWN_BUNDLE_ARCHIVE, num_entries);
+	return true;
+}
+
 namespace bundle_compiler
 {
-	bool main(bool do_compile, bool do_continue, Platform::Enum platform)
+	bool main(bool do_compile, bool do_continue, bool do_pack, Platform::Enum platform)
 	{
 		if (do_compile)
 		{
 			bool ok = bundle_compiler_globals::compiler()->compile_all(platform);
+			if (ok && do_pack)
+			{
+				ok = bundle_compiler_globals::compiler()->pack();
+			}
 			if (!ok || !do_continue)
 			{
 				return false;
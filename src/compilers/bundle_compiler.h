@@ -8,33 +8,109 @@
 #include "disk_filesystem.h"
 #include "container_types.h"
 #include "crown.h"
+#include "resource_types.h"
+#include "build_database.h"
+#include "thread.h"
+#include "mutex.h"
+#include "atomic_int.h"
 
 namespace crown
 {
 
+struct CompileOptions;
+
 class BundleCompiler
 {
 public:
 
 	BundleCompiler(const char* source_dir, const char* bundle_dir);
 
-	bool compile(const char* type, const char* name, Platform::Enum platform);
-
 	/// Compiles all the resources found in @a source_dir and puts them in @a bundle_dir.
-	/// Returns true on success, false otherwise.
+	/// Resources whose sources, compiler version and platform did not change since
+	/// the last run are skipped, see CROWN_BUILD_DATABASE. The others are compiled
+	/// in parallel by one thread per processor when CROWN_DEBUG is enabled,
+	/// one at a time otherwise.
+	/// The archive written by pack(), if any, is deleted.
+	/// Returns true on success, false if any resource failed to compile.
 	bool compile_all(Platform::Enum platform);
 
 	void scan(const char* cur_dir, Vector<DynamicString>& files);
 
+	/// Packs all the compiled resources in @a bundle_dir into a single
+	/// archive named CROWN_BUNDLE_ARCHIVE. The archive is written to a
+	/// temporary file first and then renamed over the old one.
+	/// Returns true on success, false otherwise.
+	bool pack();
+
+private:
+
+	// Compiles the files listed in _jobs using a pool of threads.
+	void run_jobs(const Vector<DynamicString>& files, Platform::Enum platform);
+
+	// Compiles jobs until there are none left.
+	int32_t run();
+
+	// Compiles the resource (@a type, @a name) and returns true on success.
+	// When the compiler fails an assertion the error is written to @a message
+	// and false is returned instead of terminating the program.
+	// The compiler is abandoned with longjmp(), which skips the destructors
+	// of its locals: strictly undefined behavior in C++, tolerated because
+	// exceptions are disabled. It must not hold anything but memory from
+	// default_allocator() across an assertion: no open files, no locked
+	// mutexes. Assertions only exist when CROWN_DEBUG is enabled, failures
+	// can not be caught otherwise.
+	bool try_compile(const char* type, const char* name, Platform::Enum platform, char* message, uint32_t size);
+
+	static int32_t thread_proc(void* thiz)
+	{
+		BundleCompiler* bc = (BundleCompiler*)thiz;
+		return bc->run();
+	}
+
+	// Records the compiled resource at @a path, built from @a src_path,
+	// in the build database once its compiler has returned.
+	void commit(const char* src_path, const char* path, CompileOptions& opts);
+
+	// Writes the list of resources the resource (@a type, @a name) depends on.
+	void write_dependencies(StringId64 type, StringId64 name, const Array<ResourceDependency>& deps);
+
+	// Compresses the compiled resource at @a path if that makes it smaller.
+	void compress(const char* path);
+
+	// Returns whether the resource (@a type, @a name) has already been compiled
+	// for @a platform from the current sources.
+	bool up_to_date(StringId64 type, StringId64 name, Platform::Enum platform);
+
+	// Returns the modification time of @a path if it is older than the
+	// start of the build, zero otherwise. Files modified while the build
+	// is running might change again within the timer resolution.
+	uint64_t trusted_mtime(DiskFilesystem& fs, const char* path);
+
 private:
 
 	DiskFilesystem _source_fs;
 	DiskFilesystem _bundle_fs;
+	BuildDatabase _database;
+	uint64_t _build_time;
+
+	struct CompileError
+	{
+		uint32_t file;
+		char message[1024];
+	};
+
+	// Guards _database and _errors while the jobs are running
+	Mutex _mutex;
+	const Vector<DynamicString>* _files;
+	Platform::Enum _platform;
+	Array<uint32_t> _jobs;
+	AtomicInt _next_job;
+	Array<CompileError> _errors;
 };
 
 namespace bundle_compiler
 {
-	bool main(bool do_compile, bool do_continue, Platform::Enum platform);
+	bool main(bool do_compile, bool do_continue, bool do_pack, Platform::Enum platform);
 } // namespace bundle_compiler
 
 namespace bundle_compiler_globals
@@ -8,6 +8,16 @@
 #include "filesystem.h"
 #include "reader_writer.h"
 #include "crown.h"
+#include "resource_types.h"
+#include "array.h"
+#include "hash.h"
+#include "murmur.h"
+#include "path.h"
+#include "temp_allocator.h"
+#include "build_database.h"
+#include "memory_file.h"
+#include "compressed_file.h"
+#include <string.h> // strlen, memcpy
 
 namespace crown
 {
@@ -16,29 +26,87 @@ typedef Array<char> Buffer;
 
 struct CompileOptions
 {
-	CompileOptions(Filesystem& fs, File* out, Platform::Enum platform)
+	/// Reads the sources of the resource (@a type, @a name) from @a fs and writes
+	/// the compiled data to @a out.
+	/// The dependencies of the resources already compiled are read from @a bundle_fs.
+	CompileOptions(Filesystem& fs, Filesystem& bundle_fs, File* out, Platform::Enum platform, StringId64 type, StringId64 name)
 		: _fs(fs)
+		, _bundle_fs(bundle_fs)
 		, _bw(*out)
 		, _platform(platform)
+		, _type(type)
+		, _name(name)
+		, _dependencies(default_allocator())
+		, _inputs(default_allocator())
+		, _input_names(default_allocator())
+		, _input_lookup(default_allocator())
 	{
 	}
 
+	/// Reads the source file at @a path.
+	/// Relative paths are recorded as inputs of the resource being compiled,
+	/// absolute paths are assumed to point to temporary files.
 	Buffer read(const char* path)
 	{
-		File* file = _fs.open(path, FOM_READ);
-		size_t size = file->size();
-		Buffer buf(default_allocator());
-		array::resize(buf, size);
-		file->read(array::begin(buf), size);
-		_fs.close(file);
+		Buffer buf = read(_fs, path);
+
+		if (!path::is_absolute_path(path))
+			add_input(path, 0, murmur64(array::begin(buf), array::size(buf), 0));
+
 		return buf;
 	}
 
+	/// Reads the first BUILD_INPUT_HEADER_SIZE bytes of the source file at @a path,
+	/// or all of it if it is shorter, and records that the resource being
+	/// compiled depends on those bytes only.
+	Buffer read_header(const char* path)
+	{
+		Buffer buf = read_header(_fs, path);
+		add_input(path, BuildInput::HEADER, murmur64(array::begin(buf), array::size(buf), 0));
+		return buf;
+	}
+
+	/// Returns whether the source file at @a path exists and records
+	/// that the resource being compiled depends on it.
+	bool exists(const char* path)
+	{
+		const bool found = _fs.exists(path);
+		add_input(path, BuildInput::EXISTENCE, found ? 1 : 0);
+		return found;
+	}
+
+	/// Records the source file at @a path as an input of the resource
+	/// being compiled, unless it has been read already.
+	void add_input(const char* path)
+	{
+		if (!hash::has(_input_lookup, input_key(path, 0)))
+			read(path);
+	}
+
 	void get_absolute_path(const char* path, DynamicString& abs)
 	{
 		_fs.get_absolute_path(path, abs);
 	}
 
+	/// Returns the absolute path of a temporary file with the given @a suffix.
+	/// Its name is unique to the resource being compiled so that resources
+	/// can be compiled in parallel.
+	void get_temporary_path(const char* suffix, DynamicString& abs)
+	{
+		char res_name[1 + 2*StringId64::STRING_LENGTH];
+		_type.to_string(res_name);
+		res_name[16] = '-';
+		_name.to_string(res_name + 17);
+
+		TempAllocator256 ta;
+		DynamicString tmp(ta);
+		tmp += res_name;
+		tmp += '.';
+		tmp += suffix;
+		tmp += ".tmp";
+		_fs.get_absolute_path(tmp.c_str(), abs);
+	}
+
 	void delete_file(const char* path)
 	{
 		_fs.delete_file(path);
@@ -70,9 +138,141 @@ struct CompileOptions
 		return _platform;
 	}
 
+	/// Records that the resource being compiled references the resource (@a type, @a name).
+	void add_dependency(StringId64 type, StringId64 name)
+	{
+		if (name.id() == 0)
+			return;
+
+		for (uint32_t i = 0; i < array::size(_dependencies); i++)
+		{
+			if (_dependencies[i].type == type && _dependencies[i].name == name)
+				return;
+		}
+
+		ResourceDependency dep = { type, name };
+		array::push_back(_dependencies, dep);
+	}
+
+	/// Appends to @a deps the dependencies recorded when the resource
+	/// (@a type, @a name) has been compiled.
+	void dependencies(StringId64 type, StringId64 name, Array<ResourceDependency>& deps)
+	{
+		TempAllocator256 ta;
+		DynamicString path(ta);
+		dependencies_path(type, name, path);
+
+		if (!_bundle_fs.exists(path.c_str()))
+		{
+			add_input(path.c_str(), BuildInput::BUNDLE | BuildInput::EXISTENCE, 0);
+			return;
+		}
+
+		Buffer buf = read(_bundle_fs, path.c_str());
+		add_input(path.c_str(), BuildInput::BUNDLE, murmur64(array::begin(buf), array::size(buf), 0));
+
+		uint32_t num;
+		memcpy(&num, array::begin(buf), sizeof(num));
+		const uint32_t offset = array::size(deps);
+		array::resize(deps, offset + num);
+		memcpy(array::begin(deps) + offset, array::begin(buf) + sizeof(num), num * sizeof(ResourceDependency));
+	}
+
+	/// Returns the size in bytes of the resource (@a type, @a name) once
+	/// decompressed, or 0 if it has not been compiled.
+	/// The resource is recorded as an input of the resource being compiled.
+	uint32_t resource_size(StringId64 type, StringId64 name)
+	{
+		TempAllocator256 ta;
+		DynamicString path(ta);
+		output_path(type, name, path);
+
+		if (!_bundle_fs.exists(path.c_str()))
+		{
+			add_input(path.c_str(), BuildInput::BUNDLE | BuildInput::EXISTENCE, 0);
+			return 0;
+		}
+
+		Buffer buf = read(_bundle_fs, path.c_str());
+		add_input(path.c_str(), BuildInput::BUNDLE, murmur64(array::begin(buf), array::size(buf), 0));
+
+		MemoryFile file(array::begin(buf), array::size(buf));
+		return (uint32_t)compressed_file::uncompressed_size(file);
+	}
+
+	/// Returns the path of the compiled resource (@a type, @a name).
+	static void output_path(StringId64 type, StringId64 name, DynamicString& path)
+	{
+		char res_name[1 + 2*StringId64::STRING_LENGTH];
+		type.to_string(res_name);
+		res_name[16] = '-';
+		name.to_string(res_name + 17);
+
+		path::join(CROWN_DATA_DIRECTORY, res_name, path);
+	}
+
+	/// Returns the path of the file listing the dependencies of the resource (@a type, @a name).
+	static void dependencies_path(StringId64 type, StringId64 name, DynamicString& path)
+	{
+		output_path(type, name, path);
+		path += ".deps";
+	}
+
+	static Buffer read(Filesystem& fs, const char* path)
+	{
+		File* file = fs.open(path, FOM_READ);
+		size_t size = file->size();
+		Buffer buf(default_allocator());
+		array::resize(buf, size);
+		file->read(array::begin(buf), size);
+		fs.close(file);
+		return buf;
+	}
+
+	static Buffer read_header(Filesystem& fs, const char* path)
+	{
+		File* file = fs.open(path, FOM_READ);
+		size_t size = file->size();
+		if (size > BUILD_INPUT_HEADER_SIZE)
+			size = BUILD_INPUT_HEADER_SIZE;
+		Buffer buf(default_allocator());
+		array::resize(buf, size);
+		file->read(array::begin(buf), size);
+		fs.close(file);
+		return buf;
+	}
+
+	void add_input(const char* path, uint32_t flags, uint64_t content_hash)
+	{
+		const uint64_t key = input_key(path, flags);
+		if (hash::has(_input_lookup, key))
+			return;
+
+		BuildInput in;
+		in.path = array::size(_input_names);
+		in.flags = flags;
+		in.mtime = 0;
+		in.hash = content_hash;
+		array::push(_input_names, path, strlen(path) + 1);
+		hash::set(_input_lookup, key, array::size(_inputs));
+		array::push_back(_inputs, in);
+	}
+
+	static uint64_t input_key(const char* path, uint32_t flags)
+	{
+		return murmur64(path, strlen(path), flags);
+	}
+
 	Filesystem& _fs;
+	Filesystem& _bundle_fs;
 	BinaryWriter _bw;
 	Platform::Enum _platform;
+	StringId64 _type;
+	StringId64 _name;
+	Array<ResourceDependency> _dependencies;
+	Array<BuildInput> _inputs;
+	Array<char> _input_names;
+	Hash<uint32_t> _input_lookup;
 };
 
 } // namespace crown
@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#include "dxt_encoder.h"
+#include <math.h> // sqrtf, fabsf, floorf
+
+namespace crown
+{
+namespace dxt_encoder
+{
+	// Weight of the first endpoint for each of the color indices
+	static const float COLOR_WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+	static uint16_t to_565(const float* c)
+	{
+		const uint32_t r = uint32_t(floorf((c[0] < 0.0f ? 0.0f : (c[0] > 255.0f ? 255.0f : c[0])) * 31.0f / 255.0f + 0.5f));
+		const uint32_t g = uint32_t(floorf((c[1] < 0.0f ? 0.0f : (c[1] > 255.0f ? 255.0f : c[1])) * 63.0f / 255.0f + 0.5f));
+		const uint32_t b = uint32_t(floorf((c[2] < 0.0f ? 0.0f : (c[2] > 255.0f ? 255.0f : c[2])) * 31.0f / 255.0f + 0.5f));
+		return uint16_t((r << 11) | (g << 5) | b);
+	}
+
+	static void from_565(uint16_t c, float* out)
+	{
+		const uint32_t r = (c >> 11) & 0x1f;
+		const uint32_t g = (c >> 5) & 0x3f;
+		const uint32_t b = c & 0x1f;
+		out[0] = float((r << 3) | (r >> 2));
+		out[1] = float((g << 2) | (g >> 4));
+		out[2] = float((b << 3) | (b >> 2));
+	}
+
+	// Assigns each texel to the nearest color of the palette of the
+	// endpoints c0 and c1. Returns the squared error.
+	static float color_indices(const float* texels, uint16_t c0, uint16_t c1, uint32_t& indices)
+	{
+		float e0[3];
+		float e1[3];
+		from_565(c0, e0);
+		from_565(c1, e1);
+
+		float palette[4][3];
+		for (uint32_t k = 0; k < 4; k++)
+		{
+			for (uint32_t c = 0; c < 3; c++)
+				palette[k][c] = e0[c] * COLOR_WEIGHTS[k] + e1[c] * (1.0f - COLOR_WEIGHTS[k]);
+		}
+
+		float error = 0.0f;
+		indices = 0;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			const float* t = &texels[i * 3];
+			uint32_t best = 0;
+			float best_dist = 1e30f;
+			for (uint32_t k = 0; k < 4; k++)
+			{
+				const float dr = t[0] - palette[k][0];
+				const float dg = t[1] - palette[k][1];
+				const float db = t[2] - palette[k][2];
+				const float dist = dr*dr + dg*dg + db*db;
+				if (dist < best_dist)
+				{
+					best = k;
+					best_dist = dist;
+				}
+			}
+			indices |= best << (i * 2);
+			error += best_dist;
+		}
+
+		return error;
+	}
+
+	// Solves for the endpoints which minimize the squared error
+	// of the texels with the given indices. Returns false if singular.
+	static bool refit_endpoints(const float* texels, uint32_t indices, float* e0, float* e1)
+	{
+		float aa = 0.0f;
+		float bb = 0.0f;
+		float ab = 0.0f;
+		float ax[3] = { 0.0f, 0.0f, 0.0f };
+		float bx[3] = { 0.0f, 0.0f, 0.0f };
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			const float a = COLOR_WEIGHTS[(indices >> (i * 2)) & 3];
+			const float b = 1.0f - a;
+			aa += a * a;
+			bb += b * b;
+			ab += a * b;
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				ax[c] += a * texels[i * 3 + c];
+				bx[c] += b * texels[i * 3 + c];
+			}
+		}
+
+		const float det = aa * bb - ab * ab;
+		if (fabsf(det) < 1e-6f)
+			return false;
+
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+			e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+		}
+		return true;
+	}
+
+	// Writes the endpoints and indices so that the block decodes in four-color mode
+	static void write_color_block(uint16_t c0, uint16_t c1, uint32_t indices, uint8_t* dst)
+	{
+		if (c0 < c1)
+		{
+			const uint16_t tmp = c0;
+			c0 = c1;
+			c1 = tmp;
+			// Swap 0 with 1 and 2 with 3
+			indices ^= 0x55555555u;
+		}
+		else if (c0 == c1)
+		{
+			indices = 0;
+		}
+
+		dst[0] = uint8_t(c0 & 0xff);
+		dst[1] = uint8_t(c0 >> 8);
+		dst[2] = uint8_t(c1 & 0xff);
+		dst[3] = uint8_t(c1 >> 8);
+		dst[4] = uint8_t(indices & 0xff);
+		dst[5] = uint8_t((indices >> 8) & 0xff);
+		dst[6] = uint8_t((indices >> 16) & 0xff);
+		dst[7] = uint8_t(indices >> 24);
+	}
+
+	static void encode_color_block(const uint8_t* block, uint8_t* dst)
+	{
+		float texels[16 * 3];
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				texels[i * 3 + c] = float(block[i * 4 + c]);
+				mean[c] += texels[i * 3 + c];
+			}
+		}
+		for (uint32_t c = 0; c < 3; c++)
+			mean[c] /= 16.0f;
+
+		// Covariance matrix of the colors
+		float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			const float r = texels[i * 3 + 0] - mean[0];
+			const float g = texels[i * 3 + 1] - mean[1];
+			const float b = texels[i * 3 + 2] - mean[2];
+			cov[0] += r*r;
+			cov[1] += r*g;
+			cov[2] += r*b;
+			cov[3] += g*g;
+			cov[4] += g*b;
+			cov[5] += b*b;
+		}
+
+		// Principal axis by power iteration
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (uint32_t k = 0; k < 8; k++)
+		{
+			const float x = axis[0]*cov[0] + axis[1]*cov[1] + axis[2]*cov[2];
+			const float y = axis[0]*cov[1] + axis[1]*cov[3] + axis[2]*cov[4];
+			const float z = axis[0]*cov[2] + axis[1]*cov[4] + axis[2]*cov[5];
+			const float len = sqrtf(x*x + y*y + z*z);
+			if (len < 1e-6f)
+				break;
+			axis[0] = x / len;
+			axis[1] = y / len;
+			axis[2] = z / len;
+		}
+
+		// Endpoints at the extremes of the colors along the axis
+		float tmin = 1e30f;
+		float tmax = -1e30f;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			const float t = (texels[i * 3 + 0] - mean[0]) * axis[0]
+				+ (texels[i * 3 + 1] - mean[1]) * axis[1]
+				+ (texels[i * 3 + 2] - mean[2]) * axis[2];
+			tmin = t < tmin ? t : tmin;
+			tmax = t > tmax ? t : tmax;
+		}
+
+		float e0[3];
+		float e1[3];
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			e0[c] = mean[c] + axis[c] * tmax;
+			e1[c] = mean[c] + axis[c] * tmin;
+		}
+
+		uint16_t c0 = to_565(e0);
+		uint16_t c1 = to_565(e1);
+		uint32_t indices;
+		float error = color_indices(texels, c0, c1, indices);
+
+		// Refine the endpoints with the indices just found
+		for (uint32_t k = 0; k < 2 && error > 0.0f; k++)
+		{
+			if (!refit_endpoints(texels, indices, e0, e1))
+				break;
+
+			const uint16_t r0 = to_565(e0);
+			const uint16_t r1 = to_565(e1);
+			uint32_t rindices;
+			const float rerror = color_indices(texels, r0, r1, rindices);
+			if (rerror >= error)
+				break;
+
+			c0 = r0;
+			c1 = r1;
+			indices = rindices;
+			error = rerror;
+		}
+
+		write_color_block(c0, c1, indices, dst);
+	}
+
+	static void encode_alpha_block(const uint8_t* block, uint8_t* dst)
+	{
+		uint8_t amin = 255;
+		uint8_t amax = 0;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			const uint8_t a = block[i * 4 + 3];
+			amin = a < amin ? a : amin;
+			amax = a > amax ? a : amax;
+		}
+
+		// Eight-value mode, a0 > a1
+		float palette[8];
+		palette[0] = float(amax);
+		palette[1] = float(amin);
+		for (uint32_t k = 2; k < 8; k++)
+			palette[k] = (float(8 - k) * float(amax) + float(k - 1) * float(amin)) / 7.0f;
+
+		uint64_t indices = 0;
+		if (amax != amin)
+		{
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				const float a = float(block[i * 4 + 3]);
+				uint64_t best = 0;
+				float best_dist = 1e30f;
+				for (uint32_t k = 0; k < 8; k++)
+				{
+					const float dist = fabsf(a - palette[k]);
+					if (dist < best_dist)
+					{
+						best = k;
+						best_dist = dist;
+					}
+				}
+				indices |= best << (i * 3);
+			}
+		}
+
+		dst[0] = amax;
+		dst[1] = amin;
+		for (uint32_t i = 0; i < 6; i++)
+			dst[2 + i] = uint8_t((indices >> (i * 8)) & 0xff);
+	}
+
+	void encode_dxt1_block(const uint8_t* block, uint8_t* dst)
+	{
+		encode_color_block(block, dst);
+	}
+
+	void encode_dxt5_block(const uint8_t* block, uint8_t* dst)
+	{
+		encode_alpha_block(block, dst);
+		encode_color_block(block, dst + 8);
+	}
+
+	void encode(const uint8_t* src, uint32_t width, uint32_t height, bool alpha, uint8_t* dst)
+	{
+		const uint32_t block_size = alpha ? 16 : 8;
+
+		for (uint32_t by = 0; by < height; by += 4)
+		{
+			for (uint32_t bx = 0; bx < width; bx += 4)
+			{
+				uint8_t block[16 * 4];
+				for (uint32_t y = 0; y < 4; y++)
+				{
+					const uint32_t sy = by + y < height ? by + y : height - 1;
+					for (uint32_t x = 0; x < 4; x++)
+					{
+						const uint32_t sx = bx + x < width ? bx + x : width - 1;
+						const uint8_t* t = &src[(sy * width + sx) * 4];
+						uint8_t* b = &block[(y * 4 + x) * 4];
+						b[0] = t[0];
+						b[1] = t[1];
+						b[2] = t[2];
+						b[3] = t[3];
+					}
+				}
+
+				if (alpha)
+					encode_dxt5_block(block, dst);
+				else
+					encode_dxt1_block(block, dst);
+				dst += block_size;
+			}
+		}
+	}
+} // namespace dxt_encoder
+} // namespace crown
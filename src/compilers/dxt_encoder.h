@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "types.h"
+
+namespace crown
+{
+
+/// Functions to compress images to the DXT (BC) block formats.
+/// Images are arrays of RGBA 8-bit texels, row by row.
+namespace dxt_encoder
+{
+	/// Compresses the 4x4 block of RGBA texels @a block to the 8 bytes of
+	/// a DXT1 (BC1) block. Alpha is ignored.
+	void encode_dxt1_block(const uint8_t* block, uint8_t* dst);
+
+	/// Compresses the 4x4 block of RGBA texels @a block to the 16 bytes of
+	/// a DXT5 (BC3) block.
+	void encode_dxt5_block(const uint8_t* block, uint8_t* dst);
+
+	/// Compresses the @a width x @a height image @a src to DXT1, or to DXT5 if @a alpha.
+	/// The blocks past the edges of the image are padded with the edge texels.
+	/// @a dst must hold ((width + 3) / 4) * ((height + 3) / 4) blocks.
+	void encode(const uint8_t* src, uint32_t width, uint32_t height, bool alpha, uint8_t* dst);
+} // namespace dxt_encoder
+
+} // namespace crown
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#include "mesh_optimizer.h"
+#include "array.h"
+#include "memory.h"
+#include <math.h> // powf
+#include <string.h> // memcpy
+
+namespace crown
+{
+namespace mesh_optimizer
+{
+	static const uint32_t INVALID = 0xffffffffu;
+
+	// Parameters of the scoring function, from the original paper
+	static const uint32_t CACHE_SIZE = 32;
+	static const uint32_t MAX_VALENCE = 64; // Higher valences score as MAX_VALENCE - 1
+	static const float CACHE_DECAY_POWER = 1.5f;
+	static const float LAST_TRIANGLE_SCORE = 0.75f;
+	static const float VALENCE_BOOST_SCALE = 2.0f;
+	static const float VALENCE_BOOST_POWER = 0.5f;
+
+	struct ScoreTables
+	{
+		float cache[CACHE_SIZE];
+		float valence[MAX_VALENCE];
+	};
+
+	static void init_score_tables(ScoreTables& st)
+	{
+		for (uint32_t i = 0; i < CACHE_SIZE; i++)
+		{
+			// The vertices of the last triangle get a fixed score so that
+			// the same triangle is not favoured based on the order of its vertices
+			if (i < 3)
+				st.cache[i] = LAST_TRIANGLE_SCORE;
+			else
+				st.cache[i] = powf(1.0f - float(i - 3) / float(CACHE_SIZE - 3), CACHE_DECAY_POWER);
+		}
+
+		// Vertices with few triangles left get a boost to avoid leaving them alone
+		st.valence[0] = 0.0f;
+		for (uint32_t i = 1; i < MAX_VALENCE; i++)
+			st.valence[i] = VALENCE_BOOST_SCALE * powf(float(i), -VALENCE_BOOST_POWER);
+	}
+
+	static float vertex_score(const ScoreTables& st, int32_t cache_pos, uint32_t valence)
+	{
+		// No triangles left to add
+		if (valence == 0)
+			return -1.0f;
+
+		const float score = cache_pos >= 0 ? st.cache[cache_pos] : 0.0f;
+		return score + st.valence[valence < MAX_VALENCE ? valence : MAX_VALENCE - 1];
+	}
+
+	void optimize_vertex_cache(uint32_t* indices, uint32_t num_indices, uint32_t num_vertices)
+	{
+		const uint32_t num_triangles = num_indices / 3;
+		if (num_triangles == 0)
+			return;
+
+		ScoreTables st;
+		init_score_tables(st);
+
+		// Triangles which use each vertex and are still to be added
+		Array<uint32_t> valence(default_allocator());
+		Array<uint32_t> offsets(default_allocator());
+		Array<uint32_t> adjacency(default_allocator());
+		array::resize(valence, num_vertices);
+		array::resize(offsets, num_vertices);
+		array::resize(adjacency, num_triangles * 3);
+
+		for (uint32_t i = 0; i < num_vertices; i++)
+			valence[i] = 0;
+		for (uint32_t i = 0; i < num_triangles * 3; i++)
+			valence[indices[i]]++;
+
+		uint32_t offset = 0;
+		for (uint32_t i = 0; i < num_vertices; i++)
+		{
+			offsets[i] = offset;
+			offset += valence[i];
+			valence[i] = 0;
+		}
+		for (uint32_t i = 0; i < num_triangles * 3; i++)
+		{
+			const uint32_t v = indices[i];
+			adjacency[offsets[v] + valence[v]++] = i / 3;
+		}
+
+		Array<int32_t> cache_pos(default_allocator());
+		Array<float> vscore(default_allocator());
+		Array<float> tscore(default_allocator());
+		Array<bool> emitted(default_allocator());
+		Array<uint32_t> output(default_allocator());
+		array::resize(cache_pos, num_vertices);
+		array::resize(vscore, num_vertices);
+		array::resize(tscore, num_triangles);
+		array::resize(emitted, num_triangles);
+		array::resize(output, num_triangles * 3);
+
+		for (uint32_t i = 0; i < num_vertices; i++)
+		{
+			cache_pos[i] = -1;
+			vscore[i] = vertex_score(st, -1, valence[i]);
+		}
+
+		uint32_t best = INVALID;
+		float best_score = -1.0f;
+		for (uint32_t i = 0; i < num_triangles; i++)
+		{
+			const uint32_t* tri = &indices[i * 3];
+			emitted[i] = false;
+			tscore[i] = vscore[tri[0]] + vscore[tri[1]] + vscore[tri[2]];
+			if (tscore[i] > best_score)
+			{
+				best = i;
+				best_score = tscore[i];
+			}
+		}
+
+		uint32_t cache[CACHE_SIZE + 3];
+		uint32_t cache_size = 0;
+		uint32_t next_unemitted = 0;
+
+		for (uint32_t n = 0; n < num_triangles; n++)
+		{
+			// None of the cached vertices has triangles left, take the next one in order
+			if (best == INVALID)
+			{
+				while (emitted[next_unemitted])
+					next_unemitted++;
+				best = next_unemitted;
+			}
+
+			const uint32_t* tri = &indices[best * 3];
+			emitted[best] = true;
+			output[n * 3 + 0] = tri[0];
+			output[n * 3 + 1] = tri[1];
+			output[n * 3 + 2] = tri[2];
+
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				const uint32_t v = tri[k];
+				uint32_t* adj = &adjacency[offsets[v]];
+				for (uint32_t j = 0; j < valence[v]; j++)
+				{
+					if (adj[j] == best)
+					{
+						adj[j] = adj[valence[v] - 1];
+						break;
+					}
+				}
+				valence[v]--;
+			}
+
+			// Move the vertices of the triangle to the front of the cache,
+			// the ones pushed past CACHE_SIZE are evicted
+			uint32_t new_cache[CACHE_SIZE + 3];
+			uint32_t new_size = 0;
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				if (k > 0 && tri[k] == tri[0])
+					continue;
+				if (k > 1 && tri[k] == tri[1])
+					continue;
+				new_cache[new_size++] = tri[k];
+			}
+			for (uint32_t i = 0; i < cache_size; i++)
+			{
+				const uint32_t v = cache[i];
+				if (v != tri[0] && v != tri[1] && v != tri[2])
+					new_cache[new_size++] = v;
+			}
+
+			for (uint32_t i = 0; i < new_size; i++)
+			{
+				const uint32_t v = new_cache[i];
+				cache_pos[v] = i < CACHE_SIZE ? int32_t(i) : -1;
+				vscore[v] = vertex_score(st, cache_pos[v], valence[v]);
+			}
+
+			// Only the triangles of the vertices whose score changed need to be updated
+			best = INVALID;
+			best_score = -1.0f;
+			for (uint32_t i = 0; i < new_size; i++)
+			{
+				const uint32_t v = new_cache[i];
+				const uint32_t* adj = &adjacency[offsets[v]];
+				for (uint32_t j = 0; j < valence[v]; j++)
+				{
+					const uint32_t t = adj[j];
+					const uint32_t* ttri = &indices[t * 3];
+					tscore[t] = vscore[ttri[0]] + vscore[ttri[1]] + vscore[ttri[2]];
+					if (tscore[t] > best_score)
+					{
+						best = t;
+						best_score = tscore[t];
+					}
+				}
+			}
+
+			cache_size = new_size < CACHE_SIZE ? new_size : CACHE_SIZE;
+			memcpy(cache, new_cache, cache_size * sizeof(uint32_t));
+		}
+
+		memcpy(indices, array::begin(output), num_triangles * 3 * sizeof(uint32_t));
+	}
+
+	uint32_t optimize_vertex_fetch(uint32_t* indices, uint32_t num_indices, uint32_t num_vertices, uint32_t* remap)
+	{
+		for (uint32_t i = 0; i < num_vertices; i++)
+			remap[i] = INVALID;
+
+		uint32_t num_referenced = 0;
+		for (uint32_t i = 0; i < num_indices; i++)
+		{
+			const uint32_t v = indices[i];
+			if (remap[v] == INVALID)
+				remap[v] = num_referenced++;
+			indices[i] = remap[v];
+		}
+
+		return num_referenced;
+	}
+
+	float average_cache_miss_ratio(const uint32_t* indices, uint32_t num_indices, uint32_t num_vertices, uint32_t cache_size)
+	{
+		if (num_indices < 3)
+			return 0.0f;
+
+		// Time at which each vertex entered the cache, zero if it never did
+		Array<uint32_t> timestamp(default_allocator());
+		array::resize(timestamp, num_vertices);
+		for (uint32_t i = 0; i < num_vertices; i++)
+			timestamp[i] = 0;
+
+		uint32_t time = cache_size + 1;
+		uint32_t misses = 0;
+		for (uint32_t i = 0; i < num_indices; i++)
+		{
+			const uint32_t v = indices[i];
+			if (time - timestamp[v] > cache_size)
+			{
+				timestamp[v] = time++;
+				misses++;
+			}
+		}
+
+		return float(misses) / float(num_indices / 3);
+	}
+} // namespace mesh_optimizer
+} // namespace crown
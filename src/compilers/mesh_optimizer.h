@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "types.h"
+
+namespace crown
+{
+
+/// Functions to reorder the triangle lists of the meshes for faster rendering.
+namespace mesh_optimizer
+{
+	/// Reorders the triangles in @a indices to make better use of the
+	/// post-transform vertex cache, see Tom Forsyth's "Linear-Speed Vertex
+	/// Cache Optimisation".
+	void optimize_vertex_cache(uint32_t* indices, uint32_t num_indices, uint32_t num_vertices);
+
+	/// Renumbers the vertices in the order they are first referenced by
+	/// @a indices, so that the vertex fetches are as sequential as possible.
+	/// The new index of the vertex i is written to @a remap[i], unreferenced
+	/// vertices are set to 0xffffffff.
+	/// Returns the number of referenced vertices.
+	uint32_t optimize_vertex_fetch(uint32_t* indices, uint32_t num_indices, uint32_t num_vertices, uint32_t* remap);
+
+	/// Returns the average number of vertices transformed per triangle
+	/// with a FIFO vertex cache of @a cache_size entries.
+	float average_cache_miss_ratio(const uint32_t* indices, uint32_t num_indices, uint32_t num_vertices, uint32_t cache_size);
+} // namespace mesh_optimizer
+
+} // namespace crown
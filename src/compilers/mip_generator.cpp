@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#include "mip_generator.h"
+#include "array.h"
+#include "memory.h"
+#include "error.h"
+#include <math.h> // powf, sinf, sqrtf, fabsf, floorf, ceilf
+
+namespace crown
+{
+namespace mip_generator
+{
+	// Parameters of the Kaiser filter, radius is in destination texels
+	static const float KAISER_RADIUS = 3.0f;
+	static const float KAISER_ALPHA = 4.0f;
+	static const float PI = 3.14159265358979323846f;
+
+	static float srgb_to_linear(float c)
+	{
+		return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	static float linear_to_srgb(float c)
+	{
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	// Modified Bessel function of the first kind of order zero
+	static float bessel_i0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+		for (uint32_t k = 1; k < 32 && term > sum * 1e-7f; k++)
+		{
+			const float t = x / (2.0f * float(k));
+			term *= t * t;
+			sum += term;
+		}
+		return sum;
+	}
+
+	static float kaiser(float x)
+	{
+		const float r = x / KAISER_RADIUS;
+		if (r <= -1.0f || r >= 1.0f)
+			return 0.0f;
+
+		const float window = bessel_i0(KAISER_ALPHA * sqrtf(1.0f - r * r)) / bessel_i0(KAISER_ALPHA);
+		const float sinc = fabsf(x) < 1e-5f ? 1.0f : sinf(PI * x) / (PI * x);
+		return sinc * window;
+	}
+
+	// Weights of the source texels which contribute to each destination texel
+	// along one axis. Each destination texel has num_taps weights starting at first[i].
+	struct Filter
+	{
+		Filter()
+			: first(default_allocator())
+			, weights(default_allocator())
+			, num_taps(0)
+		{
+		}
+
+		Array<int32_t> first;
+		Array<float> weights;
+		uint32_t num_taps;
+	};
+
+	static void init_filter(Filter& f, uint32_t src_size, uint32_t dst_size, MipFilter::Enum filter)
+	{
+		const float scale = float(src_size) / float(dst_size);
+		const float support = (filter == MipFilter::BOX ? 0.5f : KAISER_RADIUS) * (scale > 1.0f ? scale : 1.0f);
+
+		f.num_taps = uint32_t(ceilf(support * 2.0f)) + 1;
+		array::resize(f.first, dst_size);
+		array::resize(f.weights, dst_size * f.num_taps);
+
+		for (uint32_t i = 0; i < dst_size; i++)
+		{
+			const float center = (float(i) + 0.5f) * scale;
+			const int32_t first = int32_t(floorf(center - support));
+			float* w = &f.weights[i * f.num_taps];
+
+			float sum = 0.0f;
+			for (uint32_t j = 0; j < f.num_taps; j++)
+			{
+				const float lo = float(first + int32_t(j));
+				if (filter == MipFilter::BOX)
+				{
+					// Area of the source texel covered by the destination texel
+					const float a = lo > center - support ? lo : center - support;
+					const float b = lo + 1.0f < center + support ? lo + 1.0f : center + support;
+					w[j] = b > a ? b - a : 0.0f;
+				}
+				else
+				{
+					const float x = (lo + 0.5f - center) / (scale > 1.0f ? scale : 1.0f);
+					w[j] = kaiser(x);
+				}
+				sum += w[j];
+			}
+
+			CE_ASSERT(sum != 0.0f, "Degenerate filter");
+			for (uint32_t j = 0; j < f.num_taps; j++)
+				w[j] /= sum;
+
+			f.first[i] = first;
+		}
+	}
+
+	static uint32_t clamp_index(int32_t i, uint32_t size)
+	{
+		return i < 0 ? 0 : (i >= int32_t(size) ? size - 1 : uint32_t(i));
+	}
+
+	uint32_t num_mips(uint32_t width, uint32_t height)
+	{
+		uint32_t size = width > height ? width : height;
+		uint32_t num = 1;
+		while (size > 1)
+		{
+			size >>= 1;
+			num++;
+		}
+		return num;
+	}
+
+	void resize(const float* src, uint32_t src_width, uint32_t src_height
+		, float* dst, uint32_t dst_width, uint32_t dst_height, MipFilter::Enum filter)
+	{
+		Filter fx;
+		Filter fy;
+		init_filter(fx, src_width, dst_width, filter);
+		init_filter(fy, src_height, dst_height, filter);
+
+		// Filter the rows first, then the columns
+		Array<float> tmp(default_allocator());
+		array::resize(tmp, dst_width * src_height * 4);
+
+		for (uint32_t y = 0; y < src_height; y++)
+		{
+			const float* row = &src[y * src_width * 4];
+			for (uint32_t x = 0; x < dst_width; x++)
+			{
+				const float* w = &fx.weights[x * fx.num_taps];
+				float c[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				for (uint32_t j = 0; j < fx.num_taps; j++)
+				{
+					const float* t = &row[clamp_index(fx.first[x] + int32_t(j), src_width) * 4];
+					c[0] += t[0] * w[j];
+					c[1] += t[1] * w[j];
+					c[2] += t[2] * w[j];
+					c[3] += t[3] * w[j];
+				}
+
+				float* out = &tmp[(y * dst_width + x) * 4];
+				out[0] = c[0];
+				out[1] = c[1];
+				out[2] = c[2];
+				out[3] = c[3];
+			}
+		}
+
+		for (uint32_t y = 0; y < dst_height; y++)
+		{
+			const float* w = &fy.weights[y * fy.num_taps];
+			for (uint32_t x = 0; x < dst_width; x++)
+			{
+				float c[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				for (uint32_t j = 0; j < fy.num_taps; j++)
+				{
+					const float* t = &tmp[(clamp_index(fy.first[y] + int32_t(j), src_height) * dst_width + x) * 4];
+					c[0] += t[0] * w[j];
+					c[1] += t[1] * w[j];
+					c[2] += t[2] * w[j];
+					c[3] += t[3] * w[j];
+				}
+
+				float* out = &dst[(y * dst_width + x) * 4];
+				out[0] = c[0];
+				out[1] = c[1];
+				out[2] = c[2];
+				out[3] = c[3];
+			}
+		}
+	}
+
+	void to_float(const uint8_t* src, uint32_t num, uint32_t channels, bool srgb, float* dst)
+	{
+		CE_ASSERT(channels == 3 || channels == 4, "Unsupported number of channels: %d", channels);
+
+		float table[256];
+		for (uint32_t i = 0; i < 256; i++)
+			table[i] = srgb ? srgb_to_linear(float(i) / 255.0f) : float(i) / 255.0f;
+
+		for (uint32_t i = 0; i < num; i++)
+		{
+			const uint8_t* t = &src[i * channels];
+			float* out = &dst[i * 4];
+			out[0] = table[t[0]];
+			out[1] = table[t[1]];
+			out[2] = table[t[2]];
+			// Alpha is always linear
+			out[3] = channels == 4 ? float(t[3]) / 255.0f : 1.0f;
+		}
+	}
+
+	void to_uint8(const float* src, uint32_t num, uint32_t channels, bool srgb, uint8_t* dst)
+	{
+		CE_ASSERT(channels == 3 || channels == 4, "Unsupported number of channels: %d", channels);
+
+		for (uint32_t i = 0; i < num; i++)
+		{
+			const float* t = &src[i * 4];
+			uint8_t* out = &dst[i * channels];
+			for (uint32_t c = 0; c < channels; c++)
+			{
+				// Sharper filters may overshoot
+				float v = t[c] < 0.0f ? 0.0f : (t[c] > 1.0f ? 1.0f : t[c]);
+				if (srgb && c < 3)
+					v = linear_to_srgb(v);
+				out[c] = uint8_t(floorf(v * 255.0f + 0.5f));
+			}
+		}
+	}
+} // namespace mip_generator
+} // namespace crown
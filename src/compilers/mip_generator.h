@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "types.h"
+
+namespace crown
+{
+
+/// Enumerates the filters used to generate the mip levels.
+struct MipFilter
+{
+	enum Enum
+	{
+		BOX,    // Average of the source texels, fast but blurry
+		KAISER, // Kaiser-windowed sinc, sharper
+
+		COUNT
+	};
+};
+
+/// Functions to generate the mip chain of a texture.
+/// Images are arrays of RGBA float texels, row by row.
+namespace mip_generator
+{
+	/// Returns the number of levels of the full mip chain of a @a width x @a height image.
+	uint32_t num_mips(uint32_t width, uint32_t height);
+
+	/// Resizes the @a src image of @a src_width x @a src_height texels to
+	/// the @a dst image of @a dst_width x @a dst_height texels using @a filter.
+	/// Texels outside the image are clamped to the edge.
+	void resize(const float* src, uint32_t src_width, uint32_t src_height
+		, float* dst, uint32_t dst_width, uint32_t dst_height, MipFilter::Enum filter);
+
+	/// Converts the @a num 8-bit texels of @a channels components in @a src
+	/// to float RGBA in @a dst. Colors are converted from sRGB to linear if @a srgb.
+	/// Missing alpha is set to 1.0.
+	void to_float(const uint8_t* src, uint32_t num, uint32_t channels, bool srgb, float* dst);
+
+	/// Converts the @a num float RGBA texels in @a src to 8-bit texels of
+	/// @a channels components in @a dst. Colors are converted from linear to sRGB if @a srgb.
+	void to_uint8(const float* src, uint32_t num, uint32_t channels, bool srgb, uint8_t* dst);
+} // namespace mip_generator
+
+} // namespace crown
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#include "shader_cache.h"
+#include "config.h"
+#include "disk_filesystem.h"
+#include "file.h"
+#include "array.h"
+#include "dynamic_string.h"
+#include "temp_allocator.h"
+#include "path.h"
+#include "murmur.h"
+#include "mutex.h"
+#include "atomic_int.h"
+#include "os.h"
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace crown
+{
+namespace shader_cache
+{
+	// The state is kept out of the heap because the compilers
+	// run with a per-resource allocator, see BundleCompiler.
+	static Mutex s_mutex;
+	static bool s_initialized = false;
+	static char s_directory[1024]; // Empty when the cache is disabled
+	static bool s_compiler_hashed = false;
+	static uint64_t s_compiler_hash = 0;
+	static AtomicInt s_num_temporaries(0);
+
+	// Creates the directory at @a path unless it exists already.
+	// Unlike os::create_directory() it reports failures instead of asserting,
+	// other processes might be creating the same directory.
+	static bool make_directory(const char* path)
+	{
+#if CROWN_PLATFORM_POSIX
+		return ::mkdir(path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) == 0 || errno == EEXIST;
+#elif CROWN_PLATFORM_WINDOWS
+		return CreateDirectory(path, NULL) != 0 || GetLastError() == ERROR_ALREADY_EXISTS;
+#endif
+	}
+
+	// Creates the directory at @a path and all its missing parents.
+	static bool make_directories(char* path)
+	{
+		for (char* ch = path + 1; *ch != '\0'; ch++)
+		{
+			if (*ch != '/' && *ch != '\\')
+				continue;
+
+			const char sep = *ch;
+			*ch = '\0';
+			const bool ok = os::exists(path) || make_directory(path);
+			*ch = sep;
+
+			if (!ok)
+				return false;
+		}
+
+		return os::exists(path) || make_directory(path);
+	}
+
+	// Writes @a data to a new file at @a path.
+	// Unlike DiskFilesystem it reports failures instead of asserting,
+	// the cache might be on a full or read-only disk.
+	static bool write_file(const char* path, const Array<char>& data)
+	{
+		FILE* file = fopen(path, "wb");
+		if (file == NULL)
+			return false;
+
+		const size_t size = array::size(data);
+		const bool ok = (size == 0 || fwrite(array::begin(data), 1, size, file) == size)
+			&& fclose(file) == 0;
+
+		if (!ok)
+			::remove(path);
+
+		return ok;
+	}
+
+	// Replaces the file at @a new_path with the one at @a old_path.
+	// Unlike os::rename_file() it reports failures instead of asserting.
+	static bool replace_file(const char* old_path, const char* new_path)
+	{
+#if CROWN_PLATFORM_POSIX
+		return ::rename(old_path, new_path) == 0;
+#elif CROWN_PLATFORM_WINDOWS
+		return MoveFileEx(old_path, new_path, MOVEFILE_REPLACE_EXISTING) != 0;
+#endif
+	}
+
+	static const char* directory()
+	{
+		{
+			ScopedMutex sm(s_mutex);
+			if (s_initialized)
+				return s_directory;
+		}
+
+		// Worked out without holding the lock, the compiler calling this might
+		// be aborted by an assertion. Other threads might get here meanwhile
+		// and come to the same result.
+		char directory[sizeof(s_directory)];
+		directory[0] = '\0';
+
+		const char* dir = os::getenv("CROWN_SHADER_CACHE");
+		if (dir != NULL)
+		{
+			strncpy(directory, dir, sizeof(directory) - 1);
+			directory[sizeof(directory) - 1] = '\0';
+		}
+		else
+		{
+#if CROWN_PLATFORM_POSIX
+			const char* xdg = os::getenv("XDG_CACHE_HOME");
+			const char* home = os::getenv("HOME");
+			if (xdg != NULL && xdg[0] != '\0')
+				snprintf(directory, sizeof(directory), "%s/%s", xdg, CROWN_SHADER_CACHE_DIR);
+			else if (home != NULL && home[0] != '\0')
+				snprintf(directory, sizeof(directory), "%s/.cache/%s", home, CROWN_SHADER_CACHE_DIR);
+#elif CROWN_PLATFORM_WINDOWS
+			const char* local = os::getenv("LOCALAPPDATA");
+			if (local != NULL && local[0] != '\0')
+				snprintf(directory, sizeof(directory), "%s\\%s", local, CROWN_SHADER_CACHE_DIR);
+#endif
+		}
+
+		if (directory[0] != '\0' && !make_directories(directory))
+		{
+			CE_LOGW("Unable to create shader cache directory '%s', shaders will not be cached", directory);
+			directory[0] = '\0';
+		}
+
+		ScopedMutex sm(s_mutex);
+		if (!s_initialized)
+		{
+			memcpy(s_directory, directory, sizeof(s_directory));
+			s_initialized = true;
+		}
+
+		return s_directory;
+	}
+
+	static void entry_path(const char* dir, uint64_t key, const char* suffix, DynamicString& path)
+	{
+		char name[StringId64::STRING_LENGTH];
+		StringId64 id(key);
+		id.to_string(name);
+
+		path::join(dir, name, path);
+		path += suffix;
+	}
+
+	bool enabled()
+	{
+		return directory()[0] != '\0';
+	}
+
+	uint64_t compiler_hash(const char* path)
+	{
+		{
+			ScopedMutex sm(s_mutex);
+			if (s_compiler_hashed)
+				return s_compiler_hash;
+		}
+
+		uint64_t hash = 0;
+
+		DiskFilesystem fs;
+		if (fs.exists(path))
+		{
+			File* file = fs.open(path, FOM_READ);
+			const size_t size = file->size();
+
+			char buf[16*1024];
+			for (size_t i = 0; i < size; i += sizeof(buf))
+			{
+				const size_t num = size - i < sizeof(buf) ? size - i : sizeof(buf);
+				file->read(buf, num);
+				hash = murmur64(buf, num, hash);
+			}
+
+			fs.close(file);
+		}
+
+		ScopedMutex sm(s_mutex);
+		s_compiler_hash = hash;
+		s_compiler_hashed = true;
+		return hash;
+	}
+
+	bool find(uint64_t key, Array<char>& data)
+	{
+		const char* dir = directory();
+		if (dir[0] == '\0')
+			return false;
+
+		TempAllocator1024 ta;
+		DynamicString path(ta);
+		entry_path(dir, key, ".bin", path);
+
+		if (!os::exists(path.c_str()))
+			return false;
+
+		DiskFilesystem fs;
+		File* file = fs.open(path.c_str(), FOM_READ);
+		const size_t size = file->size();
+		array::resize(data, size);
+		if (size)
+			file->read(array::begin(data), size);
+		fs.close(file);
+		return true;
+	}
+
+	void store(uint64_t key, const Array<char>& data)
+	{
+		const char* dir = directory();
+		if (dir[0] == '\0')
+			return;
+
+		// Temporaries are unique to the process and to the call
+		char suffix[64];
+		snprintf(suffix, sizeof(suffix), ".%u.%d.tmp", os::process_id(), s_num_temporaries.fetch_add(1));
+
+		TempAllocator1024 ta;
+		DynamicString path(ta);
+		DynamicString tmp_path(ta);
+		entry_path(dir, key, ".bin", path);
+		entry_path(dir, key, suffix, tmp_path);
+
+		// The shader has been compiled already, failing to cache it
+		// only costs compiling it again next time
+		if (!write_file(tmp_path.c_str(), data))
+		{
+			CE_LOGW("Unable to write shader cache entry '%s'", tmp_path.c_str());
+			return;
+		}
+
+		if (!replace_file(tmp_path.c_str(), path.c_str()))
+		{
+			CE_LOGW("Unable to write shader cache entry '%s'", path.c_str());
+			::remove(tmp_path.c_str());
+		}
+	}
+} // namespace shader_cache
+} // namespace crown
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "types.h"
+#include "container_types.h"
+
+namespace crown
+{
+
+/// Content-addressed cache of the shaderc outputs shared by all the
+/// checkouts of the current user.
+///
+/// The cache lives in the directory named by the CROWN_SHADER_CACHE
+/// environment variable or, if it is not set, in CROWN_SHADER_CACHE_DIR
+/// under the user's cache directory ($XDG_CACHE_HOME, $HOME/.cache or
+/// %LOCALAPPDATA%). Setting CROWN_SHADER_CACHE to an empty string disables it.
+/// Entries are written to a temporary file and then renamed, so concurrent
+/// compilers never see a partial entry.
+namespace shader_cache
+{
+	/// Returns whether the cache is available.
+	bool enabled();
+
+	/// Returns the hash of the contents of the shader compiler at @a path.
+	/// The hash is computed once per process.
+	uint64_t compiler_hash(const char* path);
+
+	/// Reads the entry with the given @a key into @a data.
+	/// Returns false if there is no such entry.
+	bool find(uint64_t key, Array<char>& data);
+
+	/// Stores @a data as the entry with the given @a key.
+	/// The entry is not stored, with a warning, if it can not be written.
+	void store(uint64_t key, const Array<char>& data);
+} // namespace shader_cache
+
+} // namespace crown
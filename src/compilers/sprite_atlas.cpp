@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#include "sprite_atlas.h"
+#include "compile_options.h"
+#include "array.h"
+#include "vector.h"
+#include "dynamic_string.h"
+#include "memory.h"
+#include "config.h"
+#include <algorithm>
+
+namespace crown
+{
+namespace sprite_atlas
+{
+	static const uint32_t INVALID = 0xffffffffu;
+	static const uint32_t TGA_HEADER_SIZE = 18;
+
+	// Horizontal segment of the top edge of the packed rectangles
+	struct SkylineNode
+	{
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+	};
+
+	// Tallest first, then widest, then in the order given
+	struct TallerFirst
+	{
+		TallerFirst(const AtlasRect* r) : rects(r) {}
+
+		bool operator()(uint32_t a, uint32_t b) const
+		{
+			if (rects[a].height != rects[b].height)
+				return rects[a].height > rects[b].height;
+			if (rects[a].width != rects[b].width)
+				return rects[a].width > rects[b].width;
+			return a < b;
+		}
+
+		const AtlasRect* rects;
+	};
+
+	// Returns whether a rectangle of w x h fits at the left of the node i
+	// and the lowest y it can be placed at
+	static bool fit(const Array<SkylineNode>& sky, uint32_t i, uint32_t w, uint32_t h, uint32_t atlas_width, uint32_t atlas_height, uint32_t& y)
+	{
+		if (sky[i].x + w > atlas_width)
+			return false;
+
+		// The skyline spans the whole width, the loop stops before its end
+		y = 0;
+		uint32_t left = w;
+		for (uint32_t j = i; left > 0; j++)
+		{
+			y = sky[j].y > y ? sky[j].y : y;
+			left -= sky[j].width < left ? sky[j].width : left;
+		}
+
+		return y + h <= atlas_height;
+	}
+
+	// Raises the skyline to y over [x, x + w)
+	static void add_node(Array<SkylineNode>& sky, Array<SkylineNode>& tmp, uint32_t x, uint32_t y, uint32_t w)
+	{
+		const uint32_t end = x + w;
+		const SkylineNode node = { x, y, w };
+
+		array::clear(tmp);
+		for (uint32_t i = 0; i < array::size(sky); i++)
+		{
+			const SkylineNode& s = sky[i];
+			const uint32_t s_end = s.x + s.width;
+
+			if (s_end <= x || s.x >= end)
+			{
+				array::push_back(tmp, s);
+				continue;
+			}
+
+			if (s.x < x)
+			{
+				const SkylineNode before = { s.x, s.y, x - s.x };
+				array::push_back(tmp, before);
+			}
+			// The node always starts where a segment of the skyline does
+			if (s.x == x)
+				array::push_back(tmp, node);
+			if (s_end > end)
+			{
+				const SkylineNode after = { end, s.y, s_end - end };
+				array::push_back(tmp, after);
+			}
+		}
+
+		// Merge the nodes at the same height
+		array::clear(sky);
+		for (uint32_t i = 0; i < array::size(tmp); i++)
+		{
+			if (!array::empty(sky) && array::back(sky).y == tmp[i].y)
+				array::back(sky).width += tmp[i].width;
+			else
+				array::push_back(sky, tmp[i]);
+		}
+	}
+
+	static bool pack_into(AtlasRect* rects, const uint32_t* order, uint32_t num, uint32_t width, uint32_t height)
+	{
+		Array<SkylineNode> sky(default_allocator());
+		Array<SkylineNode> tmp(default_allocator());
+		const SkylineNode ground = { 0, 0, width };
+		array::push_back(sky, ground);
+
+		for (uint32_t n = 0; n < num; n++)
+		{
+			AtlasRect& r = rects[order[n]];
+
+			// Bottom-left: lowest top edge, then leftmost
+			uint32_t best = INVALID;
+			uint32_t best_y = 0;
+			uint32_t best_top = INVALID;
+			for (uint32_t i = 0; i < array::size(sky); i++)
+			{
+				uint32_t y;
+				if (fit(sky, i, r.width, r.height, width, height, y) && y + r.height < best_top)
+				{
+					best = i;
+					best_y = y;
+					best_top = y + r.height;
+				}
+			}
+
+			if (best == INVALID)
+				return false;
+
+			r.x = sky[best].x;
+			r.y = best_y;
+			add_node(sky, tmp, r.x, r.y + r.height, r.width);
+		}
+
+		return true;
+	}
+
+	static uint32_t next_pow2(uint32_t x)
+	{
+		uint32_t p = 1;
+		while (p < x)
+			p <<= 1;
+		return p;
+	}
+
+	bool pack(AtlasRect* rects, uint32_t num, uint32_t& width, uint32_t& height)
+	{
+		Array<uint32_t> order(default_allocator());
+		array::resize(order, num);
+
+		uint32_t max_width = 1;
+		uint32_t max_height = 1;
+		uint64_t area = 0;
+		for (uint32_t i = 0; i < num; i++)
+		{
+			order[i] = i;
+			max_width = rects[i].width > max_width ? rects[i].width : max_width;
+			max_height = rects[i].height > max_height ? rects[i].height : max_height;
+			area += uint64_t(rects[i].width) * rects[i].height;
+		}
+
+		std::sort(array::begin(order), array::end(order), TallerFirst(rects));
+
+		width = next_pow2(max_width);
+		height = next_pow2(max_height);
+		while (uint64_t(width) * height < area)
+		{
+			if (width <= height)
+				width <<= 1;
+			else
+				height <<= 1;
+		}
+
+		while (width <= CROWN_MAX_ATLAS_SIZE && height <= CROWN_MAX_ATLAS_SIZE)
+		{
+			if (pack_into(rects, array::begin(order), num, width, height))
+				return true;
+
+			if (width <= height)
+				width <<= 1;
+			else
+				height <<= 1;
+		}
+
+		return false;
+	}
+
+	void layout(JSONElement root, CompileOptions& opts, Array<AtlasRect>& rects, uint32_t& width, uint32_t& height)
+	{
+		Vector<DynamicString> images(default_allocator());
+		root.key("atlas").to_array(images);
+		const uint32_t padding = (uint32_t) root.key_or_nil("padding").to_int(CROWN_DEFAULT_ATLAS_PADDING);
+
+		array::resize(rects, vector::size(images));
+		for (uint32_t i = 0; i < vector::size(images); i++)
+		{
+			// Only the size is needed, from the TGA header
+			const char* name = images[i].c_str();
+			CE_ASSERT(images[i].ends_with(".tga"), "Atlas images must be TGA: '%s'", name);
+			Buffer buf = opts.read_header(name);
+			CE_ASSERT(array::size(buf) >= TGA_HEADER_SIZE, "Bad TGA: '%s'", name);
+			const uint8_t* header = (const uint8_t*) array::begin(buf);
+			CE_ASSERT(header[2] == 2 || header[2] == 10, "Atlas images must be true-color TGA: '%s'", name);
+			CE_ASSERT(header[16] == 24 || header[16] == 32, "Atlas images must have 3 or 4 channels: '%s'", name);
+
+			rects[i].x = 0;
+			rects[i].y = 0;
+			rects[i].width = uint32_t(header[12] | (header[13] << 8)) + padding * 2;
+			rects[i].height = uint32_t(header[14] | (header[15] << 8)) + padding * 2;
+		}
+
+		const bool fits = pack(array::begin(rects), array::size(rects), width, height);
+		CE_ASSERT(fits, "Atlas larger than %dx%d", CROWN_MAX_ATLAS_SIZE, CROWN_MAX_ATLAS_SIZE);
+		CE_UNUSED(fits);
+
+		for (uint32_t i = 0; i < array::size(rects); i++)
+		{
+			rects[i].x += padding;
+			rects[i].y += padding;
+			rects[i].width -= padding * 2;
+			rects[i].height -= padding * 2;
+		}
+	}
+} // namespace sprite_atlas
+} // namespace crown
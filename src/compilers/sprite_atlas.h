@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "types.h"
+#include "compiler_types.h"
+#include "container_types.h"
+#include "json_parser.h"
+
+namespace crown
+{
+
+struct AtlasRect
+{
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+};
+
+/// Functions to pack the images of many sprites into a single texture.
+///
+/// A texture resource becomes an atlas by listing its images instead of a single source:
+///   atlas = [ "ui/button.tga" "ui/icon.tga" ]
+///   padding = 2 // Optional, texels around each image
+/// Sprites then refer to the atlas and to their image in it:
+///   texture = "ui/atlas"
+///   image = "ui/button.tga"
+/// Both the texture and the sprite compilers pack the images the same way,
+/// so the sprite UVs always match the atlas they were compiled against.
+namespace sprite_atlas
+{
+	/// Packs the @a num rectangles of the given width and height with the
+	/// skyline bottom-left heuristic, tallest first, and sets their x and y.
+	/// The size of the atlas is the smallest power of two which fits them all.
+	/// Returns false if it would be larger than CROWN_MAX_ATLAS_SIZE.
+	bool pack(AtlasRect* rects, uint32_t num, uint32_t& width, uint32_t& height);
+
+	/// Packs the images listed in the "atlas" key of the texture @a root.
+	/// The i-th element of @a rects is set to the area covered by the i-th image,
+	/// not including its padding.
+	/// The images must be 24 or 32 bits TGA, only their headers are read.
+	void layout(JSONElement root, CompileOptions& opts, Array<AtlasRect>& rects, uint32_t& width, uint32_t& height);
+} // namespace sprite_atlas
+
+} // namespace crown
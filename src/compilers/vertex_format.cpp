@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#include "vertex_format.h"
+#include "compile_options.h"
+#include "dynamic_string.h"
+#include "temp_allocator.h"
+#include "string_utils.h"
+#include "vector3.h"
+#include <math.h> // fabsf, floorf
+#include <string.h> // memcpy
+
+namespace crown
+{
+namespace vertex_format
+{
+	static const char* s_names[VertexFormat::COUNT] =
+	{
+		"float",
+		"half",
+		"int16",
+		"octahedral"
+	};
+
+	VertexFormat::Enum read(JSONElement root, const char* key)
+	{
+		if (!root.has_key(key))
+			return VertexFormat::FLOAT;
+
+		TempAllocator64 ta;
+		DynamicString name(ta);
+		root.key(key).to_string(name);
+
+		for (uint32_t i = 0; i < VertexFormat::COUNT; i++)
+		{
+			if (strcmp(name.c_str(), s_names[i]) == 0)
+				return (VertexFormat::Enum)i;
+		}
+
+		CE_ASSERT(false, "Unknown vertex format '%s'", name.c_str());
+		return VertexFormat::FLOAT;
+	}
+
+	void add(bgfx::VertexDecl& decl, bgfx::Attrib::Enum attrib, uint8_t num, VertexFormat::Enum format)
+	{
+		switch (format)
+		{
+			case VertexFormat::FLOAT: decl.add(attrib, num, bgfx::AttribType::Float); break;
+			case VertexFormat::HALF: decl.add(attrib, num == 3 ? 4 : num, bgfx::AttribType::Half); break;
+			case VertexFormat::INT16: decl.add(attrib, num == 3 ? 4 : num, bgfx::AttribType::Int16, true); break;
+			case VertexFormat::OCTAHEDRAL: decl.add(attrib, 2, bgfx::AttribType::Uint8, true); break;
+			default: CE_ASSERT(false, "Unknown vertex format"); break;
+		}
+	}
+
+	void write(CompileOptions& opts, const float* data, uint8_t num, VertexFormat::Enum format)
+	{
+		switch (format)
+		{
+			case VertexFormat::FLOAT:
+			{
+				opts.write(data, num * sizeof(float));
+				break;
+			}
+			case VertexFormat::HALF:
+			{
+				for (uint8_t i = 0; i < num; i++)
+					opts.write(half(data[i]));
+				if (num == 3)
+					opts.write(half(1.0f));
+				break;
+			}
+			case VertexFormat::INT16:
+			{
+				for (uint8_t i = 0; i < num; i++)
+				{
+					// Allow for the rounding errors of the normalization
+					CE_ASSERT(fabsf(data[i]) <= 1.0001f, "Value out of range for int16: %f", data[i]);
+					opts.write(snorm16(data[i]));
+				}
+				if (num == 3)
+					opts.write(snorm16(1.0f));
+				break;
+			}
+			case VertexFormat::OCTAHEDRAL:
+			{
+				CE_ASSERT(num == 3, "Octahedral format requires 3 components");
+				uint8_t x;
+				uint8_t y;
+				octahedral(vector3(data[0], data[1], data[2]), x, y);
+				opts.write(x);
+				opts.write(y);
+				break;
+			}
+			default:
+			{
+				CE_ASSERT(false, "Unknown vertex format");
+				break;
+			}
+		}
+	}
+
+	uint16_t half(float f)
+	{
+		uint32_t u;
+		memcpy(&u, &f, sizeof(u));
+
+		const uint32_t sign = (u >> 16) & 0x8000;
+		const int32_t exp = int32_t((u >> 23) & 0xff) - 127 + 15;
+		uint32_t mant = u & 0x7fffff;
+
+		// Infinity and NaN
+		if ((u & 0x7fffffff) >= 0x7f800000)
+			return uint16_t(sign | 0x7c00 | (mant != 0 ? 0x200 : 0));
+
+		// Too large, infinity
+		if (exp >= 31)
+			return uint16_t(sign | 0x7c00);
+
+		// Denormal or zero
+		if (exp <= 0)
+		{
+			if (exp < -10)
+				return uint16_t(sign);
+
+			mant |= 0x800000;
+			const uint32_t shift = uint32_t(14 - exp);
+			uint32_t h = mant >> shift;
+			if ((mant >> (shift - 1)) & 1)
+				h++;
+			return uint16_t(sign | h);
+		}
+
+		// Rounding may carry into the exponent, which is what we want
+		uint32_t h = sign | (uint32_t(exp) << 10) | (mant >> 13);
+		if (mant & 0x1000)
+			h++;
+		return uint16_t(h);
+	}
+
+	int16_t snorm16(float f)
+	{
+		f = f < -1.0f ? -1.0f : (f > 1.0f ? 1.0f : f);
+		return int16_t(floorf(f * 32767.0f + 0.5f));
+	}
+
+	void octahedral(const Vector3& n, uint8_t& x, uint8_t& y)
+	{
+		const float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+		float ox = l1 > 0.0f ? n.x / l1 : 0.0f;
+		float oy = l1 > 0.0f ? n.y / l1 : 0.0f;
+
+		// Fold the lower hemisphere over the diagonals
+		if (n.z < 0.0f)
+		{
+			const float fx = (1.0f - fabsf(oy)) * (ox >= 0.0f ? 1.0f : -1.0f);
+			const float fy = (1.0f - fabsf(ox)) * (oy >= 0.0f ? 1.0f : -1.0f);
+			ox = fx;
+			oy = fy;
+		}
+
+		x = uint8_t(floorf((ox * 0.5f + 0.5f) * 255.0f + 0.5f));
+		y = uint8_t(floorf((oy * 0.5f + 0.5f) * 255.0f + 0.5f));
+	}
+} // namespace vertex_format
+} // namespace crown
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "types.h"
+#include "math_types.h"
+#include "compiler_types.h"
+#include "json_parser.h"
+#include <bgfx.h>
+
+namespace crown
+{
+
+/// Enumerates the formats of the vertex attributes written by the compilers.
+///
+/// HALF and INT16 attributes of three components are padded to four,
+/// the padding is 1.0.
+struct VertexFormat
+{
+	enum Enum
+	{
+		FLOAT,      // 32-bit floats
+		HALF,       // 16-bit floats
+		INT16,      // 16-bit integers normalized to [-1, 1]
+		OCTAHEDRAL, // Unit vectors in two 8-bit integers normalized to [0, 1], see vertex_format::octahedral()
+
+		COUNT
+	};
+};
+
+/// Functions to write quantized vertex attributes.
+namespace vertex_format
+{
+	/// Returns the format of the attribute named @a key in @a root,
+	/// "float", "half", "int16" or "octahedral". Defaults to VertexFormat::FLOAT.
+	VertexFormat::Enum read(JSONElement root, const char* key);
+
+	/// Adds to @a decl the attribute @a attrib of @a num components in the given @a format.
+	void add(bgfx::VertexDecl& decl, bgfx::Attrib::Enum attrib, uint8_t num, VertexFormat::Enum format);
+
+	/// Writes the @a num components of @a data in the given @a format.
+	/// INT16 components must be in [-1, 1], OCTAHEDRAL data must be a unit vector.
+	void write(CompileOptions& opts, const float* data, uint8_t num, VertexFormat::Enum format);
+
+	/// Returns the 16-bit float nearest to @a f.
+	uint16_t half(float f);
+
+	/// Returns the 16-bit integer representing @a f in [-1, 1].
+	int16_t snorm16(float f);
+
+	/// Encodes the unit vector @a n in two 8-bit integers by projecting it
+	/// on the octahedron |x| + |y| + |z| = 1, which is then unfolded on the plane z = 0.
+	/// To decode in [0, 1] coordinates e = (x, y):
+	///   e = e * 2.0 - 1.0;
+	///   n = vec3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+	///   if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * sign(n.xy);
+	///   n = normalize(n);
+	void octahedral(const Vector3& n, uint8_t& x, uint8_t& y);
+} // namespace vertex_format
+
+} // namespace crown
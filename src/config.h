@@ -58,10 +58,58 @@
 	#define CROWN_DEFAULT_CONSOLE_PORT 10001
 #endif // CROWN_DEFAULT_CONSOLE_PORT
 
+#ifndef CROWN_DEFAULT_FILE_SERVER_PORT
+	#define CROWN_DEFAULT_FILE_SERVER_PORT 10002
+#endif // CROWN_DEFAULT_FILE_SERVER_PORT
+
 #ifndef CROWN_DATA_DIRECTORY
 	#define CROWN_DATA_DIRECTORY "data"
 #endif // CROWN_DATA_DIRECTORY
 
+#ifndef CROWN_DEFAULT_LOADER_THREADS
+	#define CROWN_DEFAULT_LOADER_THREADS 2
+#endif // CROWN_DEFAULT_LOADER_THREADS
+
+#ifndef CROWN_MAX_LOADER_THREADS
+	#define CROWN_MAX_LOADER_THREADS 16
+#endif // CROWN_MAX_LOADER_THREADS
+
+#ifndef CROWN_DEFAULT_READ_AHEAD
+	#define CROWN_DEFAULT_READ_AHEAD (8*1024*1024)
+#endif // CROWN_DEFAULT_READ_AHEAD
+
+#ifndef CROWN_BUNDLE_ARCHIVE
+	#define CROWN_BUNDLE_ARCHIVE "data.bundle"
+#endif // CROWN_BUNDLE_ARCHIVE
+
+#ifndef CROWN_BUILD_DATABASE
+	#define CROWN_BUILD_DATABASE "build.db"
+#endif // CROWN_BUILD_DATABASE
+
+#ifndef CROWN_SHADER_CACHE_DIR
+	#define CROWN_SHADER_CACHE_DIR "crown/shaderc" // Relative to the user's cache directory
+#endif // CROWN_SHADER_CACHE_DIR
+
+#ifndef CROWN_MAX_COMPILER_THREADS
+	#define CROWN_MAX_COMPILER_THREADS 32
+#endif // CROWN_MAX_COMPILER_THREADS
+
+#ifndef CROWN_MAX_ATLAS_SIZE
+	#define CROWN_MAX_ATLAS_SIZE 4096 // Texels per side
+#endif // CROWN_MAX_ATLAS_SIZE
+
+#ifndef CROWN_DEFAULT_ATLAS_PADDING
+	#define CROWN_DEFAULT_ATLAS_PADDING 2 // Texels around each image
+#endif // CROWN_DEFAULT_ATLAS_PADDING
+
+#ifndef CROWN_BUNDLE_ALIGNMENT
+	#define CROWN_BUNDLE_ALIGNMENT 16
+#endif // CROWN_BUNDLE_ALIGNMENT
+
+#ifndef CROWN_COMPRESSION_BLOCK_SIZE
+	#define CROWN_COMPRESSION_BLOCK_SIZE (64*1024)
+#endif // CROWN_COMPRESSION_BLOCK_SIZE
+
 #ifndef CE_MAX_UNITS
 	#define CE_MAX_UNITS 65000 // Per world
 #endif // CE_MAX_UNITS
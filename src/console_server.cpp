@@ -12,6 +12,7 @@
 #include "dynamic_string.h"
 #include "json.h"
 #include "map.h"
+#include "resource_manager.h"
 
 namespace crown
 {
@@ -183,7 +184,7 @@ void ConsoleServer::process_script(TCPSocket /*client*/, const char* json)
 	device()->lua_environment()->execute_string(script.c_str());
 }
 
-void ConsoleServer::process_command(TCPSocket /*client*/, const char* json)
+void ConsoleServer::process_command(TCPSocket client, const char* json)
 {
 	TempAllocator4096 ta;
 	Map<DynamicString, const char*> root(ta);
@@ -209,6 +210,18 @@ void ConsoleServer::process_command(TCPSocket /*client*/, const char* json)
 	{
 		device()->unpause();
 	}
+	else if (cmd == "resource_stats")
+	{
+		using namespace string_stream;
+		TempAllocator4096 alloc;
+		StringStream stats(alloc);
+
+		stats << "{\"type\":\"resource_stats\",\"types\":";
+		device()->resource_manager()->load_stats().to_json(stats);
+		stats << "}";
+
+		send(client, c_str(stats));
+	}
 }
 
 namespace console_server_globals
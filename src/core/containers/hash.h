@@ -155,13 +155,18 @@ namespace crown {
 				return;
 			}
 
-			h._data[fr.data_i] = h._data[array::size(h._data) - 1];
-			FindResult last = find(h, h._data[fr.data_i].key);
+			// Look the last entry up by address rather than by key,
+			// in a multi-hash the key alone could match another entry.
+			const uint32_t last_i = array::size(h._data) - 1;
+			FindResult last = find(h, &h._data[last_i]);
+			h._data[fr.data_i] = h._data[last_i];
 
 			if (last.data_prev != END_OF_LIST)
 				h._data[last.data_prev].next = fr.data_i;
 			else
 				h._hash[last.hash_i] = fr.data_i;
+
+			array::pop_back(h._data);
 		}
 
 		template<typename T> uint32_t find_or_fail(const Hash<T> &h, uint64_t key)
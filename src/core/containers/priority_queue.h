@@ -17,6 +17,12 @@ namespace crown
 /// @ingroup Containers
 namespace priority_queue
 {
+	/// Returns the number of items in the queue.
+	template <typename T> uint32_t size(const PriorityQueue<T>& q);
+
+	/// Returns whether the queue is empty.
+	template <typename T> bool empty(const PriorityQueue<T>& q);
+
 	/// Returns the first item in the queue.
 	template <typename T> const T& top(const PriorityQueue<T>& q);
 
@@ -29,6 +35,18 @@ namespace priority_queue
 
 namespace priority_queue
 {
+	template <typename T>
+	uint32_t size(const PriorityQueue<T>& q)
+	{
+		return array::size(q._queue);
+	}
+
+	template <typename T>
+	bool empty(const PriorityQueue<T>& q)
+	{
+		return array::empty(q._queue);
+	}
+
 	template <typename T>
 	const T& top(const PriorityQueue<T>& q)
 	{
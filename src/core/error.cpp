@@ -5,6 +5,7 @@
 
 #include "error.h"
 #include "stacktrace.h"
+#include "macros.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
@@ -13,8 +14,23 @@ namespace crown
 {
 namespace error
 {
+	static CE_THREAD AbortFunction s_abort_function = NULL;
+	static CE_THREAD void* s_abort_data = NULL;
+
 	void abort(const char* file, int line, const char* message, ...)
 	{
+		if (s_abort_function != NULL)
+		{
+			char buf[1024];
+			va_list ap;
+			va_start(ap, message);
+			const int len = vsnprintf(buf, sizeof(buf), message, ap);
+			va_end(ap);
+			if (len >= 0 && len < (int)sizeof(buf))
+				snprintf(buf + len, sizeof(buf) - len, "\tIn: %s:%d\n", file, line);
+			s_abort_function(buf, s_abort_data);
+		}
+
 		va_list ap;
 		va_start(ap, message);
 		vprintf(message, ap);
@@ -24,5 +40,11 @@ namespace error
 		stacktrace();
 		exit(EXIT_FAILURE);
 	}
+
+	void set_abort_function(AbortFunction func, void* user_data)
+	{
+		s_abort_function = func;
+		s_abort_data = user_data;
+	}
 } // namespace error
 } // namespace crown
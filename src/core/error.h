@@ -9,9 +9,17 @@ namespace crown
 {
 namespace error
 {
+	/// Function called by abort() in place of terminating the program.
+	/// It receives the formatted error @a message and must not return.
+	typedef void (*AbortFunction)(const char* message, void* user_data);
+
 	/// Aborts the program execution logging an error message and the stacktrace if
 	/// the platform supports it.
 	void abort(const char* file, int line, const char* message, ...);
+
+	/// Makes abort() call @a func on the calling thread instead of terminating
+	/// the program. Passing NULL restores the default behavior.
+	void set_abort_function(AbortFunction func, void* user_data);
 } // namespace error
 } // namespace crown
 
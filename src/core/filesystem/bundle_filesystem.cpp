@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#include "bundle_filesystem.h"
+#include "memory_file.h"
+#include "memory.h"
+#include "string_utils.h"
+#include "vector.h"
+#include "log.h"
+#include <algorithm>
+#include <stdlib.h> // strtoull
+#include <string.h> // memcpy
+
+namespace crown
+{
+
+/// File inside a bundle archive.
+/// Its data lives as long as the BundleFilesystem it comes from.
+class BundleFile : public MemoryFile
+{
+public:
+
+	BundleFile(const void* data, size_t size)
+		: MemoryFile(data, size)
+	{
+	}
+
+	/// @copydoc File::mapped_data()
+	const void* mapped_data()
+	{
+		return data();
+	}
+};
+
+namespace bundle
+{
+	static bool parse_id(const char* str, StringId64& id)
+	{
+		char buf[17];
+		memcpy(buf, str, 16);
+		buf[16] = '\0';
+
+		char* end = NULL;
+		id = StringId64((uint64_t)strtoull(buf, &end, 16));
+		return end == buf + 16;
+	}
+
+	bool parse_resource_path(const char* path, StringId64& type, StringId64& name)
+	{
+		const size_t dir_len = strlen(CROWN_DATA_DIRECTORY);
+
+		// The paths are built with path::join(), the separator depends on the platform
+		if (strncmp(path, CROWN_DATA_DIRECTORY, dir_len) != 0 || (path[dir_len] != '/' && path[dir_len] != '\\'))
+			return false;
+
+		const char* res = path + dir_len + 1;
+		if (strlen(res) != 33 || res[16] != '-')
+			return false;
+
+		return parse_id(res, type) && parse_id(res + 17, name);
+	}
+} // namespace bundle
+
+BundleFilesystem::BundleFilesystem(const char* path)
+	: _mapping(path)
+	, _entries(NULL)
+	, _num_entries(0)
+{
+	const uint64_t size = _mapping.size();
+	const BundleHeader* header = (const BundleHeader*)_mapping.data();
+
+	if (size < sizeof(BundleHeader) || header->magic != BUNDLE_MAGIC)
+	{
+		CE_LOGW("Bad bundle: %s", path);
+		return;
+	}
+
+	if (header->version != BUNDLE_VERSION)
+	{
+		CE_LOGW("Wrong bundle version: %s", path);
+		return;
+	}
+
+	// The archive might be truncated or stale, never trust its contents
+	const BundleEntry* entries = (const BundleEntry*)(header + 1);
+	const uint64_t data_offset = sizeof(BundleHeader) + uint64_t(header->num_entries) * sizeof(BundleEntry);
+	bool ok = data_offset <= size;
+
+	for (uint32_t i = 0; ok && i < header->num_entries; i++)
+	{
+		const BundleEntry& e = entries[i];
+		ok = e.offset >= data_offset
+			&& e.offset <= size
+			&& e.size <= size - e.offset
+			&& (i == 0 || entries[i - 1] < e);
+	}
+
+	if (!ok)
+	{
+		CE_LOGW("Bad bundle: %s", path);
+		return;
+	}
+
+	_entries = entries;
+	_num_entries = header->num_entries;
+}
+
+bool BundleFilesystem::is_valid() const
+{
+	return _entries != NULL;
+}
+
+File* BundleFilesystem::open(const char* path, FileOpenMode mode)
+{
+	CE_ASSERT_NOT_NULL(path);
+	CE_ASSERT(mode == FOM_READ, "Bundle is read-only");
+	CE_UNUSED(mode);
+
+	const BundleEntry* entry = find(path);
+	CE_ASSERT(entry != NULL, "Resource not in bundle: %s", path);
+
+	return CE_NEW(default_allocator(), BundleFile)(data(*entry), entry->size);
+}
+
+void BundleFilesystem::close(File* file)
+{
+	CE_ASSERT_NOT_NULL(file);
+
+	CE_DELETE(default_allocator(), file);
+}
+
+bool BundleFilesystem::exists(const char* path)
+{
+	return is_directory(path) || is_file(path);
+}
+
+bool BundleFilesystem::is_directory(const char* path)
+{
+	CE_ASSERT_NOT_NULL(path);
+
+	return strcmp(path, CROWN_DATA_DIRECTORY) == 0;
+}
+
+bool BundleFilesystem::is_file(const char* path)
+{
+	CE_ASSERT_NOT_NULL(path);
+
+	return find(path) != NULL;
+}
+
+void BundleFilesystem::create_directory(const char* /*path*/)
+{
+	CE_FATAL("Bundle is read-only");
+}
+
+void BundleFilesystem::delete_directory(const char* /*path*/)
+{
+	CE_FATAL("Bundle is read-only");
+}
+
+void BundleFilesystem::create_file(const char* /*path*/)
+{
+	CE_FATAL("Bundle is read-only");
+}
+
+void BundleFilesystem::delete_file(const char* /*path*/)
+{
+	CE_FATAL("Bundle is read-only");
+}
+
+void BundleFilesystem::list_files(const char* path, Vector<DynamicString>& files)
+{
+	CE_ASSERT_NOT_NULL(path);
+
+	if (!is_directory(path))
+		return;
+
+	for (uint32_t i = 0; i < _num_entries; i++)
+	{
+		char res_name[1 + 2*StringId64::STRING_LENGTH];
+		StringId64(_entries[i].type).to_string(res_name);
+		res_name[16] = '-';
+		StringId64(_entries[i].name).to_string(res_name + 17);
+
+		DynamicString filename(default_allocator());
+		filename = res_name;
+		vector::push_back(files, filename);
+	}
+}
+
+void BundleFilesystem::get_absolute_path(const char* path, DynamicString& os_path)
+{
+	os_path = path;
+}
+
+uint64_t BundleFilesystem::storage_order(const char* path)
+{
+	CE_ASSERT_NOT_NULL(path);
+
+	const BundleEntry* entry = find(path);
+	return entry != NULL ? entry->offset : 0;
+}
+
+void BundleFilesystem::prefetch(const char* path)
+{
+	CE_ASSERT_NOT_NULL(path);
+
+	const BundleEntry* entry = find(path);
+	if (entry != NULL)
+		_mapping.prefetch((size_t)entry->offset, entry->size);
+}
+
+const BundleEntry* BundleFilesystem::find(StringId64 type, StringId64 name) const
+{
+	BundleEntry key;
+	key.type = type.id();
+	key.name = name.id();
+
+	const BundleEntry* end = _entries + _num_entries;
+	const BundleEntry* e = std::lower_bound(_entries, end, key);
+
+	return (e != end && e->type == key.type && e->name == key.name) ? e : NULL;
+}
+
+const char* BundleFilesystem::data(const BundleEntry& entry) const
+{
+	return _mapping.data() + entry.offset;
+}
+
+const BundleEntry* BundleFilesystem::find(const char* path) const
+{
+	StringId64 type;
+	StringId64 name;
+
+	if (!bundle::parse_resource_path(path, type, name))
+		return NULL;
+
+	return find(type, name);
+}
+
+} // namespace crown
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "filesystem.h"
+#include "os_file_mapping.h"
+
+#define BUNDLE_MAGIC   uint32_t(0x4e425243) // "CRBN"
+#define BUNDLE_VERSION uint32_t(1)
+
+namespace crown
+{
+
+/// Header of a bundle archive.
+/// It is followed by BundleHeader::num_entries BundleEntry sorted
+/// by (type, name) and then by the data of the resources.
+///
+/// @ingroup Filesystem
+struct BundleHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t num_entries;
+	uint32_t pad;
+};
+
+/// Location of a compiled resource inside a bundle archive.
+///
+/// @ingroup Filesystem
+struct BundleEntry
+{
+	uint64_t type;
+	uint64_t name;
+	uint64_t offset; // From the start of the archive
+	uint32_t size;
+	uint32_t alignment;
+};
+
+inline bool operator<(const BundleEntry& a, const BundleEntry& b)
+{
+	return a.type < b.type || (a.type == b.type && a.name < b.name);
+}
+
+/// Serves compiled resources out of a memory-mapped bundle archive.
+/// Resources are accessed with the same paths used by the loader
+/// when reading from disk (i.e. "data/<type>-<name>") and reads
+/// never touch the operating system.
+/// The archive is read-only.
+///
+/// @ingroup Filesystem
+class BundleFilesystem : public Filesystem
+{
+public:
+
+	/// Maps the bundle archive located at the absolute @a path.
+	/// If the archive is damaged it is served as empty, see is_valid().
+	BundleFilesystem(const char* path);
+
+	/// Returns whether the archive has been mapped and its header and
+	/// entries are consistent with its size.
+	bool is_valid() const;
+
+	/// @copydoc Filesystem::open()
+	/// @note
+	/// @a mode can only be FOM_READ
+	File* open(const char* path, FileOpenMode mode);
+
+	/// @copydoc Filesystem::close()
+	void close(File* file);
+
+	/// @copydoc Filesystem::exists()
+	bool exists(const char* path);
+
+	/// @copydoc Filesystem::is_directory()
+	bool is_directory(const char* path);
+
+	/// @copydoc Filesystem::is_file()
+	bool is_file(const char* path);
+
+	/// Not supported, the archive is read-only.
+	void create_directory(const char* path);
+
+	/// Not supported, the archive is read-only.
+	void delete_directory(const char* path);
+
+	/// Not supported, the archive is read-only.
+	void create_file(const char* path);
+
+	/// Not supported, the archive is read-only.
+	void delete_file(const char* path);
+
+	/// @copydoc Filesystem::list_files()
+	void list_files(const char* path, Vector<DynamicString>& files);
+
+	/// Returns @a path unchanged.
+	void get_absolute_path(const char* path, DynamicString& os_path);
+
+	/// Returns the offset of @a path in the archive.
+	uint64_t storage_order(const char* path);
+
+	/// Pages in the data of @a path in the background.
+	void prefetch(const char* path);
+
+	/// Returns the entry of the resource (@a type, @a name) or NULL
+	/// if the archive does not contain it.
+	const BundleEntry* find(StringId64 type, StringId64 name) const;
+
+	/// Returns the data of the resource described by @a entry.
+	const char* data(const BundleEntry& entry) const;
+
+private:
+
+	const BundleEntry* find(const char* path) const;
+
+private:
+
+	OsFileMapping _mapping;
+	const BundleEntry* _entries;
+	uint32_t _num_entries;
+};
+
+namespace bundle
+{
+	/// Parses a resource path in the form "data/<type>-<name>".
+	/// Both '/' and '\\' are accepted as separator.
+	/// Returns false if @a path is not a resource path.
+	bool parse_resource_path(const char* path, StringId64& type, StringId64& name);
+} // namespace bundle
+
+} // namespace crown
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#include "compressed_file.h"
+#include "config.h"
+#include "error.h"
+#include "lz4.h"
+#include "allocator.h"
+#include "array.h"
+#include "math_utils.h"
+#include <string.h> // memcpy
+
+namespace crown
+{
+
+CompressedFile::CompressedFile(File& file, Allocator& a)
+	: File(FOM_READ)
+	, _file(file)
+	, _allocator(a)
+	, _num_blocks(0)
+	, _offsets(NULL)
+	, _compressed(NULL)
+	, _block(NULL)
+	, _block_index(NO_BLOCK)
+	, _position(0)
+{
+	_file.read(&_header, sizeof(_header));
+	CE_ASSERT(_header.magic == COMPRESSED_MAGIC, "Wrong magic number");
+	CE_ASSERT(_header.codec == CompressionCodec::LZ4, "Unknown codec: %d", _header.codec);
+	CE_ASSERT(_header.block_size > 0, "Bad block size");
+
+	_num_blocks = (_header.size + _header.block_size - 1) / _header.block_size;
+
+	_offsets = (uint32_t*) _allocator.allocate(sizeof(uint32_t) * (_num_blocks + 1));
+	_file.read(_offsets, sizeof(uint32_t) * _num_blocks);
+
+	// Turn block sizes into offsets
+	uint32_t offset = (uint32_t)_file.position();
+	for (uint32_t i = 0; i < _num_blocks; i++)
+	{
+		const uint32_t size = _offsets[i];
+		_offsets[i] = offset;
+		offset += size;
+	}
+	_offsets[_num_blocks] = offset;
+
+	_compressed = (char*) _allocator.allocate(lz4::compress_bound(_header.block_size));
+	_block = (char*) _allocator.allocate(_header.block_size);
+}
+
+CompressedFile::~CompressedFile()
+{
+	_allocator.deallocate(_block);
+	_allocator.deallocate(_compressed);
+	_allocator.deallocate(_offsets);
+}
+
+void CompressedFile::seek(size_t position)
+{
+	CE_ASSERT(position <= _header.size, "Seek out of bounds");
+	_position = position;
+}
+
+void CompressedFile::seek_to_end()
+{
+	_position = _header.size;
+}
+
+void CompressedFile::skip(size_t bytes)
+{
+	seek(_position + bytes);
+}
+
+void CompressedFile::read(void* buffer, size_t size)
+{
+	CE_ASSERT(_position + size <= _header.size, "Read out of bounds");
+	char* dst = (char*) buffer;
+
+	while (size > 0)
+	{
+		const uint32_t i = uint32_t(_position / _header.block_size);
+		const uint32_t offset = uint32_t(_position % _header.block_size);
+		const uint32_t block_size = this->block_size(i);
+		const uint32_t num = (uint32_t) min(size, size_t(block_size - offset));
+
+		if (offset == 0 && num == block_size && i != _block_index)
+		{
+			decompress_block(i, dst);
+		}
+		else
+		{
+			if (i != _block_index)
+			{
+				decompress_block(i, _block);
+				_block_index = i;
+			}
+			memcpy(dst, _block + offset, num);
+		}
+
+		dst += num;
+		size -= num;
+		_position += num;
+	}
+}
+
+void CompressedFile::write(const void* /*buffer*/, size_t /*size*/)
+{
+	CE_FATAL("CompressedFile is read-only");
+}
+
+bool CompressedFile::copy_to(File& file, size_t size)
+{
+	const size_t num = min(size, _header.size - _position);
+	char* buf = (char*) _allocator.allocate(_header.block_size);
+
+	for (size_t left = num; left > 0; )
+	{
+		const size_t chunk = min(left, size_t(_header.block_size));
+		read(buf, chunk);
+		file.write(buf, chunk);
+		left -= chunk;
+	}
+
+	_allocator.deallocate(buf);
+	return num == size;
+}
+
+void CompressedFile::flush()
+{
+}
+
+bool CompressedFile::is_valid()
+{
+	return _file.is_valid();
+}
+
+bool CompressedFile::end_of_file()
+{
+	return _position == _header.size;
+}
+
+size_t CompressedFile::size()
+{
+	return _header.size;
+}
+
+size_t CompressedFile::position()
+{
+	return _position;
+}
+
+bool CompressedFile::can_read() const
+{
+	return true;
+}
+
+bool CompressedFile::can_write() const
+{
+	return false;
+}
+
+bool CompressedFile::can_seek() const
+{
+	return true;
+}
+
+uint32_t CompressedFile::block_size(uint32_t i) const
+{
+	return min(_header.block_size, _header.size - i * _header.block_size);
+}
+
+void CompressedFile::decompress_block(uint32_t i, char* dst)
+{
+	const uint32_t size = _offsets[i + 1] - _offsets[i];
+	const uint32_t block_size = this->block_size(i);
+
+	_file.seek(_offsets[i]);
+
+	if (size == block_size)
+	{
+		// Stored raw
+		_file.read(dst, size);
+		return;
+	}
+
+	_file.read(_compressed, size);
+	const bool ok = lz4::decompress(_compressed, size, dst, block_size);
+	CE_ASSERT(ok, "Corrupted block: %d", i);
+	CE_UNUSED(ok);
+}
+
+namespace compressed_file
+{
+	static bool read_header(File& file, CompressedHeader& header)
+	{
+		const size_t pos = file.position();
+		if (file.size() - pos < sizeof(header))
+			return false;
+
+		file.read(&header, sizeof(header));
+		file.seek(pos);
+		return header.magic == COMPRESSED_MAGIC;
+	}
+
+	bool is_compressed(File& file)
+	{
+		CompressedHeader header;
+		return read_header(file, header);
+	}
+
+	size_t uncompressed_size(File& file)
+	{
+		CompressedHeader header;
+		return read_header(file, header) ? header.size : file.size() - file.position();
+	}
+
+	void compress(const void* data, uint32_t size, CompressionCodec::Enum codec, Array<char>& output)
+	{
+		CE_ASSERT(codec == CompressionCodec::LZ4, "Unknown codec: %d", codec);
+
+		const uint32_t block_size = CROWN_COMPRESSION_BLOCK_SIZE;
+		const uint32_t num_blocks = (size + block_size - 1) / block_size;
+
+		CompressedHeader header;
+		header.magic = COMPRESSED_MAGIC;
+		header.codec = codec;
+		header.size = size;
+		header.block_size = block_size;
+		array::push(output, (const char*)&header, sizeof(header));
+
+		const uint32_t sizes_offset = array::size(output);
+		array::resize(output, sizes_offset + num_blocks * sizeof(uint32_t));
+
+		const char* src = (const char*)data;
+		for (uint32_t i = 0; i < num_blocks; i++)
+		{
+			const uint32_t src_size = min(block_size, size - i * block_size);
+			const uint32_t offset = array::size(output);
+			array::resize(output, offset + lz4::compress_bound(src_size));
+
+			uint32_t dst_size = lz4::compress(src + i * block_size, src_size, &output[offset]);
+			if (dst_size >= src_size)
+			{
+				// Store the block raw
+				memcpy(&output[offset], src + i * block_size, src_size);
+				dst_size = src_size;
+			}
+
+			array::resize(output, offset + dst_size);
+			memcpy(&output[sizes_offset + i * sizeof(uint32_t)], &dst_size, sizeof(dst_size));
+		}
+	}
+} // namespace compressed_file
+
+} // namespace crown
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "file.h"
+#include "container_types.h"
+#include "memory_types.h"
+
+namespace crown
+{
+
+#define COMPRESSED_MAGIC 0x5a524343 // 'CCRZ'
+
+/// Enumerates the codecs of compressed files.
+struct CompressionCodec
+{
+	enum Enum
+	{
+		LZ4,
+
+		COUNT
+	};
+};
+
+/// Header of a compressed file.
+/// It is followed by the compressed size of each block and then
+/// by the blocks themselves. Blocks which do not compress are stored raw.
+struct CompressedHeader
+{
+	uint32_t magic;
+	uint32_t codec;      // CompressionCodec::Enum
+	uint32_t size;       // Size of the uncompressed data
+	uint32_t block_size; // Size of the uncompressed blocks
+};
+
+/// Read-only view of a compressed file.
+/// Blocks are decompressed on demand, straight into the
+/// destination buffer when a read covers a whole block.
+///
+/// @ingroup Filesystem
+class CompressedFile : public File
+{
+public:
+
+	/// Reads the compressed data from @a file, which must be
+	/// positioned at the beginning of a CompressedHeader.
+	/// @a a is used to allocate the decompression buffers.
+	CompressedFile(File& file, Allocator& a);
+	~CompressedFile();
+
+	/// @copydoc File::seek()
+	void seek(size_t position);
+
+	/// @copydoc File::seek_to_end()
+	void seek_to_end();
+
+	/// @copydoc File::skip()
+	void skip(size_t bytes);
+
+	/// @copydoc File::read()
+	void read(void* buffer, size_t size);
+
+	/// @copydoc File::write()
+	/// @note
+	/// CompressedFile is read-only.
+	void write(const void* buffer, size_t size);
+
+	/// @copydoc File::copy_to()
+	bool copy_to(File& file, size_t size = 0);
+
+	/// @copydoc File::flush()
+	void flush();
+
+	/// @copydoc File::is_valid()
+	bool is_valid();
+
+	/// @copydoc File::end_of_file()
+	bool end_of_file();
+
+	/// @copydoc File::size()
+	size_t size();
+
+	/// @copydoc File::position()
+	size_t position();
+
+	/// @copydoc File::can_read()
+	bool can_read() const;
+
+	/// @copydoc File::can_write()
+	bool can_write() const;
+
+	/// @copydoc File::can_seek()
+	bool can_seek() const;
+
+private:
+
+	// Returns the uncompressed size of block @a i.
+	uint32_t block_size(uint32_t i) const;
+
+	// Decompresses block @a i into @a dst.
+	void decompress_block(uint32_t i, char* dst);
+
+	static const uint32_t NO_BLOCK = 0xffffffffu;
+
+	File& _file;
+	Allocator& _allocator;
+	CompressedHeader _header;
+	uint32_t _num_blocks;
+	uint32_t* _offsets;  // Offset of each compressed block in _file plus the end offset
+	char* _compressed;   // Compressed data of one block
+	char* _block;        // Uncompressed data of _block_index
+	uint32_t _block_index;
+	size_t _position;
+
+private:
+
+	// Disable copying
+	CompressedFile(const CompressedFile&);
+	CompressedFile& operator=(const CompressedFile&);
+};
+
+namespace compressed_file
+{
+	/// Returns whether @a file, starting from its current position, is compressed.
+	/// The position of the file is left unchanged.
+	bool is_compressed(File& file);
+
+	/// Returns the size of @a file once decompressed.
+	/// The position of the file is left unchanged.
+	size_t uncompressed_size(File& file);
+
+	/// Compresses the @a size bytes at @a data with @a codec and
+	/// appends the result to @a output.
+	void compress(const void* data, uint32_t size, CompressionCodec::Enum codec, Array<char>& output);
+} // namespace compressed_file
+
+} // namespace crown
@@ -0,0 +1,401 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#include "directory_index.h"
+#include "array.h"
+#include "vector.h"
+#include "hash.h"
+#include "murmur.h"
+#include "os.h"
+#include "temp_allocator.h"
+#include "path.h"
+#include "log.h"
+#include <string.h>
+
+#if CROWN_PLATFORM_POSIX
+	#include <sys/stat.h>
+#endif
+#if CROWN_PLATFORM_LINUX
+	#include <sys/inotify.h>
+	#include <errno.h>
+#endif
+
+namespace crown
+{
+
+static const uint32_t INVALID = 0xffffffffu;
+
+// Rebuild the index when more than this many entries have been removed
+// and they outnumber the live ones.
+static const uint32_t MAX_REMOVED = 1024;
+
+// Reads the kind, size and modification time of the entry at @a path
+// with a single system call. Returns false if it does not exist.
+static bool stat_entry(const char* path, uint32_t& kind, uint64_t& size, uint64_t& mtime)
+{
+#if CROWN_PLATFORM_POSIX
+	struct stat info;
+	if (lstat(path, &info) != 0)
+		return false;
+
+	kind = S_ISDIR(info.st_mode) ? FileKind::DIRECTORY
+		: (S_ISREG(info.st_mode) ? FileKind::FILE : FileKind::NONE);
+	size = kind == FileKind::FILE ? (uint64_t)info.st_size : 0;
+	mtime = (uint64_t)info.st_mtime;
+	return true;
+#elif CROWN_PLATFORM_WINDOWS
+	WIN32_FILE_ATTRIBUTE_DATA info;
+	if (!GetFileAttributesEx(path, GetFileExInfoStandard, &info))
+		return false;
+
+	kind = (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? FileKind::DIRECTORY : FileKind::FILE;
+	size = kind == FileKind::FILE ? (uint64_t(info.nFileSizeHigh) << 32) | info.nFileSizeLow : 0;
+	mtime = (uint64_t(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+	return true;
+#endif
+}
+
+DirectoryIndex::DirectoryIndex(const char* root)
+	: _root(root)
+	, _entries(default_allocator())
+	, _names(default_allocator())
+	, _lookup(default_allocator())
+	, _watches(default_allocator())
+	, _num_removed(0)
+	, _notify(-1)
+	, _watching(true)
+{
+	rebuild();
+}
+
+DirectoryIndex::~DirectoryIndex()
+{
+#if CROWN_PLATFORM_LINUX
+	if (_notify != -1)
+		close(_notify);
+#endif
+}
+
+bool DirectoryIndex::exists(const char* path)
+{
+	ScopedMutex sm(_mutex);
+	update();
+	return find(path) != INVALID;
+}
+
+FileKind::Enum DirectoryIndex::kind(const char* path)
+{
+	ScopedMutex sm(_mutex);
+	update();
+	const uint32_t i = find(path);
+	return i != INVALID ? (FileKind::Enum)_entries[i].kind : FileKind::NONE;
+}
+
+uint64_t DirectoryIndex::size(const char* path)
+{
+	ScopedMutex sm(_mutex);
+	update();
+	const uint32_t i = find(path);
+	return i != INVALID ? _entries[i].size : 0;
+}
+
+uint64_t DirectoryIndex::last_modified_time(const char* path)
+{
+	ScopedMutex sm(_mutex);
+	update();
+	const uint32_t i = find(path);
+	return i != INVALID ? _entries[i].mtime : 0;
+}
+
+void DirectoryIndex::list_files(const char* path, Vector<DynamicString>& files)
+{
+	ScopedMutex sm(_mutex);
+	update();
+
+	const uint32_t i = find(path);
+	if (i == INVALID || _entries[i].kind != FileKind::DIRECTORY)
+		return;
+
+	for (uint32_t c = _entries[i].first_child; c != INVALID; c = _entries[c].next_sibling)
+	{
+		DynamicString name(&_names[_entries[c].name], default_allocator());
+		vector::push_back(files, name);
+	}
+}
+
+void DirectoryIndex::refresh(const char* path)
+{
+	ScopedMutex sm(_mutex);
+	update();
+
+	// Find the directory which contains the entry
+	TempAllocator1024 ta;
+	DynamicString dir(ta);
+	const char* name = strrchr(path, '/');
+	if (name != NULL)
+	{
+		Array<char> tmp(ta);
+		array::push(tmp, path, uint32_t(name - path));
+		array::push_back(tmp, '\0');
+		dir = array::begin(tmp);
+		name++;
+	}
+	else
+	{
+		name = path;
+	}
+
+	const uint32_t parent = find(dir.c_str());
+	if (parent != INVALID)
+		refresh(parent, name);
+}
+
+bool DirectoryIndex::watching()
+{
+	ScopedMutex sm(_mutex);
+	return _watching;
+}
+
+void DirectoryIndex::update()
+{
+#if CROWN_PLATFORM_LINUX
+	char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+	ssize_t len;
+	while ((len = read(_notify, buf, sizeof(buf))) > 0)
+	{
+		for (char* ptr = buf; ptr < buf + len; )
+		{
+			const struct inotify_event* ev = (const struct inotify_event*)ptr;
+			ptr += sizeof(struct inotify_event) + ev->len;
+
+			if (ev->mask & IN_Q_OVERFLOW)
+			{
+				rebuild();
+				return;
+			}
+
+			// Events on the directory itself are handled by its parent
+			const uint32_t dir = hash::get(_watches, uint64_t(ev->wd), INVALID);
+			if (dir == INVALID || ev->len == 0)
+				continue;
+
+			refresh(dir, ev->name);
+		}
+	}
+#endif // CROWN_PLATFORM_LINUX
+
+	if (_num_removed > MAX_REMOVED && _num_removed > array::size(_entries) / 2)
+		rebuild();
+}
+
+void DirectoryIndex::rebuild()
+{
+#if CROWN_PLATFORM_LINUX
+	// Closing the descriptor drops all the watches
+	if (_notify != -1)
+		close(_notify);
+	_notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+
+	array::clear(_entries);
+	array::clear(_names);
+	hash::clear(_lookup);
+	hash::clear(_watches);
+	_num_removed = 0;
+
+	Entry root;
+	root.key = path_key("");
+	root.path = 0;
+	root.name = 0;
+	root.parent = INVALID;
+	root.first_child = INVALID;
+	root.next_sibling = INVALID;
+	root.kind = FileKind::DIRECTORY;
+	root.watch = -1;
+	root.size = 0;
+	root.mtime = 0;
+	stat_entry(_root.c_str(), root.kind, root.size, root.mtime);
+	array::push_back(_entries, root);
+	array::push_back(_names, '\0');
+	hash::set(_lookup, root.key, uint32_t(0));
+
+	watch(0);
+	walk(0);
+}
+
+uint32_t DirectoryIndex::find(const char* path)
+{
+	return hash::get(_lookup, path_key(path), INVALID);
+}
+
+void DirectoryIndex::refresh(uint32_t parent, const char* name)
+{
+	TempAllocator1024 ta;
+	DynamicString path(ta);
+	if (parent != 0)
+	{
+		path += &_names[_entries[parent].path];
+		path += '/';
+	}
+	path += name;
+
+	const uint32_t i = find(path.c_str());
+	if (i == INVALID)
+	{
+		add(parent, name);
+		return;
+	}
+
+	DynamicString abs_path(ta);
+	absolute_path(i, abs_path);
+
+	// Update files in place, directories keep track of their own content
+	uint32_t kind;
+	uint64_t size;
+	uint64_t mtime;
+	if (!stat_entry(abs_path.c_str(), kind, size, mtime))
+	{
+		remove(i);
+	}
+	else if (kind != _entries[i].kind)
+	{
+		remove(i);
+		add(parent, name);
+	}
+	else
+	{
+		_entries[i].size = size;
+		_entries[i].mtime = mtime;
+	}
+}
+
+uint32_t DirectoryIndex::add(uint32_t parent, const char* name)
+{
+	TempAllocator1024 ta;
+	DynamicString path(ta);
+	if (parent != 0)
+	{
+		path += &_names[_entries[parent].path];
+		path += '/';
+	}
+	const uint32_t name_offset = path.length();
+	path += name;
+
+	DynamicString abs_path(ta);
+	path::join(_root.c_str(), path.c_str(), abs_path);
+
+	Entry e;
+	if (!stat_entry(abs_path.c_str(), e.kind, e.size, e.mtime))
+		return INVALID;
+
+	e.key = path_key(path.c_str());
+	e.path = array::size(_names);
+	e.name = e.path + name_offset;
+	e.parent = parent;
+	e.first_child = INVALID;
+	e.next_sibling = _entries[parent].first_child;
+	e.watch = -1;
+
+	const uint32_t i = array::size(_entries);
+	array::push(_names, path.c_str(), path.length() + 1);
+	array::push_back(_entries, e);
+	_entries[parent].first_child = i;
+	hash::set(_lookup, e.key, i);
+
+	if (e.kind == FileKind::DIRECTORY)
+	{
+		watch(i);
+		walk(i);
+	}
+
+	return i;
+}
+
+void DirectoryIndex::remove(uint32_t i)
+{
+	while (_entries[i].first_child != INVALID)
+		remove(_entries[i].first_child);
+
+	// Unlink from the parent
+	uint32_t* link = &_entries[_entries[i].parent].first_child;
+	while (*link != i)
+		link = &_entries[*link].next_sibling;
+	*link = _entries[i].next_sibling;
+
+#if CROWN_PLATFORM_LINUX
+	if (_entries[i].watch != -1)
+	{
+		inotify_rm_watch(_notify, _entries[i].watch);
+		hash::remove(_watches, uint64_t(_entries[i].watch));
+	}
+#endif
+
+	hash::remove(_lookup, _entries[i].key);
+	_num_removed++;
+}
+
+void DirectoryIndex::walk(uint32_t dir)
+{
+	TempAllocator1024 ta;
+	DynamicString abs_path(ta);
+	absolute_path(dir, abs_path);
+
+	Vector<DynamicString> files(default_allocator());
+	os::list_files(abs_path.c_str(), files);
+
+	for (uint32_t i = 0; i < vector::size(files); i++)
+		add(dir, files[i].c_str());
+}
+
+void DirectoryIndex::watch(uint32_t dir)
+{
+#if CROWN_PLATFORM_LINUX
+	TempAllocator1024 ta;
+	DynamicString abs_path(ta);
+	absolute_path(dir, abs_path);
+
+	const uint32_t mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB
+		| IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW;
+	const int wd = inotify_add_watch(_notify, abs_path.c_str(), mask);
+	if (wd == -1)
+	{
+		// The directory might have been removed meanwhile, its parent
+		// gets notified about that
+		if (errno == ENOENT || errno == ENOTDIR)
+			return;
+
+		if (_watching)
+			CE_LOGW("Unable to watch '%s' (errno = %d), the file index is disabled", abs_path.c_str(), errno);
+		_watching = false;
+		return;
+	}
+
+	_entries[dir].watch = wd;
+	hash::set(_watches, uint64_t(wd), dir);
+#else
+	CE_UNUSED(dir);
+#endif
+}
+
+void DirectoryIndex::absolute_path(uint32_t i, DynamicString& path)
+{
+	if (i == 0)
+		path = _root.c_str();
+	else
+		path::join(_root.c_str(), &_names[_entries[i].path], path);
+}
+
+uint64_t DirectoryIndex::path_key(const char* path)
+{
+	// Ignore trailing separators
+	uint32_t len = strlen(path);
+	while (len > 0 && path[len - 1] == '/')
+		len--;
+
+	return murmur64(path, len, 0);
+}
+
+} // namespace crown
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "filesystem_types.h"
+#include "container_types.h"
+#include "dynamic_string.h"
+#include "mutex.h"
+
+namespace crown
+{
+
+/// In-memory index of all the files and directories under a root directory.
+/// The whole tree is walked once, then the changes are picked up from
+/// inotify on Linux. On the other platforms only the paths passed to
+/// refresh() are updated.
+/// Paths are relative to the root directory.
+///
+/// @ingroup Filesystem
+class DirectoryIndex
+{
+public:
+
+	/// Indexes the tree under the given absolute @a root path.
+	DirectoryIndex(const char* root);
+	~DirectoryIndex();
+
+	/// Returns whether @a path exists.
+	bool exists(const char* path);
+
+	/// Returns the kind of the entry at @a path.
+	/// Entries which are neither files nor directories (e.g. symbolic links)
+	/// are FileKind::NONE.
+	FileKind::Enum kind(const char* path);
+
+	/// Returns the size in bytes of the file at @a path.
+	uint64_t size(const char* path);
+
+	/// Returns the last modification time of the file at @a path.
+	uint64_t last_modified_time(const char* path);
+
+	/// Returns the relative file names in the given @a path.
+	void list_files(const char* path, Vector<DynamicString>& files);
+
+	/// Reads again the entry at @a path from the disk.
+	void refresh(const char* path);
+
+	/// Returns whether the changes to all the indexed directories are picked up.
+	/// It becomes false, with a warning, when a directory can not be watched
+	/// (e.g. the inotify watch limit has been reached): the index might then
+	/// miss changes and should not be used anymore.
+	bool watching();
+
+private:
+
+	struct Entry
+	{
+		uint64_t key;
+		uint32_t path;       // Offset of the relative path in _names
+		uint32_t name;       // Offset of the name in _names
+		uint32_t parent;
+		uint32_t first_child;
+		uint32_t next_sibling;
+		uint32_t kind;
+		int32_t watch;
+		uint64_t size;
+		uint64_t mtime;
+	};
+
+	// Applies the changes notified by the operating system.
+	void update();
+
+	// Walks the whole tree again.
+	void rebuild();
+
+	uint32_t find(const char* path);
+	void refresh(uint32_t parent, const char* name);
+	uint32_t add(uint32_t parent, const char* name);
+	void remove(uint32_t i);
+	void walk(uint32_t dir);
+	void watch(uint32_t dir);
+	void absolute_path(uint32_t i, DynamicString& path);
+
+	static uint64_t path_key(const char* path);
+
+private:
+
+	DynamicString _root;
+	Mutex _mutex;
+	Array<Entry> _entries;
+	Array<char> _names;
+	Hash<uint32_t> _lookup;
+	Hash<uint32_t> _watches;
+	uint32_t _num_removed;
+	int _notify;
+	bool _watching;
+};
+
+} // namespace crown
@@ -15,6 +15,7 @@ namespace crown
 {
 
 DiskFilesystem::DiskFilesystem()
+	: _index(NULL)
 {
 	char buf[512];
 	os::getcwd(buf, sizeof(buf));
@@ -23,9 +24,15 @@ DiskFilesystem::DiskFilesystem()
 
 DiskFilesystem::DiskFilesystem(const char* prefix)
 	: _prefix(prefix)
+	, _index(NULL)
 {
 }
 
+DiskFilesystem::~DiskFilesystem()
+{
+	enable_index(false);
+}
+
 File* DiskFilesystem::open(const char* path, FileOpenMode mode)
 {
 	CE_ASSERT_NOT_NULL(path);
@@ -34,7 +41,12 @@ File* DiskFilesystem::open(const char* path, FileOpenMode mode)
 	DynamicString abs_path(alloc);
 	get_absolute_path(path, abs_path);
 
-	return CE_NEW(default_allocator(), DiskFile)(mode, abs_path.c_str());
+	File* file = CE_NEW(default_allocator(), DiskFile)(mode, abs_path.c_str());
+
+	if ((mode & FOM_WRITE) && use_index(path))
+		_index->refresh(path);
+
+	return file;
 }
 
 void DiskFilesystem::close(File* file)
@@ -48,6 +60,9 @@ bool DiskFilesystem::exists(const char* path)
 {
 	CE_ASSERT_NOT_NULL(path);
 
+	if (use_index(path))
+		return _index->exists(path);
+
 	TempAllocator256 alloc;
 	DynamicString abs_path(alloc);
 	get_absolute_path(path, abs_path);
@@ -59,6 +74,9 @@ bool DiskFilesystem::is_directory(const char* path)
 {
 	CE_ASSERT_NOT_NULL(path);
 
+	if (use_index(path))
+		return _index->kind(path) == FileKind::DIRECTORY;
+
 	TempAllocator256 alloc;
 	DynamicString abs_path(alloc);
 	get_absolute_path(path, abs_path);
@@ -70,6 +88,9 @@ bool DiskFilesystem::is_file(const char* path)
 {
 	CE_ASSERT_NOT_NULL(path);
 
+	if (use_index(path))
+		return _index->kind(path) == FileKind::FILE;
+
 	TempAllocator256 alloc;
 	DynamicString abs_path(alloc);
 	get_absolute_path(path, abs_path);
@@ -87,6 +108,9 @@ void DiskFilesystem::create_directory(const char* path)
 
 	if (!os::exists(abs_path.c_str()))
 		os::create_directory(abs_path.c_str());
+
+	if (use_index(path))
+		_index->refresh(path);
 }
 
 void DiskFilesystem::delete_directory(const char* path)
@@ -98,6 +122,9 @@ void DiskFilesystem::delete_directory(const char* path)
 	get_absolute_path(path, abs_path);
 
 	os::delete_directory(abs_path.c_str());
+
+	if (use_index(path))
+		_index->refresh(path);
 }
 
 void DiskFilesystem::create_file(const char* path)
@@ -109,6 +136,9 @@ void DiskFilesystem::create_file(const char* path)
 	get_absolute_path(path, abs_path);
 
 	os::create_file(abs_path.c_str());
+
+	if (use_index(path))
+		_index->refresh(path);
 }
 
 void DiskFilesystem::delete_file(const char* path)
@@ -120,12 +150,21 @@ void DiskFilesystem::delete_file(const char* path)
 	get_absolute_path(path, abs_path);
 
 	os::delete_file(abs_path.c_str());
+
+	if (use_index(path))
+		_index->refresh(path);
 }
 
 void DiskFilesystem::list_files(const char* path, Vector<DynamicString>& files)
 {
 	CE_ASSERT_NOT_NULL(path);
 
+	if (use_index(path))
+	{
+		_index->list_files(path, files);
+		return;
+	}
+
 	TempAllocator256 alloc;
 	DynamicString abs_path(alloc);
 	get_absolute_path(path, abs_path);
@@ -144,4 +183,58 @@ void DiskFilesystem::get_absolute_path(const char* path, DynamicString& os_path)
 	path::join(_prefix.c_str(), path, os_path);
 }
 
+uint64_t DiskFilesystem::storage_order(const char* path)
+{
+	CE_ASSERT_NOT_NULL(path);
+
+	TempAllocator256 alloc;
+	DynamicString abs_path(alloc);
+	get_absolute_path(path, abs_path);
+
+	return os::file_storage_order(abs_path.c_str());
+}
+
+void DiskFilesystem::prefetch(const char* path)
+{
+	CE_ASSERT_NOT_NULL(path);
+
+	TempAllocator256 alloc;
+	DynamicString abs_path(alloc);
+	get_absolute_path(path, abs_path);
+
+	os::prefetch_file(abs_path.c_str());
+}
+
+uint64_t DiskFilesystem::last_modified_time(const char* path)
+{
+	CE_ASSERT_NOT_NULL(path);
+
+	if (use_index(path))
+		return _index->last_modified_time(path);
+
+	TempAllocator256 alloc;
+	DynamicString abs_path(alloc);
+	get_absolute_path(path, abs_path);
+
+	return os::last_modified_time(abs_path.c_str());
+}
+
+void DiskFilesystem::enable_index(bool enable)
+{
+	if (enable && _index == NULL)
+	{
+		_index = CE_NEW(default_allocator(), DirectoryIndex)(_prefix.c_str());
+	}
+	else if (!enable && _index != NULL)
+	{
+		CE_DELETE(default_allocator(), _index);
+		_index = NULL;
+	}
+}
+
+bool DiskFilesystem::use_index(const char* path)
+{
+	return _index != NULL && !path::is_absolute_path(path) && _index->watching();
+}
+
 } // namespace crown
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "filesystem.h"
+#include "directory_index.h"
 
 namespace crown
 {
@@ -30,6 +31,7 @@ public:
 	/// @note
 	/// The @a prefix must be absolute.
 	DiskFilesystem(const char* prefix);
+	~DiskFilesystem();
 
 	/// Opens the file at the given @a path with the given @a mode.
 	File* open(const char* path, FileOpenMode mode);
@@ -66,9 +68,36 @@ public:
 	/// the given path is returned.
 	void get_absolute_path(const char* path, DynamicString& os_path);
 
+	/// @copydoc Filesystem::storage_order()
+	uint64_t storage_order(const char* path);
+
+	/// @copydoc Filesystem::prefetch()
+	void prefetch(const char* path);
+
+	/// Returns the last modification time of the file at @a path.
+	uint64_t last_modified_time(const char* path);
+
+	/// Keeps an index of all the files under the root path in memory so that
+	/// exists(), is_file(), is_directory(), list_files() and last_modified_time()
+	/// do not touch the disk. See DirectoryIndex.
+	/// The disk is queried again if the index stops picking up the changes.
+	void enable_index(bool enable);
+
+private:
+
+	// Returns whether @a path can be looked up in the index.
+	bool use_index(const char* path);
+
 private:
 
 	DynamicString _prefix;
+	DirectoryIndex* _index;
+
+private:
+
+	// Disable copying
+	DiskFilesystem(const DiskFilesystem&);
+	DiskFilesystem& operator=(const DiskFilesystem&);
 };
 
 } // namespace crown
@@ -87,6 +87,11 @@ public:
 	/// Returns whether the file can be sought.
 	virtual bool can_seek() const = 0;
 
+	/// Returns the whole content of the file if it lives in memory
+	/// which stays valid after the file has been closed (e.g. a
+	/// memory-mapped archive), NULL otherwise.
+	virtual const void* mapped_data() { return NULL; }
+
 protected:
 
 	FileOpenMode _open_mode;
@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#include "file_server.h"
+#include "network_filesystem.h"
+#include "filesystem.h"
+#include "file.h"
+#include "array.h"
+#include "vector.h"
+#include "dynamic_string.h"
+#include "temp_allocator.h"
+#include "path.h"
+#include "thread.h"
+#include "atomic_int.h"
+#include "math_utils.h"
+#include "memory.h"
+#include "log.h"
+#include <string.h>
+
+namespace crown
+{
+
+struct FileServer::Client
+{
+	Client(Filesystem& fs, TCPSocket socket)
+		: fs(fs)
+		, socket(socket)
+		, done(0)
+	{
+	}
+
+	Filesystem& fs;
+	TCPSocket socket;
+	Thread thread;
+	AtomicInt done;
+};
+
+static FileStat stat_file(Filesystem& fs, const char* path)
+{
+	FileStat st;
+	st.kind = FileKind::NONE;
+	st._pad = 0;
+	st.size = 0;
+
+	if (!fs.exists(path))
+		return st;
+
+	if (fs.is_file(path))
+	{
+		File* file = fs.open(path, FOM_READ);
+		st.kind = FileKind::FILE;
+		st.size = file->size();
+		fs.close(file);
+	}
+	else if (fs.is_directory(path))
+	{
+		st.kind = FileKind::DIRECTORY;
+	}
+
+	return st;
+}
+
+// Returns whether @a path is relative and stays inside the served directory.
+static bool is_safe_path(const char* path)
+{
+	if (path[0] == '/' || path[0] == '\\' || strchr(path, ':') != NULL)
+		return false;
+
+	// Reject any ".." component
+	for (const char* cur = path; *cur != '\0'; )
+	{
+		const char* end = cur;
+		while (*end != '\0' && *end != '/' && *end != '\\')
+			end++;
+
+		if (end - cur == 2 && cur[0] == '.' && cur[1] == '.')
+			return false;
+
+		cur = *end != '\0' ? end + 1 : end;
+	}
+
+	return true;
+}
+
+// Sends the response in @a buf, which starts with room for the FileResponse.
+static void send_response(TCPSocket& socket, uint32_t status, Array<char>& buf)
+{
+	FileResponse resp;
+	resp.status = status;
+	resp.size = array::size(buf) - sizeof(resp);
+	memcpy(array::begin(buf), &resp, sizeof(resp));
+	socket.write(array::begin(buf), array::size(buf));
+}
+
+FileServer::FileServer(Filesystem& fs, uint16_t port)
+	: _fs(fs)
+	, _clients(default_allocator())
+{
+	_server.bind(port);
+	_server.listen(5);
+	CE_LOGI("File server listening on port %d", port);
+}
+
+FileServer::~FileServer()
+{
+	for (uint32_t i = 0; i < array::size(_clients); i++)
+	{
+		_clients[i]->socket.close();
+		_clients[i]->thread.stop();
+		CE_DELETE(default_allocator(), _clients[i]);
+	}
+
+	_server.close();
+}
+
+void FileServer::run()
+{
+	while (true)
+	{
+		TCPSocket socket;
+		AcceptResult ar = _server.accept(socket);
+
+		reap_clients();
+
+		if (ar.error != AcceptResult::NO_ERROR)
+			continue;
+
+		Client* client = CE_NEW(default_allocator(), Client)(_fs, socket);
+		array::push_back(_clients, client);
+		client->thread.start(FileServer::client_run, client);
+	}
+}
+
+void FileServer::reap_clients()
+{
+	for (uint32_t i = 0; i < array::size(_clients); )
+	{
+		Client* client = _clients[i];
+		if (client->done.load() == 0)
+		{
+			i++;
+			continue;
+		}
+
+		client->thread.stop();
+		client->socket.close();
+		CE_DELETE(default_allocator(), client);
+
+		_clients[i] = array::back(_clients);
+		array::pop_back(_clients);
+	}
+}
+
+int32_t FileServer::client_run(void* data)
+{
+	Client* client = (Client*)data;
+	Filesystem& fs = client->fs;
+	TCPSocket& socket = client->socket;
+
+	Array<char> path(default_allocator());
+	Array<char> response(default_allocator());
+
+	// The last file read stays open, reads usually come in sequence
+	File* file = NULL;
+	DynamicString file_path(default_allocator());
+
+	while (true)
+	{
+		FileRequest req;
+		ReadResult rr = socket.read(&req, sizeof(req));
+		if (rr.error != ReadResult::NO_ERROR)
+			break;
+
+		// The request comes from the network, do not trust the length
+		if (req.path_length > FILE_SERVER_MAX_PATH_LENGTH)
+		{
+			CE_LOGW("File server: path too long, closing the connection");
+			break;
+		}
+
+		array::resize(path, req.path_length + 1);
+		rr = socket.read(array::begin(path), req.path_length);
+		if (rr.error != ReadResult::NO_ERROR)
+			break;
+		path[req.path_length] = '\0';
+
+		array::resize(response, sizeof(FileResponse));
+
+		// Only the files under the served directory can be accessed
+		if (!is_safe_path(array::begin(path)))
+		{
+			send_response(socket, 1, response);
+			continue;
+		}
+
+		switch (req.type)
+		{
+			case FileRequestType::STAT:
+			{
+				// Clients stat a file each time they open it, the file
+				// might have been replaced since it was opened here
+				if (file != NULL && file_path == array::begin(path))
+				{
+					fs.close(file);
+					file = NULL;
+				}
+
+				const FileStat st = stat_file(fs, array::begin(path));
+				array::push(response, (const char*)&st, sizeof(st));
+				send_response(socket, 0, response);
+				break;
+			}
+			case FileRequestType::LIST:
+			{
+				const FileStat st = stat_file(fs, array::begin(path));
+				if (st.kind != FileKind::DIRECTORY)
+				{
+					send_response(socket, 1, response);
+					break;
+				}
+
+				Vector<DynamicString> files(default_allocator());
+				fs.list_files(array::begin(path), files);
+
+				for (uint32_t i = 0; i < vector::size(files); i++)
+				{
+					TempAllocator512 ta;
+					DynamicString entry_path(ta);
+					if (req.path_length == 0)
+						entry_path = files[i].c_str();
+					else
+						path::join(array::begin(path), files[i].c_str(), entry_path);
+
+					const FileStat st = stat_file(fs, entry_path.c_str());
+					const uint32_t len = files[i].length() + 1;
+					array::push(response, (const char*)&st, sizeof(st));
+					array::push(response, (const char*)&len, sizeof(len));
+					array::push(response, files[i].c_str(), len);
+				}
+
+				send_response(socket, 0, response);
+				break;
+			}
+			case FileRequestType::READ:
+			{
+				if (req.path_length == 0)
+				{
+					send_response(socket, 1, response);
+					break;
+				}
+
+				if (file == NULL || !(file_path == array::begin(path)))
+				{
+					if (file != NULL)
+						fs.close(file);
+					file = NULL;
+
+					const FileStat st = stat_file(fs, array::begin(path));
+					if (st.kind != FileKind::FILE)
+					{
+						send_response(socket, 1, response);
+						break;
+					}
+
+					file = fs.open(array::begin(path), FOM_READ);
+					file_path = array::begin(path);
+				}
+
+				const size_t file_size = file->size();
+				const uint32_t size = min(req.size, (uint32_t)FILE_SERVER_CHUNK_SIZE);
+				const uint32_t num = req.offset < file_size
+					? (uint32_t)min((uint64_t)size, file_size - req.offset)
+					: 0;
+
+				array::resize(response, sizeof(FileResponse) + num);
+				file->seek((size_t)req.offset);
+				file->read(array::begin(response) + sizeof(FileResponse), num);
+				send_response(socket, 0, response);
+				break;
+			}
+			default:
+			{
+				send_response(socket, 1, response);
+				break;
+			}
+		}
+	}
+
+	if (file != NULL)
+		fs.close(file);
+
+	// Let the client know right away when it has been dropped
+	socket.close();
+	client->done.store(1);
+	return 0;
+}
+
+} // namespace crown
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "filesystem_types.h"
+#include "container_types.h"
+#include "socket.h"
+
+namespace crown
+{
+
+/// Serves the files of a Filesystem to NetworkFilesystem clients.
+/// Each client is served by its own thread.
+///
+/// @ingroup Filesystem
+class FileServer
+{
+public:
+
+	/// Serves the files in @a fs on the given @a port.
+	FileServer(Filesystem& fs, uint16_t port);
+	~FileServer();
+
+	/// Accepts clients until the process is terminated.
+	void run();
+
+private:
+
+	struct Client;
+
+	// Stops and destroys the clients which disconnected.
+	void reap_clients();
+
+	static int32_t client_run(void* data);
+
+private:
+
+	Filesystem& _fs;
+	TCPSocket _server;
+	Array<Client*> _clients;
+};
+
+} // namespace crown
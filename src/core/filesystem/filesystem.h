@@ -6,6 +6,7 @@
 #pragma once
 
 #include "file.h"
+#include "filesystem_types.h"
 #include "container_types.h"
 #include "dynamic_string.h"
 
@@ -103,6 +104,15 @@ public:
 	/// the given path is returned.
 	virtual void get_absolute_path(const char* path, DynamicString& os_path) = 0;
 
+	/// Returns a number which orders the file at @a path by its
+	/// position on the storage device. Reading files in ascending
+	/// order minimizes seeks. Returns 0 if the position is unknown.
+	virtual uint64_t storage_order(const char* /*path*/) { return 0; }
+
+	/// Hints that the file at @a path is going to be read soon, so that
+	/// its data can be fetched in the background.
+	virtual void prefetch(const char* /*path*/) {}
+
 private:
 
 	// Disable copying
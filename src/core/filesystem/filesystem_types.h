@@ -11,4 +11,17 @@ namespace crown
 class Filesystem;
 class File;
 
+/// Enumerates the kinds of entries in a filesystem.
+///
+/// @ingroup Filesystem
+struct FileKind
+{
+	enum Enum
+	{
+		NONE,
+		FILE,
+		DIRECTORY
+	};
+};
+
 } // namespace crown
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#include "memory_file.h"
+#include "error.h"
+#include "math_utils.h"
+#include <string.h> // memcpy
+
+namespace crown
+{
+
+MemoryFile::MemoryFile(const void* data, size_t size)
+	: File(FOM_READ)
+	, _data((const char*)data)
+	, _size(size)
+	, _position(0)
+{
+}
+
+void MemoryFile::seek(size_t position)
+{
+	CE_ASSERT(position <= _size, "Seek out of bounds");
+	_position = position;
+}
+
+void MemoryFile::seek_to_end()
+{
+	_position = _size;
+}
+
+void MemoryFile::skip(size_t bytes)
+{
+	seek(_position + bytes);
+}
+
+void MemoryFile::read(void* buffer, size_t size)
+{
+	memcpy(buffer, consume(size), size);
+}
+
+void MemoryFile::write(const void* /*buffer*/, size_t /*size*/)
+{
+	CE_FATAL("MemoryFile is read-only");
+}
+
+bool MemoryFile::copy_to(File& file, size_t size)
+{
+	const size_t num = min(size, _size - _position);
+	file.write(consume(num), num);
+	return num == size;
+}
+
+void MemoryFile::flush()
+{
+}
+
+bool MemoryFile::is_valid()
+{
+	return true;
+}
+
+bool MemoryFile::end_of_file()
+{
+	return _position == _size;
+}
+
+size_t MemoryFile::size()
+{
+	return _size;
+}
+
+size_t MemoryFile::position()
+{
+	return _position;
+}
+
+bool MemoryFile::can_read() const
+{
+	return true;
+}
+
+bool MemoryFile::can_write() const
+{
+	return false;
+}
+
+bool MemoryFile::can_seek() const
+{
+	return true;
+}
+
+const char* MemoryFile::data() const
+{
+	return _data;
+}
+
+const char* MemoryFile::consume(size_t size)
+{
+	CE_ASSERT(_position + size <= _size, "Read out of bounds");
+	const char* p = _data + _position;
+	_position += size;
+	return p;
+}
+
+} // namespace crown
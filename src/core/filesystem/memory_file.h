@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "file.h"
+
+namespace crown
+{
+
+/// Read-only view of a block of memory.
+/// The memory is not copied and must outlive the file.
+///
+/// @ingroup Filesystem
+class MemoryFile: public File
+{
+public:
+
+	/// Reads from the @a size bytes starting at @a data.
+	MemoryFile(const void* data, size_t size);
+
+	/// @copydoc File::seek()
+	void seek(size_t position);
+
+	/// @copydoc File::seek_to_end()
+	void seek_to_end();
+
+	/// @copydoc File::skip()
+	void skip(size_t bytes);
+
+	/// @copydoc File::read()
+	void read(void* buffer, size_t size);
+
+	/// @copydoc File::write()
+	/// @note
+	/// MemoryFile is read-only.
+	void write(const void* buffer, size_t size);
+
+	/// @copydoc File::copy_to()
+	bool copy_to(File& file, size_t size = 0);
+
+	/// @copydoc File::flush()
+	void flush();
+
+	/// @copydoc File::is_valid()
+	bool is_valid();
+
+	/// @copydoc File::end_of_file()
+	bool end_of_file();
+
+	/// @copydoc File::size()
+	size_t size();
+
+	/// @copydoc File::position()
+	size_t position();
+
+	/// @copydoc File::can_read()
+	bool can_read() const;
+
+	/// @copydoc File::can_write()
+	bool can_write() const;
+
+	/// @copydoc File::can_seek()
+	bool can_seek() const;
+
+	/// Returns the first byte of the file.
+	const char* data() const;
+
+	/// Returns the byte at the current position and
+	/// advances the position by @a size bytes.
+	const char* consume(size_t size);
+
+private:
+
+	const char* _data;
+	size_t _size;
+	size_t _position;
+};
+
+} // namespace crown
@@ -3,34 +3,31 @@
  * License: https://github.com/taylor001/crown/blob/master/LICENSE
  */
 
-#include "json_parser.h"
-#include "container_types.h"
-#include "log.h"
-#include "math_utils.h"
 #include "network_file.h"
 #include "network_filesystem.h"
-#include "string_stream.h"
-#include "string_utils.h"
-#include "temp_allocator.h"
-#include "types.h"
-#include "dynamic_string.h"
+#include "math_utils.h"
+#include "memory.h"
+#include <string.h>
 
 namespace crown
 {
 
-NetworkFile::NetworkFile(const NetAddress& addr, uint16_t port, const char* filename)
+NetworkFile::NetworkFile(NetworkFilesystem& fs, const char* path, size_t size)
 	: File(FOM_READ)
-	, _address(addr)
-	, _port(port)
+	, _fs(fs)
+	, _size(size)
 	, _position(0)
+	, _cache(NULL)
+	, _cache_offset(0)
+	, _cache_size(0)
 {
-	strncpy(_filename, filename, 1024);
-	_socket.connect(addr, port);
+	strncpy(_path, path, sizeof(_path) - 1);
+	_path[sizeof(_path) - 1] = '\0';
 }
 
 NetworkFile::~NetworkFile()
 {
-	_socket.close();
+	default_allocator().deallocate(_cache);
 }
 
 void NetworkFile::seek(size_t position)
@@ -40,7 +37,7 @@ void NetworkFile::seek(size_t position)
 
 void NetworkFile::seek_to_end()
 {
-	_position = size();
+	_position = _size;
 }
 
 void NetworkFile::skip(size_t bytes)
@@ -50,34 +47,40 @@ void NetworkFile::skip(size_t bytes)
 
 void NetworkFile::read(void* buffer, size_t size)
 {
-	using namespace string_stream;
+	CE_ASSERT(_position + size <= _size, "Reading past the end of file");
 
-	TempAllocator1024 alloc;
-	StringStream command(alloc);
+	char* dst = (char*)buffer;
 
-	// Request the file
-	command << "{\"type\":\"filesystem\",\"filesystem\":\"read\",";
-	command << "\"file\":\"" << _filename << "\",";
-	command << "\"position\":" << _position << ",";
-	command << "\"size\":" << size << "}";
+	// Serve what is already cached
+	if (_position >= _cache_offset && _position < _cache_offset + _cache_size)
+	{
+		const size_t num = min(size, _cache_offset + _cache_size - _position);
+		memcpy(dst, _cache + (_position - _cache_offset), num);
+		dst += num;
+		_position += num;
+		size -= num;
+	}
 
-	network_filesystem::send(_socket, c_str(command));
+	if (size == 0)
+		return;
 
-	// Wait for response
-	Array<char> response(default_allocator());
-	network_filesystem::read_response(_socket, response);
+	// Large reads go straight to the destination
+	if (size >= FILE_SERVER_CHUNK_SIZE)
+	{
+		_position += _fs.read(_path, _position, dst, size);
+		return;
+	}
 
-	// Parse the response
-	JSONParser json(array::begin(response));
-	JSONElement root = json.root();
+	if (_cache == NULL)
+		_cache = (char*)default_allocator().allocate(FILE_SERVER_CHUNK_SIZE);
 
-	// DynamicString data_base64;
-	// root.key("data").to_string(data_base64);
+	_cache_offset = _position;
+	_cache_size = _fs.read(_path, _position, _cache, min(_size - _position, (size_t)FILE_SERVER_CHUNK_SIZE));
 
-	// size_t out_len = 0;
-	// unsigned char* data = base64_decode(data_base64.c_str(), data_base64.length(), &out_len);
-	// memcpy(buffer, data, sizeof(unsigned char) * out_len);
-	// default_allocator().deallocate(data);
+	// The read comes up short when the file server fails
+	const size_t num = min(size, _cache_size);
+	memcpy(dst, _cache, num);
+	_position += num;
 }
 
 void NetworkFile::write(const void* /*buffer*/, size_t /*size*/)
@@ -87,12 +90,24 @@ void NetworkFile::write(const void* /*buffer*/, size_t /*size*/)
 
 bool NetworkFile::copy_to(File& file, size_t size)
 {
+	char* buf = (char*)default_allocator().allocate(FILE_SERVER_CHUNK_SIZE);
+
+	size = min(size, _size - _position);
+	while (size > 0)
+	{
+		const size_t num = min(size, (size_t)FILE_SERVER_CHUNK_SIZE);
+		read(buf, num);
+		file.write(buf, num);
+		size -= num;
+	}
+
+	default_allocator().deallocate(buf);
 	return true;
 }
 
 bool NetworkFile::end_of_file()
 {
-	return position() == size();
+	return _position >= _size;
 }
 
 bool NetworkFile::is_valid()
@@ -112,25 +127,7 @@ size_t NetworkFile::position()
 
 size_t NetworkFile::size()
 {
-	using namespace string_stream;
-
-	TempAllocator1024 alloc;
-	StringStream command(alloc);
-
-	// Request the file
-	command << "{\"type\":\"filesystem\",\"filesystem\":\"size\",";
-	command << "\"file\":\"" << _filename << "\"}";
-
-	network_filesystem::send(_socket, c_str(command));
-
-	// Wait for response
-	Array<char> response(default_allocator());
-	network_filesystem::read_response(_socket, response);
-
-	JSONParser parser(array::begin(response));
-	JSONElement root = parser.root();
-
-	return (size_t) root.key("size").to_int();
+	return _size;
 }
 
 bool NetworkFile::can_read() const
@@ -149,4 +146,3 @@ bool NetworkFile::can_seek() const
 }
 
 } // namespace crown
-
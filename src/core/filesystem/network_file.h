@@ -5,23 +5,23 @@
 
 #pragma once
 
-#include "error.h"
-#include "socket.h"
-#include "os.h"
 #include "file.h"
 
 namespace crown
 {
 
+class NetworkFilesystem;
+
 /// Access file on a remote file server.
+/// Small reads are served from a local copy of the last chunk read.
 ///
 /// @ingroup Filesystem
 class NetworkFile: public File
 {
 public:
 
-	/// Reads the file named @a filename from the given @a socket.
-	NetworkFile(const NetAddress& addr, uint16_t port, const char* filename);
+	/// Reads the file at @a path of @a size bytes from the given @a fs.
+	NetworkFile(NetworkFilesystem& fs, const char* path, size_t size);
 	virtual ~NetworkFile();
 
 	/// @copydoc File::seek()
@@ -68,11 +68,13 @@ public:
 
 private:
 
-	char _filename[1024];
-	NetAddress _address;
-	uint16_t _port;
-	TCPSocket _socket;
+	NetworkFilesystem& _fs;
+	char _path[1024];
+	size_t _size;
 	size_t _position;
+	char* _cache;
+	size_t _cache_offset;
+	size_t _cache_size;
 };
 
 } // namespace crown
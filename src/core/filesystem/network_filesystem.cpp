@@ -3,30 +3,58 @@
  * License: https://github.com/taylor001/crown/blob/master/LICENSE
  */
 
-#include "json_parser.h"
 #include "network_file.h"
 #include "network_filesystem.h"
-#include "os.h"
-#include "string_utils.h"
 #include "temp_allocator.h"
-#include "string_stream.h"
+#include "dynamic_string.h"
+#include "vector.h"
+#include "array.h"
+#include "hash.h"
+#include "murmur.h"
+#include "path.h"
+#include "memory.h"
+#include "log.h"
+#include <string.h>
 
 namespace crown
 {
 
 NetworkFilesystem::NetworkFilesystem()
+	: _port(CROWN_DEFAULT_FILE_SERVER_PORT)
+	, _connected(false)
+	, _cache(default_allocator())
 {
 }
 
 NetworkFilesystem::NetworkFilesystem(const NetAddress& addr, uint16_t port)
 	: _address(addr)
 	, _port(port)
+	, _connected(false)
+	, _cache(default_allocator())
 {
 }
 
+NetworkFilesystem::~NetworkFilesystem()
+{
+	_socket.close();
+}
+
 File* NetworkFilesystem::open(const char* path, FileOpenMode mode)
 {
-	return CE_NEW(default_allocator(), NetworkFile)(_address, _port, path);
+	CE_ASSERT_NOT_NULL(path);
+	CE_ASSERT(mode == FOM_READ, "File server is read-only");
+	CE_UNUSED(mode);
+
+	// The file might have changed on the server since it was cached,
+	// e.g. when it is opened again to be reloaded
+	_mutex.lock();
+	hash::remove(_cache, path_key(path));
+	_mutex.unlock();
+
+	const FileStat st = stat(path);
+	CE_ASSERT(st.kind == FileKind::FILE, "File not found: %s", path);
+
+	return CE_NEW(default_allocator(), NetworkFile)(*this, path, (size_t)st.size);
 }
 
 void NetworkFilesystem::close(File* file)
@@ -37,49 +65,291 @@ void NetworkFilesystem::close(File* file)
 
 bool NetworkFilesystem::exists(const char* path)
 {
-	return false;
+	return stat(path).kind != FileKind::NONE;
 }
 
 bool NetworkFilesystem::is_directory(const char* path)
 {
-  return false;
+	return stat(path).kind == FileKind::DIRECTORY;
 }
 
 bool NetworkFilesystem::is_file(const char* path)
 {
-  return false;
+	return stat(path).kind == FileKind::FILE;
 }
 
 void NetworkFilesystem::create_directory(const char* /*path*/)
 {
+	CE_FATAL("File server is read-only");
 }
 
 void NetworkFilesystem::delete_directory(const char* /*path*/)
 {
+	CE_FATAL("File server is read-only");
 }
 
 void NetworkFilesystem::create_file(const char* /*path*/)
 {
+	CE_FATAL("File server is read-only");
 }
 
 void NetworkFilesystem::delete_file(const char* /*path*/)
 {
+	CE_FATAL("File server is read-only");
 }
 
-void NetworkFilesystem::list_files(const char* /*path*/, Vector<DynamicString>& /*files*/)
+void NetworkFilesystem::list_files(const char* path, Vector<DynamicString>& files)
 {
+	CE_ASSERT_NOT_NULL(path);
+
+	ScopedMutex sm(_mutex);
+
+	FileResponse resp;
+	if (!send_request(FileRequestType::LIST, path, 0, 0) || !read_response(resp))
+		return;
+
+	Array<char> payload(default_allocator());
+	array::resize(payload, resp.size);
+	if (!read_payload(array::begin(payload), resp.size) || resp.status != 0)
+		return;
+
+	// Each entry is a FileStat followed by the length of the name and the
+	// null-terminated name
+	const char* cur = array::begin(payload);
+	const char* end = array::end(payload);
+	while (uint32_t(end - cur) >= sizeof(FileStat) + sizeof(uint32_t))
+	{
+		FileStat st;
+		memcpy(&st, cur, sizeof(st));
+		cur += sizeof(st);
+
+		uint32_t len;
+		memcpy(&len, cur, sizeof(len));
+		cur += sizeof(len);
+
+		if (len == 0 || len > uint32_t(end - cur) || cur[len - 1] != '\0')
+			return;
+
+		DynamicString name(cur, default_allocator());
+		cur += len;
+
+		TempAllocator512 ta;
+		DynamicString entry_path(ta);
+		if (path[0] == '\0')
+			entry_path = name.c_str();
+		else
+			path::join(path, name.c_str(), entry_path);
+		hash::set(_cache, path_key(entry_path.c_str()), st);
+
+		vector::push_back(files, name);
+	}
 }
 
 void NetworkFilesystem::get_absolute_path(const char* path, DynamicString& os_path)
 {
+	os_path = path;
+}
+
+void NetworkFilesystem::stat(const char* const* paths, uint32_t num, FileStat* stats)
+{
+	ScopedMutex sm(_mutex);
+
+	const FileStat none = { FileKind::NONE, 0, 0 };
+
+	// Send all the requests which are not cached, then collect the responses
+	bool sent = true;
+	uint32_t num_sent = 0;
+	for (uint32_t i = 0; i < num; i++)
+	{
+		stats[i] = hash::get(_cache, path_key(paths[i]), none);
+		if (stats[i].kind == FileKind::NONE && sent)
+		{
+			sent = send_request(FileRequestType::STAT, paths[i], 0, 0);
+			num_sent += sent ? 1 : 0;
+		}
+	}
+
+	// The paths whose response is lost are reported as missing
+	for (uint32_t i = 0; i < num && num_sent > 0; i++)
+	{
+		if (stats[i].kind != FileKind::NONE)
+			continue;
+
+		num_sent--;
+
+		FileResponse resp;
+		if (!read_response(resp))
+			return;
+
+		// Paths the server refuses to serve do not exist
+		if (resp.status != 0)
+		{
+			if (resp.size != 0)
+			{
+				disconnect();
+				return;
+			}
+			continue;
+		}
+
+		if (resp.size != sizeof(FileStat))
+		{
+			disconnect();
+			return;
+		}
+
+		if (!read_payload(&stats[i], sizeof(FileStat)))
+		{
+			stats[i] = none;
+			return;
+		}
+
+		// Missing files are not cached, they might be created later
+		if (stats[i].kind != FileKind::NONE)
+			hash::set(_cache, path_key(paths[i]), stats[i]);
+	}
+}
+
+FileStat NetworkFilesystem::stat(const char* path)
+{
+	CE_ASSERT_NOT_NULL(path);
+
+	FileStat st;
+	stat(&path, 1, &st);
+	return st;
+}
+
+uint32_t NetworkFilesystem::read(const char* path, uint64_t offset, void* data, uint32_t size)
+{
+	CE_ASSERT_NOT_NULL(path);
+
+	ScopedMutex sm(_mutex);
+
+	const uint32_t num_chunks = (size + FILE_SERVER_CHUNK_SIZE - 1) / FILE_SERVER_CHUNK_SIZE;
+	uint32_t num_sent = 0;
+	uint32_t num_received = 0;
+	uint32_t bytes_read = 0;
+	bool eof = false;
+
+	while (num_received < num_chunks)
+	{
+		// Keep the pipeline full
+		for (; num_sent < num_chunks && num_sent - num_received < FILE_SERVER_PIPELINE_DEPTH; num_sent++)
+		{
+			const uint32_t chunk_offt = num_sent * FILE_SERVER_CHUNK_SIZE;
+			const uint32_t chunk_size = size - chunk_offt < FILE_SERVER_CHUNK_SIZE ? size - chunk_offt : FILE_SERVER_CHUNK_SIZE;
+			if (!send_request(FileRequestType::READ, path, offset + chunk_offt, chunk_size))
+				return bytes_read;
+		}
+
+		const uint32_t chunk_offt = num_received * FILE_SERVER_CHUNK_SIZE;
+		const uint32_t chunk_size = size - chunk_offt < FILE_SERVER_CHUNK_SIZE ? size - chunk_offt : FILE_SERVER_CHUNK_SIZE;
+
+		FileResponse resp;
+		if (!read_response(resp))
+			return bytes_read;
+
+		if (resp.status != 0 || resp.size > chunk_size)
+		{
+			CE_LOGW("Unable to read: %s", path);
+			disconnect();
+			return bytes_read;
+		}
+
+		// Chunks past the end of the file come back empty
+		if (!read_payload((char*)data + chunk_offt, resp.size))
+			return bytes_read;
+		if (!eof)
+			bytes_read += resp.size;
+		eof = eof || resp.size < chunk_size;
+		num_received++;
+	}
+
+	return bytes_read;
+}
+
+void NetworkFilesystem::clear_cache()
+{
+	ScopedMutex sm(_mutex);
+	hash::clear(_cache);
+}
+
+bool NetworkFilesystem::connect()
+{
+	if (!_connected)
+	{
+		ConnectResult cr = _socket.connect(_address, _port);
+		if (cr.error != ConnectResult::NO_ERROR)
+		{
+			CE_LOGW("Unable to connect to the file server");
+			return false;
+		}
+		_connected = true;
+	}
+
+	return true;
+}
+
+void NetworkFilesystem::disconnect()
+{
+	_socket.close();
+	_connected = false;
+}
+
+bool NetworkFilesystem::send_request(FileRequestType::Enum type, const char* path, uint64_t offset, uint32_t size)
+{
+	// The server drops the connection on longer paths
+	const uint32_t path_length = strlen(path);
+	if (path_length > FILE_SERVER_MAX_PATH_LENGTH || !connect())
+		return false;
+
+	FileRequest req;
+	req.type = type;
+	req.path_length = path_length;
+	req.offset = offset;
+	req.size = size;
+	req._pad = 0;
+
+	// Send the request with a single write, small writes would be delayed
+	TempAllocator1024 ta;
+	Array<char> buf(ta);
+	array::push(buf, (const char*)&req, sizeof(req));
+	array::push(buf, path, req.path_length);
+
+	WriteResult wr = _socket.write(array::begin(buf), array::size(buf));
+	if (wr.error != WriteResult::NO_ERROR)
+	{
+		disconnect();
+		return false;
+	}
+
+	return true;
+}
+
+bool NetworkFilesystem::read_response(FileResponse& resp)
+{
+	return read_payload(&resp, sizeof(resp));
+}
+
+bool NetworkFilesystem::read_payload(void* data, uint32_t size)
+{
+	if (!_connected)
+		return false;
+
+	ReadResult rr = _socket.read(data, size);
+	if (rr.error != ReadResult::NO_ERROR)
+	{
+		CE_LOGW("File server disconnected");
+		disconnect();
+		return false;
+	}
 
+	return true;
 }
 
-TCPSocket NetworkFilesystem::new_connection()
+uint64_t NetworkFilesystem::path_key(const char* path)
 {
-	TCPSocket socket;
-	socket.connect(_address, _port);
-	return socket;
+	return murmur64(path, strlen(path), 0);
 }
 
 } // namespace crown
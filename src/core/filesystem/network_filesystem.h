@@ -7,56 +7,98 @@
 
 #include "filesystem.h"
 #include "socket.h"
-#include "os.h" // for max_path_length
-#include "log.h"
+#include "mutex.h"
+#include "container_types.h"
+
+/// Size of the chunks files are streamed in.
+#define FILE_SERVER_CHUNK_SIZE (64*1024)
+
+/// Maximum number of requests sent before reading the responses.
+#define FILE_SERVER_PIPELINE_DEPTH 8
+
+/// Maximum length of the paths sent to the file server.
+#define FILE_SERVER_MAX_PATH_LENGTH 1024
 
 namespace crown
 {
-namespace network_filesystem
+
+/// Enumerates the requests understood by the file server.
+///
+/// @ingroup Filesystem
+struct FileRequestType
 {
-	inline void read_response(TCPSocket socket, Array<char>& response)
+	enum Enum
 	{
-		// Read message length
-		uint32_t msg_len = 0;
-		socket.read(&msg_len, 4);
+		STAT, // Returns a FileStat
+		LIST, // Returns a FileStat, a length and a null-terminated name for each entry of a directory
+		READ, // Returns up to FileRequest::size bytes from FileRequest::offset
 
-		array::resize(response, msg_len);
-		socket.read(array::begin(response), msg_len);
+		COUNT
+	};
+};
 
-		// Ensure NUL-terminated
-		array::push_back(response, '\0');
-	}
+/// Request sent to the file server.
+/// It is followed by FileRequest::path_length characters of path.
+/// Requests can be pipelined, responses are sent back in the same order.
+/// Paths must be relative and must not contain ".." components, the
+/// server answers any other path with a non-zero status.
+/// Paths longer than FILE_SERVER_MAX_PATH_LENGTH close the connection.
+/// READ returns at most FILE_SERVER_CHUNK_SIZE bytes.
+///
+/// @ingroup Filesystem
+struct FileRequest
+{
+	uint32_t type;
+	uint32_t path_length;
+	uint64_t offset;
+	uint32_t size;
+	uint32_t _pad;
+};
 
-	inline void send(TCPSocket socket, const char* msg)
-	{
-		uint32_t msg_len = strlen(msg);
-		socket.write(&msg_len, 4);
-		socket.write(msg, msg_len);
-	}
-} // namespace network_filesystem
-
-/// Access files on a remote file server.
-/// All the file paths can be either relative or absolute.
-/// When a relative path is given, it is automatically translated
-/// to its absolute counterpart based on the file server's root path.
-/// Accessing files using absolute path directly is also possible,
-/// but platform-specific and thus generally not recommended.
+/// Response sent back by the file server.
+/// It is followed by FileResponse::size bytes of payload.
+///
+/// @ingroup Filesystem
+struct FileResponse
+{
+	uint32_t status; // 0 on success
+	uint32_t size;
+};
+
+/// Metadata of a file on the file server.
+///
+/// @ingroup Filesystem
+struct FileStat
+{
+	uint32_t kind;
+	uint32_t _pad;
+	uint64_t size;
+};
+
+/// Access files on a remote file server (see FileServer).
+/// All the requests go through a single persistent connection,
+/// the metadata of the files is cached on the client.
+/// Opening a file always fetches its current size from the server.
+/// The paths are relative to the directory served by the server.
+/// When the server misbehaves or the connection drops, the files are
+/// reported as missing and the reads as short, the next request connects again.
 ///
 /// @ingroup Filesystem
 class NetworkFilesystem : public Filesystem
 {
 public:
 
-	/// Sets the root path to the current working directory of
-	/// the engine executable.
+	/// Connects to the file server on the local host.
 	NetworkFilesystem();
 
-	/// Sets the file server address and port.
-	/// @note
-	/// The @a root_path must be absolute.
+	/// Connects to the file server at the given @a addr and @a port.
 	NetworkFilesystem(const NetAddress& addr, uint16_t port);
+	~NetworkFilesystem();
 
 	/// Opens the file at the given @a path with the given @a mode.
+	/// The metadata of the file is requested again and cached.
+	/// @note
+	/// @a mode can only be FOM_READ
 	File* open(const char* path, FileOpenMode mode);
 
 	/// Closes the given @a file.
@@ -71,35 +113,65 @@ public:
 	/// Returns true if @a path is a regular file.
 	bool is_file(const char* path);
 
-	/// Creates the directory at the given @a path.
+	/// Not supported, the file server is read-only.
 	void create_directory(const char* path);
 
-	/// Deletes the directory at the given @a path.
+	/// Not supported, the file server is read-only.
 	void delete_directory(const char* path);
 
-	/// Creates the file at the given @a path.
+	/// Not supported, the file server is read-only.
 	void create_file(const char* path);
 
-	/// Deletes the file at the given @a path.
+	/// Not supported, the file server is read-only.
 	void delete_file(const char* path);
 
 	/// Returns the relative file names in the given @a path.
+	/// The metadata of all the entries is cached as well.
 	void list_files(const char* path, Vector<DynamicString>& files);
 
-	/// Returns the absolute path of the given @a path based on
-	/// the root path of the file source. If @a path is absolute,
-	/// the given path is returned.
+	/// Returns @a path unchanged.
 	void get_absolute_path(const char* path, DynamicString& os_path);
 
+	/// Returns the metadata of the @a num @a paths in @a stats
+	/// with a single round trip to the server.
+	void stat(const char* const* paths, uint32_t num, FileStat* stats);
+
+	/// Reads @a size bytes at @a offset of the file at @a path into @a data.
+	/// Large reads are split in chunks which are requested all at once.
+	/// Returns the number of bytes read, which is less than @a size past the
+	/// end of the file or when the read fails.
+	uint32_t read(const char* path, uint64_t offset, void* data, uint32_t size);
+
+	/// Forgets the cached metadata, e.g. after the files on the server changed.
+	void clear_cache();
+
 private:
 
-	// Returns a new connection to the file server
-	TCPSocket new_connection();
+	// Returns the metadata of @a path.
+	FileStat stat(const char* path);
+
+	// Connects to the file server unless connected already.
+	// Returns false if the server can not be reached.
+	bool connect();
+
+	// Drops the connection and the responses still in flight.
+	void disconnect();
+
+	// Each of these returns false, after dropping the connection, on failure.
+	bool send_request(FileRequestType::Enum type, const char* path, uint64_t offset, uint32_t size);
+	bool read_response(FileResponse& resp);
+	bool read_payload(void* data, uint32_t size);
+
+	static uint64_t path_key(const char* path);
 
 private:
 
 	NetAddress _address;
 	uint16_t _port;
+	TCPSocket _socket;
+	bool _connected;
+	Mutex _mutex;
+	Hash<FileStat> _cache;
 };
 
 } // namespace crown
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "types.h"
+#include "error.h"
+#include "macros.h"
+#include "config.h"
+
+#if CROWN_PLATFORM_POSIX
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#elif CROWN_PLATFORM_WINDOWS
+	#include "win_headers.h"
+#endif
+
+namespace crown
+{
+
+/// Read-only memory mapping of a whole file.
+class OsFileMapping
+{
+public:
+
+	/// Maps the file located at @a path in memory.
+	OsFileMapping(const char* path)
+		: _data(NULL)
+		, _size(0)
+#if CROWN_PLATFORM_WINDOWS
+		, _file(INVALID_HANDLE_VALUE)
+		, _mapping(NULL)
+#endif
+	{
+#if CROWN_PLATFORM_POSIX
+		int fd = ::open(path, O_RDONLY);
+		CE_ASSERT(fd != -1, "Unable to open file: %s", path);
+
+		struct stat info;
+		int err = fstat(fd, &info);
+		CE_ASSERT(err == 0, "fstat: errno = %d", errno);
+		CE_UNUSED(err);
+		_size = (size_t) info.st_size;
+
+		if (_size != 0)
+		{
+			void* data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+			CE_ASSERT(data != MAP_FAILED, "mmap: errno = %d", errno);
+			_data = (const char*) data;
+		}
+
+		// The mapping keeps its own reference to the file
+		::close(fd);
+#elif CROWN_PLATFORM_WINDOWS
+		_file = CreateFile(path,
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			NULL,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL,
+			NULL);
+		CE_ASSERT(_file != INVALID_HANDLE_VALUE, "Unable to open file: %s", path);
+		_size = GetFileSize(_file, NULL);
+
+		if (_size != 0)
+		{
+			_mapping = CreateFileMapping(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+			CE_ASSERT(_mapping != NULL, "CreateFileMapping: GetLastError = %d", GetLastError());
+			_data = (const char*) MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+			CE_ASSERT(_data != NULL, "MapViewOfFile: GetLastError = %d", GetLastError());
+		}
+#endif
+	}
+
+	~OsFileMapping()
+	{
+#if CROWN_PLATFORM_POSIX
+		if (_data != NULL)
+			munmap((void*) _data, _size);
+#elif CROWN_PLATFORM_WINDOWS
+		if (_data != NULL)
+			UnmapViewOfFile(_data);
+		if (_mapping != NULL)
+			CloseHandle(_mapping);
+		if (_file != INVALID_HANDLE_VALUE)
+			CloseHandle(_file);
+#endif
+	}
+
+	/// Returns the first byte of the mapped file.
+	const char* data() const
+	{
+		return _data;
+	}
+
+	/// Returns the size of the mapped file in bytes.
+	size_t size() const
+	{
+		return _size;
+	}
+
+	/// Starts paging in the @a size bytes at @a offset in the background.
+	void prefetch(size_t offset, size_t size) const
+	{
+#if CROWN_PLATFORM_POSIX
+		// madvise() wants a page aligned address
+		const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+		const size_t begin = offset & ~(page - 1);
+		if (_data != NULL && size != 0)
+			madvise((void*)(_data + begin), offset + size - begin, MADV_WILLNEED);
+#else
+		CE_UNUSED(offset);
+		CE_UNUSED(size);
+#endif
+	}
+
+private:
+
+	const char* _data;
+	size_t _size;
+#if CROWN_PLATFORM_WINDOWS
+	HANDLE _file;
+	HANDLE _mapping;
+#endif
+
+private:
+
+	// Disable copying
+	OsFileMapping(const OsFileMapping&);
+	OsFileMapping& operator=(const OsFileMapping&);
+};
+
+} // namespace crown
@@ -7,6 +7,8 @@
 
 #include "types.h"
 #include "file.h"
+#include "error.h"
+#include <string.h> // memcpy
 
 namespace crown
 {
@@ -110,33 +112,94 @@ private:
 };
 
 /// A reader that offers a convenient way to read from a File
+/// Small reads are served from an internal buffer which is filled
+/// with a single File::read(), large ones go straight to the file.
+/// The file must not be accessed directly while the reader is alive.
 ///
 /// @ingroup Filesystem
 class BinaryReader
 {
 public:
 
-	BinaryReader(File& file) : _file(file) {}
+	BinaryReader(File& file)
+		: _file(file)
+		, _pos(0)
+		, _end(0)
+	{
+	}
+
+	/// Gives back the bytes read ahead, so that the file can
+	/// be used directly again.
+	~BinaryReader()
+	{
+		if (_pos != _end && _file.can_seek())
+			_file.seek(_file.position() - (_end - _pos));
+	}
 
 	void read(void* data, size_t size)
 	{
-		_file.read(data, size);
+		const size_t buffered = _end - _pos;
+
+		if (size <= buffered)
+		{
+			memcpy(data, _buffer + _pos, size);
+			_pos += (uint32_t)size;
+			return;
+		}
+
+		memcpy(data, _buffer + _pos, buffered);
+		data = (char*)data + buffered;
+		size -= buffered;
+		_pos = _end = 0;
+
+		if (size >= sizeof(_buffer))
+		{
+			_file.read(data, size);
+			return;
+		}
+
+		fill();
+		CE_ASSERT(size <= _end, "Unexpected end of file");
+		memcpy(data, _buffer, size);
+		_pos = (uint32_t)size;
 	}
 
 	template <typename T>
 	void read(T& data)
 	{
-		_file.read(&data, sizeof(T));
+		read(&data, sizeof(T));
 	}
 
 	void skip(size_t bytes)
 	{
-		_file.skip(bytes);
+		const size_t buffered = _end - _pos;
+
+		if (bytes <= buffered)
+		{
+			_pos += (uint32_t)bytes;
+			return;
+		}
+
+		_pos = _end = 0;
+		_file.skip(bytes - buffered);
+	}
+
+private:
+
+	void fill()
+	{
+		const size_t left = _file.size() - _file.position();
+		_end = (uint32_t)(left < sizeof(_buffer) ? left : sizeof(_buffer));
+		_file.read(_buffer, _end);
+		_pos = 0;
 	}
 
 private:
 
 	File& _file;
+	char _buffer[4096];
+	uint32_t _pos;
+	uint32_t _end;
 };
 
 } // namespace crown
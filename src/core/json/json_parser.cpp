@@ -9,6 +9,8 @@
 #include "string_utils.h"
 #include "vector.h"
 #include "map.h"
+#include "hash.h"
+#include "murmur.h"
 #include "vector2.h"
 #include "vector3.h"
 #include "vector4.h"
@@ -19,18 +21,33 @@
 namespace crown
 {
 
+static const uint32_t INVALID = 0xffffffffu;
+
 JSONElement::JSONElement()
 	: _at(NULL)
+	, _parser(NULL)
+	, _node(0)
 {
 }
 
 JSONElement::JSONElement(const char* at)
 	: _at(at)
+	, _parser(NULL)
+	, _node(0)
+{
+}
+
+JSONElement::JSONElement(const JSONParser* parser, uint32_t node)
+	: _at(parser->_nodes[node].at)
+	, _parser(parser)
+	, _node(node)
 {
 }
 
 JSONElement::JSONElement(const JSONElement& other)
 	: _at(other._at)
+	, _parser(other._parser)
+	, _node(other._node)
 {
 }
 
@@ -38,11 +55,20 @@ JSONElement& JSONElement::operator=(const JSONElement& other)
 {
 	// Our begin is the other's at
 	_at = other._at;
+	_parser = other._parser;
+	_node = other._node;
 	return *this;
 }
 
 JSONElement JSONElement::operator[](uint32_t i)
 {
+	if (_parser != NULL)
+	{
+		const JSONParser::Node& node = _parser->_nodes[_node];
+		CE_ASSERT(i < node.size, "Index out of bounds");
+		return JSONElement(_parser, _parser->_items[node.first + i]);
+	}
+
 	Array<const char*> array(default_allocator());
 
 	njson::parse_array(_at, array);
@@ -59,6 +85,12 @@ JSONElement JSONElement::index(uint32_t i)
 
 JSONElement JSONElement::index_or_nil(uint32_t i)
 {
+	if (_parser != NULL)
+	{
+		const JSONParser::Node& node = _parser->_nodes[_node];
+		return i < node.size ? JSONElement(_parser, _parser->_items[node.first + i]) : JSONElement();
+	}
+
 	if (_at != NULL)
 	{
 		Array<const char*> array(default_allocator());
@@ -78,6 +110,13 @@ JSONElement JSONElement::index_or_nil(uint32_t i)
 
 JSONElement JSONElement::key(const char* k)
 {
+	if (_parser != NULL)
+	{
+		const uint32_t member = _parser->find_member(_node, k);
+		CE_ASSERT(member != INVALID, "Key not found: '%s'", k);
+		return JSONElement(_parser, _parser->_members[member].value);
+	}
+
 	Map<DynamicString, const char*> object(default_allocator());
 	njson::parse(_at, object);
 
@@ -89,6 +128,12 @@ JSONElement JSONElement::key(const char* k)
 
 JSONElement JSONElement::key_or_nil(const char* k)
 {
+	if (_parser != NULL)
+	{
+		const uint32_t member = _parser->find_member(_node, k);
+		return member != INVALID ? JSONElement(_parser, _parser->_members[member].value) : JSONElement();
+	}
+
 	if (_at != NULL)
 	{
 		Map<DynamicString, const char*> object(default_allocator());
@@ -105,6 +150,9 @@ JSONElement JSONElement::key_or_nil(const char* k)
 
 bool JSONElement::has_key(const char* k) const
 {
+	if (_parser != NULL)
+		return _parser->find_member(_node, k) != INVALID;
+
 	Map<DynamicString, const char*> object(default_allocator());
 	njson::parse(_at, object);
 
@@ -309,6 +357,17 @@ void JSONElement::to_array(Vector<DynamicString>& array) const
 
 void JSONElement::to_keys(Vector<DynamicString>& keys) const
 {
+	if (_parser != NULL)
+	{
+		const JSONParser::Node& node = _parser->_nodes[_node];
+		for (uint32_t i = 0; i < node.size; i++)
+		{
+			const JSONParser::Member& m = _parser->_members[node.first + i];
+			vector::push_back(keys, DynamicString(&_parser->_keys[m.key]));
+		}
+		return;
+	}
+
 	Map<DynamicString, const char*> object(default_allocator());
 	njson::parse(_at, object);
 
@@ -387,6 +446,13 @@ uint32_t JSONElement::size() const
 		return 0;
 	}
 
+	if (_parser != NULL)
+	{
+		const JSONParser::Node& node = _parser->_nodes[_node];
+		if (node.type == NJSONValueType::ARRAY || node.type == NJSONValueType::OBJECT)
+			return node.size;
+	}
+
 	switch(njson::type(_at))
 	{
 		case NJSONValueType::NIL:
@@ -430,27 +496,45 @@ uint32_t JSONElement::size() const
 JSONParser::JSONParser(const char* s)
 	: _file(false)
 	, _document(s)
+	, _nodes(default_allocator())
+	, _items(default_allocator())
+	, _members(default_allocator())
+	, _keys(default_allocator())
+	, _lookup(default_allocator())
 {
 	CE_ASSERT_NOT_NULL(s);
+	build_index();
 }
 
 JSONParser::JSONParser(File& f)
 	: _file(true)
 	, _document(NULL)
+	, _nodes(default_allocator())
+	, _items(default_allocator())
+	, _members(default_allocator())
+	, _keys(default_allocator())
+	, _lookup(default_allocator())
 {
 	const size_t size = f.size();
 	char* doc = (char*) default_allocator().allocate(size + 1);
 	f.read(doc, size);
 	doc[size] = '\0';
 	_document = doc;
+	build_index();
 }
 
 JSONParser::JSONParser(Buffer& b)
 	: _file(false)
 	, _document(NULL)
+	, _nodes(default_allocator())
+	, _items(default_allocator())
+	, _members(default_allocator())
+	, _keys(default_allocator())
+	, _lookup(default_allocator())
 {
 	array::push_back(b, '\0');
 	_document = array::begin(b);
+	build_index();
 }
 
 JSONParser::~JSONParser()
@@ -463,10 +547,173 @@ JSONParser::~JSONParser()
 
 JSONElement JSONParser::root()
 {
-	const char* ch = _document;
-	while ((*ch) && (*ch) <= ' ') ch++;
+	return JSONElement(this, 0);
+}
+
+// Returns whether @a json starts with "key =", i.e. the document is an object without braces
+static bool is_root_object(const char* json)
+{
+	if (*json == '\0')
+		return true;
+
+	if (*json == '"')
+		json = njson::skip_value(json);
+	else if (isalpha(*json))
+		while (*json != '\0' && !isspace(*json) && *json != '=') json++;
+	else
+		return false;
+
+	return *njson::skip_spaces(json) == '=';
+}
+
+void JSONParser::build_index()
+{
+	// Children are collected here while their parent is parsed,
+	// then moved to the index so that they are contiguous
+	Array<uint32_t> items(default_allocator());
+	Array<Member> members(default_allocator());
+
+	const char* at = _document;
+	while ((*at) && (*at) <= ' ') at++;
+
+	const char* json = njson::skip_spaces(at);
+	if (is_root_object(json))
+	{
+		const Node root = { at, NJSONValueType::OBJECT, 0, 0 };
+		array::push_back(_nodes, root);
+		parse_object(0, json, '\0', items, members);
+	}
+	else
+	{
+		parse_value(json, items, members);
+		_nodes[0].at = at;
+	}
+}
+
+const char* JSONParser::parse_value(const char* json, Array<uint32_t>& items, Array<Member>& members)
+{
+	const uint32_t node = array::size(_nodes);
+	const Node n = { json, njson::type(json), 0, 0 };
+	array::push_back(_nodes, n);
+
+	switch (*json)
+	{
+		case '[': return parse_array(node, json + 1, items, members);
+		case '{': return parse_object(node, json + 1, '}', items, members);
+		default:
+		{
+			const char* end = njson::skip_value(json);
+			CE_ASSERT(end != json, "Bad value: '%c'", *json);
+			return end != json ? end : json + 1;
+		}
+	}
+}
+
+const char* JSONParser::parse_array(uint32_t node, const char* json, Array<uint32_t>& items, Array<Member>& members)
+{
+	const uint32_t base = array::size(items);
+
+	json = njson::skip_spaces(json);
+	while (*json != ']' && *json != '\0')
+	{
+		array::push_back(items, array::size(_nodes));
+		json = parse_value(json, items, members);
+		json = njson::skip_spaces(json);
+	}
+	CE_ASSERT(*json == ']', "Bad array");
+
+	const uint32_t num = array::size(items) - base;
+	_nodes[node].first = array::size(_items);
+	_nodes[node].size = num;
+	array::push(_items, array::begin(items) + base, num);
+	array::resize(items, base);
+
+	return *json != '\0' ? json + 1 : json;
+}
+
+const char* JSONParser::parse_object(uint32_t node, const char* json, char end, Array<uint32_t>& items, Array<Member>& members)
+{
+	const uint32_t base = array::size(members);
+
+	json = njson::skip_spaces(json);
+	while (*json != end && *json != '\0')
+	{
+		Member m;
+		m.key = array::size(_keys);
+		json = parse_key(json);
+
+		json = njson::skip_spaces(json);
+		CE_ASSERT(*json == '=', "Expected '=' got '%c'", *json);
+		json = njson::skip_spaces(json + 1);
+
+		m.value = array::size(_nodes);
+		json = parse_value(json, items, members);
+		array::push_back(members, m);
+
+		json = njson::skip_spaces(json);
+	}
+	CE_ASSERT(*json == end, "Bad object");
+
+	_nodes[node].first = array::size(_members);
+	_nodes[node].size = 0;
+	for (uint32_t i = base; i < array::size(members); i++)
+	{
+		const char* key = &_keys[members[i].key];
+
+		// The last value of a repeated key wins
+		const uint32_t member = find_member(node, key);
+		if (member != INVALID)
+		{
+			_members[member].value = members[i].value;
+			continue;
+		}
+
+		multi_hash::insert(_lookup, murmur64(key, (int) strlen(key), node), array::size(_members));
+		array::push_back(_members, members[i]);
+		_nodes[node].size++;
+	}
+	array::resize(members, base);
+
+	return *json != '\0' ? json + 1 : json;
+}
+
+const char* JSONParser::parse_key(const char* json)
+{
+	if (*json == '"')
+	{
+		TempAllocator256 ta;
+		DynamicString key(ta);
+		njson::parse_string(json, key);
+		array::push(_keys, key.c_str(), key.length() + 1);
+		return njson::skip_value(json);
+	}
+
+	CE_ASSERT(isalpha(*json), "Bad key");
+	const char* begin = json;
+	while (*json != '\0' && !isspace(*json) && *json != '=')
+		json++;
+
+	array::push(_keys, begin, uint32_t(json - begin));
+	array::push_back(_keys, '\0');
+	return json;
+}
+
+uint32_t JSONParser::find_member(uint32_t node, const char* key) const
+{
+	const Node& n = _nodes[node];
+	if (n.type != NJSONValueType::OBJECT)
+		return INVALID;
+
+	// The hash is seeded with the object, collisions are checked anyway
+	const uint64_t hash = murmur64(key, (int) strlen(key), node);
+	const Hash<uint32_t>::Entry* e = multi_hash::find_first(_lookup, hash);
+	for (; e != NULL; e = multi_hash::find_next(_lookup, e))
+	{
+		if (e->value >= n.first && e->value < n.first + n.size && strcmp(&_keys[_members[e->value].key], key) == 0)
+			return e->value;
+	}
 
-	return JSONElement(ch);
+	return INVALID;
 }
 
 } //namespace crown
@@ -11,6 +11,7 @@
 #include "matrix4x4.h"
 #include "quaternion.h"
 #include "macros.h"
+#include "njson.h"
 
 namespace crown
 {
@@ -23,6 +24,10 @@ class File;
 /// The objects of this class are valid until the parser
 /// which has generated them, will exist.
 ///
+/// Elements obtained from a JSONParser use its index, array items
+/// and object keys are found in constant time. Elements constructed
+/// from a string parse it again at each access.
+///
 /// @ingroup JSON
 class JSONElement
 {
@@ -156,13 +161,20 @@ public:
 
 private:
 
+	JSONElement(const JSONParser* parser, uint32_t node);
+
 	const char* _at;
+	const JSONParser* _parser; // NULL if the element is not indexed
+	uint32_t _node;
 
 	friend class JSONParser;
 };
 
 /// Parses JSON documents.
 ///
+/// The document is scanned once on construction into a flat index
+/// of its values, the strings are parsed only when read.
+///
 /// @ingroup JSON
 class JSONParser
 {
@@ -187,14 +199,42 @@ public:
 
 private:
 
+	struct Node
+	{
+		const char* at;
+		NJSONValueType::Enum type;
+		uint32_t first; // First item of arrays or member of objects
+		uint32_t size;  // Number of items of arrays or members of objects
+	};
+
+	struct Member
+	{
+		uint32_t key;   // Offset into _keys
+		uint32_t value; // Index into _nodes
+	};
+
+	void build_index();
+	const char* parse_value(const char* json, Array<uint32_t>& items, Array<Member>& members);
+	const char* parse_array(uint32_t node, const char* json, Array<uint32_t>& items, Array<Member>& members);
+	const char* parse_object(uint32_t node, const char* json, char end, Array<uint32_t>& items, Array<Member>& members);
+	const char* parse_key(const char* json);
+	uint32_t find_member(uint32_t node, const char* key) const;
+
 	bool _file;
 	const char* _document;
+	Array<Node> _nodes;
+	Array<uint32_t> _items;
+	Array<Member> _members;
+	Array<char> _keys;
+	Hash<uint32_t> _lookup; // Hash of the object and key to index into _members
 
 private:
 
 	// Disable copying
 	JSONParser(const JSONParser&);
 	JSONParser& operator=(const JSONParser&);
+
+	friend class JSONElement;
 };
 
 } // namespace crown
@@ -44,7 +44,7 @@ namespace njson
 		return json;
 	}
 
-	static const char* skip_value(const char* json)
+	const char* skip_value(const char* json)
 	{
 		CE_ASSERT_NOT_NULL(json);
 
@@ -87,7 +87,7 @@ namespace njson
 		return json;
 	}
 
-	static const char* skip_spaces(const char* json)
+	const char* skip_spaces(const char* json)
 	{
 		CE_ASSERT_NOT_NULL(json);
 
@@ -62,5 +62,11 @@ namespace njson
 
 	/// Parses the NJSON-encoded @a json.
 	void parse(const char* json, Map<DynamicString, const char*>& object);
+
+	/// Returns the pointer past the spaces, commas and comments at the beginning of @a json.
+	const char* skip_spaces(const char* json);
+
+	/// Returns the pointer past the value at the beginning of @a json.
+	const char* skip_value(const char* json);
 } // namespace njson
 } // namespace crown
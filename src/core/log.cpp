@@ -7,6 +7,7 @@
 #include "console_server.h"
 #include "string_utils.h"
 #include "os.h"
+#include "mutex.h"
 
 #if CROWN_DEBUG
 
@@ -14,8 +15,13 @@ namespace crown
 {
 namespace log_internal
 {
+	// Keeps the messages logged by different threads whole
+	static Mutex s_mutex;
+
 	void logx(LogSeverity::Enum sev, const char* msg, va_list args)
 	{
+		ScopedMutex sm(s_mutex);
+
 		char buf[2048];
 		int len = vsnprintf(buf, sizeof(buf), msg, args);
 		if (len > (int)sizeof(buf))
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#include "lz4.h"
+#include <string.h> // memcpy, memset
+
+namespace crown
+{
+namespace lz4
+{
+	static const uint32_t MIN_MATCH = 4;
+	static const uint32_t LAST_LITERALS = 5; // The last bytes are always literals
+	static const uint32_t MF_LIMIT = 12;     // The last match must start before this many bytes from the end
+	static const uint32_t MAX_DISTANCE = 65535;
+	static const uint32_t HASH_LOG = 12;
+
+	inline uint32_t read32(const uint8_t* p)
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline uint32_t hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HASH_LOG);
+	}
+
+	inline uint8_t* write_length(uint8_t* op, uint32_t len)
+	{
+		for (; len >= 255; len -= 255)
+			*op++ = 255;
+		*op++ = (uint8_t)len;
+		return op;
+	}
+
+	inline uint8_t* write_literals(uint8_t* op, uint8_t* token, const uint8_t* literals, uint32_t len)
+	{
+		if (len >= 15)
+		{
+			*token = 15 << 4;
+			op = write_length(op, len - 15);
+		}
+		else
+		{
+			*token = (uint8_t)(len << 4);
+		}
+
+		memcpy(op, literals, len);
+		return op + len;
+	}
+
+	inline bool read_length(const uint8_t*& ip, const uint8_t* end, uint32_t& len)
+	{
+		uint8_t b;
+		do
+		{
+			if (ip == end)
+				return false;
+			b = *ip++;
+			len += b;
+		}
+		while (b == 255);
+		return true;
+	}
+
+	uint32_t compress_bound(uint32_t size)
+	{
+		return size + size / 255 + 16;
+	}
+
+	uint32_t compress(const void* src, uint32_t size, void* dst)
+	{
+		const uint8_t* in = (const uint8_t*)src;
+		uint8_t* op = (uint8_t*)dst;
+
+		uint32_t table[1 << HASH_LOG];
+		memset(table, 0, sizeof(table));
+
+		uint32_t anchor = 0;
+		uint32_t ip = 0;
+
+		if (size > MF_LIMIT)
+		{
+			const uint32_t match_limit = size - MF_LIMIT;
+			const uint32_t end_limit = size - LAST_LITERALS;
+
+			while (ip < match_limit)
+			{
+				const uint32_t sequence = read32(in + ip);
+				const uint32_t h = hash(sequence);
+				const uint32_t ref = table[h];
+				table[h] = ip;
+
+				if (ref >= ip || ip - ref > MAX_DISTANCE || read32(in + ref) != sequence)
+				{
+					ip++;
+					continue;
+				}
+
+				uint32_t len = MIN_MATCH;
+				while (ip + len < end_limit && in[ref + len] == in[ip + len])
+					len++;
+
+				uint8_t* token = op++;
+				op = write_literals(op, token, in + anchor, ip - anchor);
+
+				const uint32_t offset = ip - ref;
+				*op++ = (uint8_t)(offset & 0xff);
+				*op++ = (uint8_t)(offset >> 8);
+
+				const uint32_t ml = len - MIN_MATCH;
+				if (ml >= 15)
+				{
+					*token |= 15;
+					op = write_length(op, ml - 15);
+				}
+				else
+				{
+					*token |= (uint8_t)ml;
+				}
+
+				ip += len;
+				anchor = ip;
+			}
+		}
+
+		uint8_t* token = op++;
+		op = write_literals(op, token, in + anchor, size - anchor);
+
+		return uint32_t(op - (uint8_t*)dst);
+	}
+
+	bool decompress(const void* src, uint32_t size, void* dst, uint32_t dst_size)
+	{
+		const uint8_t* ip = (const uint8_t*)src;
+		const uint8_t* end = ip + size;
+		uint8_t* op = (uint8_t*)dst;
+		uint8_t* op_end = op + dst_size;
+
+		while (ip < end)
+		{
+			const uint8_t token = *ip++;
+
+			uint32_t lit = token >> 4;
+			if (lit == 15 && !read_length(ip, end, lit))
+				return false;
+			if (lit > uint32_t(end - ip) || lit > uint32_t(op_end - op))
+				return false;
+
+			memcpy(op, ip, lit);
+			ip += lit;
+			op += lit;
+
+			// The last sequence has no match
+			if (ip == end)
+				break;
+
+			if (end - ip < 2)
+				return false;
+			const uint32_t offset = ip[0] | (ip[1] << 8);
+			ip += 2;
+			if (offset == 0 || offset > uint32_t(op - (uint8_t*)dst))
+				return false;
+
+			uint32_t len = token & 15;
+			if (len == 15 && !read_length(ip, end, len))
+				return false;
+			len += MIN_MATCH;
+			if (len > uint32_t(op_end - op))
+				return false;
+
+			// Matches can overlap the bytes being written
+			const uint8_t* match = op - offset;
+			for (uint32_t i = 0; i < len; i++)
+				op[i] = match[i];
+			op += len;
+		}
+
+		return op == op_end;
+	}
+} // namespace lz4
+} // namespace crown
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "types.h"
+
+namespace crown
+{
+
+/// Compression of memory blocks in the LZ4 block format.
+namespace lz4
+{
+	/// Returns the maximum size of @a size bytes once compressed.
+	uint32_t compress_bound(uint32_t size);
+
+	/// Compresses the @a size bytes at @a src into @a dst, which must be
+	/// at least compress_bound(@a size) bytes long.
+	/// Returns the size of the compressed data.
+	uint32_t compress(const void* src, uint32_t size, void* dst);
+
+	/// Decompresses the @a size bytes at @a src into the @a dst_size bytes at @a dst.
+	/// Returns false if @a src is corrupted or does not decompress to exactly @a dst_size bytes.
+	bool decompress(const void* src, uint32_t size, void* dst, uint32_t dst_size);
+} // namespace lz4
+
+} // namespace crown
@@ -164,6 +164,7 @@ namespace memory_globals
 	// Create default allocators
 	char _buffer[1024];
 	HeapAllocator* _default_allocator = NULL;
+	CE_THREAD Allocator* _thread_allocator = NULL;
 
 	void init()
 	{
@@ -174,10 +175,18 @@ namespace memory_globals
 	{
 		_default_allocator->~HeapAllocator();
 	}
+
+	void set_thread_allocator(Allocator* allocator)
+	{
+		_thread_allocator = allocator;
+	}
 } // namespace memory_globals
 
 Allocator& default_allocator()
 {
+	if (memory_globals::_thread_allocator != NULL)
+		return *memory_globals::_thread_allocator;
+
 	return *memory_globals::_default_allocator;
 }
 
@@ -61,6 +61,10 @@ namespace memory_globals
 	/// @note
 	/// Should be the last call of the program.
 	void shutdown();
+
+	/// Makes default_allocator() return @a allocator on the calling thread.
+	/// Passing NULL restores the allocator created with memory_globals::init().
+	void set_thread_allocator(Allocator* allocator);
 } // namespace memory_globals
 } // namespace crown
 
@@ -13,6 +13,7 @@ namespace crown
 ProxyAllocator::ProxyAllocator(const char* name, Allocator& allocator)
 	: _name(name)
 	, _allocator(allocator)
+	, _total_allocated(0)
 {
 	CE_ASSERT(name != NULL, "Name must be != NULL");
 }
@@ -20,16 +21,30 @@ ProxyAllocator::ProxyAllocator(const char* name, Allocator& allocator)
 void* ProxyAllocator::allocate(uint32_t size, uint32_t align)
 {
 	void* p = _allocator.allocate(size, align);
-	ALLOCATE_MEMORY(_name, _allocator.allocated_size(p));
+	const uint32_t allocated = _allocator.allocated_size(p);
+	ALLOCATE_MEMORY(_name, allocated);
+	if (allocated != SIZE_NOT_TRACKED)
+		_total_allocated.fetch_add((int)allocated);
 	return p;
 }
 
 void ProxyAllocator::deallocate(void* data)
 {
-	DEALLOCATE_MEMORY(_name, (data == NULL) ? 0 :_allocator.allocated_size((const void*)data));
+	const uint32_t allocated = (data == NULL) ? 0 :_allocator.allocated_size((const void*)data);
+	DEALLOCATE_MEMORY(_name, allocated);
+	if (allocated != SIZE_NOT_TRACKED)
+		_total_allocated.fetch_add(-(int)allocated);
 	_allocator.deallocate(data);
 }
 
+uint32_t ProxyAllocator::total_allocated()
+{
+	if (_allocator.total_allocated() == SIZE_NOT_TRACKED)
+		return SIZE_NOT_TRACKED;
+
+	return (uint32_t)_total_allocated.load();
+}
+
 const char* ProxyAllocator::name() const
 {
 	return _name;
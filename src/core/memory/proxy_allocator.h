@@ -6,6 +6,7 @@
 #pragma once
 
 #include "allocator.h"
+#include "atomic_int.h"
 
 namespace crown
 {
@@ -32,7 +33,9 @@ public:
 	uint32_t allocated_size(const void* /*ptr*/) { return SIZE_NOT_TRACKED; }
 
 	/// @copydoc Allocator::total_allocated()
-	uint32_t total_allocated() { return SIZE_NOT_TRACKED; }
+	/// @note
+	/// Only memory allocated through this proxy is taken into account.
+	uint32_t total_allocated();
 
 	/// Returns the name of the proxy allocator
 	const char* name() const;
@@ -41,6 +44,7 @@ private:
 
 	const char* _name;
 	Allocator& _allocator;
+	AtomicInt _total_allocated;
 };
 
 } // namespace crown
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#include "tracking_allocator.h"
+#include "memory.h"
+
+namespace crown
+{
+
+TrackingAllocator::TrackingAllocator(Allocator& backing)
+	: _backing(backing)
+	, _first(NULL)
+	, _total_allocated(0)
+{
+}
+
+TrackingAllocator::~TrackingAllocator()
+{
+	clear();
+}
+
+void* TrackingAllocator::allocate(uint32_t size, uint32_t align)
+{
+	// The header goes right before the returned pointer
+	align = align > CE_ALIGNOF(Header) ? align : CE_ALIGNOF(Header);
+
+	void* block = _backing.allocate(sizeof(Header) + align + size, CE_ALIGNOF(Header));
+	void* p = memory::align_top((char*)block + sizeof(Header), align);
+
+	Header* h = (Header*)p - 1;
+	h->prev = NULL;
+	h->next = _first;
+	h->block = block;
+	h->size = size;
+
+	if (_first != NULL)
+		_first->prev = h;
+	_first = h;
+
+	_total_allocated += size;
+	return p;
+}
+
+void TrackingAllocator::deallocate(void* data)
+{
+	if (!data)
+		return;
+
+	Header* h = (Header*)data - 1;
+
+	if (h->prev != NULL)
+		h->prev->next = h->next;
+	else
+		_first = h->next;
+
+	if (h->next != NULL)
+		h->next->prev = h->prev;
+
+	_total_allocated -= h->size;
+	_backing.deallocate(h->block);
+}
+
+uint32_t TrackingAllocator::clear()
+{
+	uint32_t num = 0;
+
+	while (_first != NULL)
+	{
+		Header* next = _first->next;
+		_backing.deallocate(_first->block);
+		_first = next;
+		num++;
+	}
+
+	_total_allocated = 0;
+	return num;
+}
+
+uint32_t TrackingAllocator::allocated_size(const void* ptr)
+{
+	return ((const Header*)ptr - 1)->size;
+}
+
+} // namespace crown
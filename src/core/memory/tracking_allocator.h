@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "allocator.h"
+
+namespace crown
+{
+
+/// Allocates memory from a backing allocator and keeps track of
+/// all the live allocations so that they can be freed with a single
+/// call to clear(), e.g. when the work which made them has been aborted.
+/// It is not thread-safe.
+///
+/// @ingroup Memory
+class TrackingAllocator : public Allocator
+{
+public:
+
+	TrackingAllocator(Allocator& backing);
+
+	/// Frees all the live allocations.
+	~TrackingAllocator();
+
+	/// @copydoc Allocator::allocate()
+	void* allocate(uint32_t size, uint32_t align = Allocator::DEFAULT_ALIGN);
+
+	/// @copydoc Allocator::deallocate()
+	void deallocate(void* data);
+
+	/// Frees all the live allocations and returns how many they were.
+	uint32_t clear();
+
+	/// @copydoc Allocator::allocated_size()
+	uint32_t allocated_size(const void* ptr);
+
+	/// @copydoc Allocator::total_allocated()
+	uint32_t total_allocated() { return _total_allocated; }
+
+private:
+
+	struct Header
+	{
+		Header* prev;
+		Header* next;
+		void* block;
+		uint32_t size;
+	};
+
+	Allocator& _backing;
+	Header* _first;
+	uint32_t _total_allocated;
+};
+
+} // namespace crown
@@ -266,6 +266,11 @@ struct TCPSocket
 				rr.error = ReadResult::REMOTE_CLOSED;
 				return rr;
 			}
+			else if (read_bytes < 0)
+			{
+				rr.error = ReadResult::UNKNOWN;
+				return rr;
+			}
 
 			buf += read_bytes;
 			to_read -= read_bytes;
@@ -293,6 +298,11 @@ struct TCPSocket
 				rr.error = ReadResult::REMOTE_CLOSED;
 				return rr;
 			}
+			else if (read_bytes < 0)
+			{
+				rr.error = ReadResult::UNKNOWN;
+				return rr;
+			}
 
 			buf += read_bytes;
 			to_read -= read_bytes;
@@ -341,7 +351,7 @@ struct TCPSocket
 				wr.error = WriteResult::REMOTE_CLOSED;
 				return wr;
 			}
-			else
+			else if (bytes_wrote < 0)
 			{
 				wr.error = WriteResult::UNKNOWN;
 				return wr;
@@ -375,7 +385,7 @@ struct TCPSocket
 				wr.error = WriteResult::REMOTE_CLOSED;
 				return wr;
 			}
-			else
+			else if (bytes_wrote < 0)
 			{
 				wr.error = WriteResult::UNKNOWN;
 				return wr;
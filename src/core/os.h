@@ -20,6 +20,7 @@
 	#include <sys/time.h>
 	#include <sys/wait.h>
 	#include <errno.h>
+	#include <fcntl.h>
 	#include <time.h>
 	#include <unistd.h>
 #elif CROWN_PLATFORM_WINDOWS
@@ -85,6 +86,59 @@ namespace os
 #endif
 	}
 
+	/// Returns the last modification time of the file at @a path,
+	/// or 0 if it does not exist.
+	inline uint64_t last_modified_time(const char* path)
+	{
+#if CROWN_PLATFORM_POSIX
+		struct stat info;
+		memset(&info, 0, sizeof(struct stat));
+		int err = stat(path, &info);
+		return err == 0 ? (uint64_t)info.st_mtime : 0;
+#elif CROWN_PLATFORM_WINDOWS
+		WIN32_FILE_ATTRIBUTE_DATA info;
+		if (!GetFileAttributesEx(path, GetFileExInfoStandard, &info))
+			return 0;
+		return (uint64_t(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+#endif
+	}
+
+	/// Returns a number which orders the file at @a path by its position
+	/// on the storage device. Reading files in ascending order reduces seeks.
+	inline uint64_t file_storage_order(const char* path)
+	{
+#if CROWN_PLATFORM_POSIX
+		// Most filesystems allocate data close to the inode
+		struct stat info;
+		memset(&info, 0, sizeof(struct stat));
+		int err = stat(path, &info);
+		return err == 0 ? (uint64_t)info.st_ino : 0;
+#elif CROWN_PLATFORM_WINDOWS
+		HANDLE hfile = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (hfile == INVALID_HANDLE_VALUE)
+			return 0;
+		BY_HANDLE_FILE_INFORMATION info;
+		const BOOL ok = GetFileInformationByHandle(hfile, &info);
+		CloseHandle(hfile);
+		return ok ? (uint64_t(info.nFileIndexHigh) << 32) | info.nFileIndexLow : 0;
+#endif
+	}
+
+	/// Asks the operating system to start reading the file at @a path
+	/// in the background, so that a later read does not block.
+	inline void prefetch_file(const char* path)
+	{
+#if CROWN_PLATFORM_LINUX || CROWN_PLATFORM_ANDROID
+		int fd = ::open(path, O_RDONLY);
+		if (fd == -1)
+			return;
+		posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		::close(fd);
+#else
+		CE_UNUSED(path);
+#endif
+	}
+
 	/// Creates a regular file.
 	inline void create_file(const char* path)
 	{
@@ -114,6 +168,21 @@ namespace os
 #endif
 	}
 
+	/// Renames the file @a old_path to @a new_path.
+	/// If @a new_path exists it is atomically replaced.
+	inline void rename_file(const char* old_path, const char* new_path)
+	{
+#if CROWN_PLATFORM_POSIX
+		int err = ::rename(old_path, new_path);
+		CE_ASSERT(err == 0, "rename: errno = %d", errno);
+		CE_UNUSED(err);
+#elif CROWN_PLATFORM_WINDOWS
+		BOOL err = MoveFileEx(old_path, new_path, MOVEFILE_REPLACE_EXISTING);
+		CE_ASSERT(err != 0, "MoveFileEx: GetLastError = %d", GetLastError());
+		CE_UNUSED(err);
+#endif
+	}
+
 	/// Creates a directory.
 	inline void create_directory(const char* path)
 	{
@@ -218,7 +287,30 @@ namespace os
 #if CROWN_PLATFORM_POSIX
 		return ::getenv(name);
 #elif CROWN_PLATFORM_WINDOWS
-		// GetEnvironmentVariable(name, buf, size);
+		return ::getenv(name);
+#endif
+	}
+
+	/// Returns the identifier of the calling process.
+	inline uint32_t process_id()
+	{
+#if CROWN_PLATFORM_POSIX
+		return (uint32_t)getpid();
+#elif CROWN_PLATFORM_WINDOWS
+		return (uint32_t)GetCurrentProcessId();
+#endif
+	}
+
+	/// Returns the number of processors currently online.
+	inline uint32_t num_processors()
+	{
+#if CROWN_PLATFORM_POSIX
+		const long num = sysconf(_SC_NPROCESSORS_ONLN);
+		return num > 0 ? (uint32_t)num : 1;
+#elif CROWN_PLATFORM_WINDOWS
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return (uint32_t)info.dwNumberOfProcessors;
 #endif
 	}
 
@@ -291,16 +383,22 @@ namespace os
 		CE_ASSERT(pid != -1, "fork: errno = %d", errno);
 		if (pid)
 		{
+			// Only wait for this child, other threads might be running processes too
 			int statval;
-			wait(&statval);
-			return (WIFEXITED(statval)) ? WEXITSTATUS(statval) : 1;
+			pid_t ret;
+			do
+			{
+				ret = waitpid(pid, &statval, 0);
+			}
+			while (ret == -1 && errno == EINTR);
+			return (ret == pid && WIFEXITED(statval)) ? WEXITSTATUS(statval) : 1;
 		}
 		else
 		{
-			int err = execv(args[0], (char* const*)args);
-			CE_ASSERT(err != -1, "execv: errno = %d", errno);
-			CE_UNUSED(err);
-			exit(EXIT_SUCCESS);
+			// The child is a copy of the calling thread only, leave it
+			// without running atexit handlers nor flushing stdio buffers
+			execv(args[0], (char* const*)args);
+			_exit(EXIT_FAILURE);
 		}
 #elif CROWN_PLATFORM_WINDOWS
 		STARTUPINFO info;
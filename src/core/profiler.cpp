@@ -9,6 +9,7 @@
 #include "mutex.h"
 #include "memory.h"
 #include "vector3.h"
+#include "macros.h"
 
 namespace crown
 {
@@ -38,8 +39,8 @@ namespace profiler_globals
 namespace profiler
 {
 	enum { THREAD_BUFFER_SIZE = 4 * 1024 };
-	char _thread_buffer[THREAD_BUFFER_SIZE];
-	uint32_t _thread_buffer_size = 0;
+	CE_THREAD char _thread_buffer[THREAD_BUFFER_SIZE];
+	CE_THREAD uint32_t _thread_buffer_size = 0;
 	Mutex _buffer_mutex;
 
 	void flush_local_buffer()
@@ -188,8 +188,14 @@ inline StringId32 DynamicString::to_string_id() const
 
 inline const char* DynamicString::c_str() const
 {
-	array::push_back(const_cast<Array<char>& >(_data), '\0');
-	array::pop_back(const_cast<Array<char>& >(_data));
+	// Only write the terminator when it is missing so that
+	// strings which do not change can be read from many threads
+	const uint32_t size = array::size(_data);
+	if (array::capacity(_data) <= size || array::begin(_data)[size] != '\0')
+	{
+		array::push_back(const_cast<Array<char>& >(_data), '\0');
+		array::pop_back(const_cast<Array<char>& >(_data));
+	}
 	return array::begin(_data);
 }
 
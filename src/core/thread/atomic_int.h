@@ -33,6 +33,16 @@ struct AtomicInt
 #endif
 	}
 
+	/// Adds @a val and returns the previous value.
+	int fetch_add(int val)
+	{
+#if CROWN_PLATFORM_POSIX && CROWN_COMPILER_GCC
+		return __sync_fetch_and_add(&_val, val);
+#elif CROWN_PLATFORM_WINDOWS
+		return InterlockedExchangeAdd(&_val, (LONG)val);
+#endif
+	}
+
 	void store(int val)
 	{
 #if CROWN_PLATFORM_POSIX && CROWN_COMPILER_GCC
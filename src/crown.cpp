@@ -65,6 +65,8 @@ static void help(const char* msg = NULL)
 		"  -v --version               Show version informations.\n"
 		"  --bundle-dir <path>        Use <path> as the source directory for compiled resources.\n"
 		"  --console-port <port>      Set port of the console.\n"
+		"  --bundle-server <address>  Read the compiled resources from the file server at <address>\n"
+		"                             (a.b.c.d[:port]) instead of the bundle directory.\n"
 		"  --parent-window <handle>   Set the parent window <handle> of the main window.\n"
 		"                             Used only by tools.\n"
 
@@ -79,7 +81,10 @@ static void help(const char* msg = NULL)
 		"          windows\n"
 		"          android\n"
 		"  --continue                 Continue the execution after the resource compilation step.\n"
+		"  --pack                     Pack the compiled resources into a single bundle archive.\n"
 		"  --wait-console             Wait for a console connection before starting up.\n"
+		"  --file-server <port>       Serve the files in the bundle directory on <port>\n"
+		"                             instead of starting the engine.\n"
 	);
 }
 
@@ -124,6 +129,7 @@ void parse_command_line(int argc, char** argv, ConfigSettings& cs)
 	cs.wait_console = cmd.has_argument("wait-console");
 	cs.do_compile = cmd.has_argument("compile");
 	cs.do_continue = cmd.has_argument("continue");
+	cs.do_pack = cmd.has_argument("pack");
 
 	cs.platform = string_to_platform(cmd.get_parameter("platform"));
 	if (cs.do_compile && cs.platform == Platform::COUNT)
@@ -143,6 +149,28 @@ void parse_command_line(int argc, char** argv, ConfigSettings& cs)
 	{
 		cs.console_port = parse_uint(port);
 	}
+
+	const char* fs_port = cmd.get_parameter("file-server");
+	if (fs_port)
+	{
+		cs.file_server_port = parse_uint(fs_port);
+	}
+
+	const char* server = cmd.get_parameter("bundle-server");
+	if (server)
+	{
+		uint32_t a, b, c, d;
+		uint32_t server_port = CROWN_DEFAULT_FILE_SERVER_PORT;
+		if (sscanf(server, "%u.%u.%u.%u:%u", &a, &b, &c, &d, &server_port) < 4)
+		{
+			help("Bundle server address is not valid.");
+			exit(EXIT_FAILURE);
+		}
+
+		cs.use_bundle_server = true;
+		cs.bundle_server_address.set(a, b, c, d);
+		cs.bundle_server_port = server_port;
+	}
 }
 
 void parse_config_file(Filesystem& fs, ConfigSettings& cs)
@@ -180,6 +208,36 @@ void parse_config_file(Filesystem& fs, ConfigSettings& cs)
 		cs.window_height = max((uint16_t)1, (uint16_t)window_height.to_int());
 	}
 
+	JSONElement loader_threads = root.key_or_nil("loader_threads");
+	if (!loader_threads.is_nil())
+	{
+		cs.loader_threads = clamp((uint32_t)1, (uint32_t)CROWN_MAX_LOADER_THREADS, (uint32_t)loader_threads.to_int());
+	}
+
+	JSONElement read_ahead = root.key_or_nil("read_ahead");
+	if (!read_ahead.is_nil())
+	{
+		cs.read_ahead = (uint32_t)max(0, read_ahead.to_int());
+	}
+
+	JSONElement online_time_budget = root.key_or_nil("online_time_budget");
+	if (!online_time_budget.is_nil())
+	{
+		cs.online_time_budget = max(0.0f, online_time_budget.to_float());
+	}
+
+	JSONElement online_bytes_budget = root.key_or_nil("online_bytes_budget");
+	if (!online_bytes_budget.is_nil())
+	{
+		cs.online_bytes_budget = (uint32_t)max(0, online_bytes_budget.to_int());
+	}
+
+	JSONElement resource_memory_budget = root.key_or_nil("resource_memory_budget");
+	if (!resource_memory_budget.is_nil())
+	{
+		cs.resource_memory_budget = (uint32_t)max(0, resource_memory_budget.to_int());
+	}
+
 	cs.boot_script = root.key("boot_script").to_resource_id();
 	cs.boot_package = root.key("boot_package").to_resource_id();
 }
@@ -7,6 +7,7 @@
 
 #include "types.h"
 #include "filesystem_types.h"
+#include "net_address.h"
 
 namespace crown
 {
@@ -32,12 +33,21 @@ namespace crown
 			, wait_console(false)
 			, do_compile(false)
 			, do_continue(false)
+			, do_pack(false)
 			, parent_window(0)
 			, console_port(CROWN_DEFAULT_CONSOLE_PORT)
+			, file_server_port(0)
+			, use_bundle_server(false)
+			, bundle_server_port(CROWN_DEFAULT_FILE_SERVER_PORT)
 			, boot_package(uint64_t(0))
 			, boot_script(uint64_t(0))
 			, window_width(CROWN_DEFAULT_WINDOW_WIDTH)
 			, window_height(CROWN_DEFAULT_WINDOW_HEIGHT)
+			, loader_threads(CROWN_DEFAULT_LOADER_THREADS)
+			, read_ahead(CROWN_DEFAULT_READ_AHEAD)
+			, online_time_budget(0.0f)
+			, online_bytes_budget(0)
+			, resource_memory_budget(0)
 		{
 		}
 
@@ -48,12 +58,22 @@ namespace crown
 		bool wait_console;
 		bool do_compile;
 		bool do_continue;
+		bool do_pack;
 		uint32_t parent_window;
 		uint16_t console_port;
+		uint16_t file_server_port;
+		bool use_bundle_server;
+		NetAddress bundle_server_address;
+		uint16_t bundle_server_port;
 		StringId64 boot_package;
 		StringId64 boot_script;
 		uint16_t window_width;
 		uint16_t window_height;
+		uint32_t loader_threads;
+		uint32_t read_ahead;
+		float online_time_budget;
+		uint32_t online_bytes_budget;
+		uint32_t resource_memory_budget;
 	};
 
 	void parse_command_line(int argc, char** argv, ConfigSettings& cs);
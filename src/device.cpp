@@ -15,6 +15,8 @@
 #include "world.h"
 #include "memory.h"
 #include "os.h"
+#include "bundle_filesystem.h"
+#include "temp_allocator.h"
 
 #define MAX_SUBSYSTEMS_HEAP 8 * 1024 * 1024
 
@@ -38,6 +40,7 @@ Device::Device(const ConfigSettings& cs, Filesystem& fs)
 	, _boot_script_id(cs.boot_script)
 	, _boot_package(NULL)
 	, _lua_environment(NULL)
+	, _bundle_fs(NULL)
 	, _resource_manager(NULL)
 	, _worlds(default_allocator())
 {
@@ -48,9 +51,34 @@ void Device::init()
 	// Initialize
 	CE_LOGI("Initializing Crown Engine %s...", version());
 
+	// Serve resources from the bundle archive if there is one on the local disk
+	Filesystem* resource_fs = &_fs;
+	TempAllocator512 ta;
+	DynamicString archive_path(ta);
+	_fs.get_absolute_path(CROWN_BUNDLE_ARCHIVE, archive_path);
+	if (os::exists(archive_path.c_str()) && os::is_file(archive_path.c_str()))
+	{
+		CE_LOGD("Mapping bundle archive...");
+		BundleFilesystem* bundle_fs = CE_NEW(_allocator, BundleFilesystem)(archive_path.c_str());
+		if (bundle_fs->is_valid())
+		{
+			_bundle_fs = bundle_fs;
+			resource_fs = _bundle_fs;
+		}
+		else
+		{
+			CE_LOGW("Ignoring bundle archive, resources are read from disk");
+			CE_DELETE(_allocator, bundle_fs);
+		}
+	}
+
 	// Create resource manager
 	CE_LOGD("Creating resource manager...");
-	_resource_manager = CE_NEW(_allocator, ResourceManager)(_fs);
+	_resource_manager = CE_NEW(_allocator, ResourceManager)(*resource_fs, _cs.loader_threads);
+	_resource_manager->set_read_ahead(_cs.read_ahead);
+	_resource_manager->set_online_budget(_cs.online_time_budget, _cs.online_bytes_budget);
+	_resource_manager->set_memory_budget(_cs.resource_memory_budget);
+	_resource_manager->set_reload_callback(Device::reload_callback, this);
 
 	CE_LOGD("Creating material manager...");
 	material_manager::init();
@@ -93,6 +121,12 @@ void Device::shutdown()
 	CE_LOGD("Releasing resource manager...");
 	CE_DELETE(_allocator, _resource_manager);
 
+	if (_bundle_fs != NULL)
+	{
+		CE_LOGD("Releasing bundle archive...");
+		CE_DELETE(_allocator, _bundle_fs);
+	}
+
 	_allocator.clear();
 	_is_init = false;
 }
@@ -205,14 +239,25 @@ void Device::destroy_resource_package(ResourcePackage& package)
 
 void Device::reload(StringId64 type, StringId64 name)
 {
-	const void* old_resource = _resource_manager->get(type, name);
 	_resource_manager->reload(type, name);
-	const void* new_resource = _resource_manager->get(type, name);
+}
 
+void Device::on_reload(StringId64 type, const void* old_resource, const void* new_resource)
+{
 	if (type == SCRIPT_TYPE)
 	{
 		_lua_environment->execute((const LuaResource*)new_resource);
 	}
+	else if (type == UNIT_TYPE)
+	{
+		for (uint32_t i = 0; i < array::size(_worlds); i++)
+			_worlds[i]->reload_units((UnitResource*)old_resource, (UnitResource*)new_resource);
+	}
+	else if (type == SOUND_TYPE)
+	{
+		for (uint32_t i = 0; i < array::size(_worlds); i++)
+			_worlds[i]->sound_world()->reload_sounds((const SoundResource*)old_resource, (const SoundResource*)new_resource);
+	}
 }
 
 namespace device_globals
@@ -99,6 +99,8 @@ struct Device
 	void destroy_resource_package(ResourcePackage& package);
 
 	/// Reloads the resource @a type @a name.
+	/// The new version replaces the old one as soon as it has been loaded,
+	/// meanwhile the old one stays in use.
 	void reload(StringId64 type, StringId64 name);
 
 	/// Returns the resource manager.
@@ -107,6 +109,17 @@ struct Device
 	/// Returns the lua environment.
 	LuaEnvironment* lua_environment();
 
+private:
+
+	// Updates the references to a reloaded resource.
+	void on_reload(StringId64 type, const void* old_resource, const void* new_resource);
+
+	static void reload_callback(StringId64 type, StringId64 name, const void* old_resource, const void* new_resource, void* user_data)
+	{
+		CE_UNUSED(name);
+		((Device*)user_data)->on_reload(type, old_resource, new_resource);
+	}
+
 private:
 
 	// Used to allocate all subsystems
@@ -132,6 +145,7 @@ private:
 	ResourcePackage* _boot_package;
 
 	LuaEnvironment* _lua_environment;
+	Filesystem* _bundle_fs;
 	ResourceManager* _resource_manager;
 
 	Array<World*> _worlds;
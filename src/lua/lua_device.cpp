@@ -13,6 +13,8 @@
 #include "string_stream.h"
 #include "console_server.h"
 #include "resource_manager.h"
+#include "lua_assert.h"
+#include "os.h"
 
 namespace crown
 {
@@ -137,6 +139,108 @@ static int device_enable_resource_autoload(lua_State* L)
 	return 0;
 }
 
+static int device_resource_stats(lua_State* L)
+{
+	LuaStack stack(L);
+	ResourceManager* rm = device()->resource_manager();
+	stack.push_table();
+	stack.push_key_begin("pending_load");
+	stack.push_uint32(rm->num_pending_load());
+	stack.push_key_end();
+	stack.push_key_begin("pending_online");
+	stack.push_uint32(rm->num_pending_online());
+	stack.push_key_end();
+	stack.push_key_begin("pending_online_bytes");
+	stack.push_uint32(rm->bytes_pending_online());
+	stack.push_key_end();
+	stack.push_key_begin("cached");
+	stack.push_uint32(rm->num_cached());
+	stack.push_key_end();
+	stack.push_key_begin("resident_bytes");
+	stack.push_uint32(rm->resident_bytes());
+	stack.push_key_end();
+	return 1;
+}
+
+static int device_resource_load_stats(lua_State* L)
+{
+	static const char* stage_names[] = { "queue", "io", "load", "online" };
+
+	LuaStack stack(L);
+	const ResourceStats& stats = device()->resource_manager()->load_stats();
+	const float freq = (float)os::clockfrequency();
+
+	stack.push_table();
+	for (uint32_t i = 0; i < stats.num_types(); i++)
+	{
+		const ResourceTypeStats& ts = stats.type_stats(i);
+
+		char buf[StringId64::STRING_LENGTH];
+		StringId64 type = ts.type;
+		const char* name = ResourceStats::type_name(type);
+		stack.push_key_begin(name != NULL ? name : type.to_string(buf));
+		stack.push_table();
+
+		stack.push_key_begin("count");
+		stack.push_uint32(ts.count);
+		stack.push_key_end();
+		stack.push_key_begin("bytes");
+		stack.push_float((float)ts.bytes);
+		stack.push_key_end();
+
+		for (uint32_t s = 0; s < LoadStage::COUNT; s++)
+		{
+			stack.push_key_begin(stage_names[s]);
+			stack.push_table();
+			stack.push_key_begin("total");
+			stack.push_float(ts.total_ticks[s] / freq);
+			stack.push_key_end();
+			stack.push_key_begin("max");
+			stack.push_float(ts.max_ticks[s] / freq);
+			stack.push_key_end();
+			stack.push_key_begin("histogram");
+			stack.push_table();
+			for (uint32_t b = 0; b < ResourceTypeStats::NUM_BUCKETS; b++)
+			{
+				stack.push_key_begin((int)b + 1);
+				stack.push_uint32(ts.histogram[s][b]);
+				stack.push_key_end();
+			}
+			stack.push_key_end();
+			stack.push_key_end();
+		}
+
+		stack.push_key_end();
+	}
+
+	return 1;
+}
+
+static int device_clear_resource_load_stats(lua_State* /*L*/)
+{
+	device()->resource_manager()->clear_load_stats();
+	return 0;
+}
+
+static int device_resource_handle(lua_State* L)
+{
+	LuaStack stack(L);
+	const StringId64 type = stack.get_resource_id(1);
+	const StringId64 name = stack.get_resource_id(2);
+
+	LUA_ASSERT(device()->resource_manager()->can_get(type, name), stack, "Resource not loaded");
+
+	stack.push_resource_handle(device()->resource_manager()->get_handle(type, name));
+	return 1;
+}
+
+static int device_is_resource_handle_valid(lua_State* L)
+{
+	LuaStack stack(L);
+	stack.push_bool(device()->resource_manager()->can_get(stack.get_resource_id(1), stack.get_resource_handle(2)));
+	return 1;
+}
+
 void load_device(LuaEnvironment& env)
 {
 	env.load_module_function("Device", "platform",                 device_platform);
@@ -153,6 +257,11 @@ void load_device(LuaEnvironment& env)
 	env.load_module_function("Device", "console_send",             device_console_send);
 	env.load_module_function("Device", "can_get",                  device_can_get);
 	env.load_module_function("Device", "enable_resource_autoload", device_enable_resource_autoload);
+	env.load_module_function("Device", "resource_stats",           device_resource_stats);
+	env.load_module_function("Device", "resource_load_stats",      device_resource_load_stats);
+	env.load_module_function("Device", "clear_resource_load_stats", device_clear_resource_load_stats);
+	env.load_module_function("Device", "resource_handle",          device_resource_handle);
+	env.load_module_function("Device", "is_resource_handle_valid", device_is_resource_handle_valid);
 }
 
 } // namespace crown
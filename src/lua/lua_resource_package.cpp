@@ -13,7 +13,10 @@ namespace crown
 static int resource_package_load(lua_State* L)
 {
 	LuaStack stack(L);
-	stack.get_resource_package(1)->load();
+	const ResourcePriority::Enum priority = stack.num_args() > 1
+		? (ResourcePriority::Enum) stack.get_int(2)
+		: ResourcePriority::NORMAL;
+	stack.get_resource_package(1)->load(priority);
 	return 0;
 }
 
@@ -38,6 +41,26 @@ static int resource_package_has_loaded(lua_State* L)
 	return 1;
 }
 
+static int resource_package_progress(lua_State* L)
+{
+	LuaStack stack(L);
+	const PackageProgress pp = stack.get_resource_package(1)->progress();
+	stack.push_table();
+	stack.push_key_begin("num_loaded");
+	stack.push_uint32(pp.num_loaded);
+	stack.push_key_end();
+	stack.push_key_begin("num_total");
+	stack.push_uint32(pp.num_total);
+	stack.push_key_end();
+	stack.push_key_begin("bytes_loaded");
+	stack.push_uint32(pp.bytes_loaded);
+	stack.push_key_end();
+	stack.push_key_begin("bytes_total");
+	stack.push_uint32(pp.bytes_total);
+	stack.push_key_end();
+	return 1;
+}
+
 static int resource_package_tostring(lua_State* L)
 {
 	LuaStack stack(L);
@@ -52,8 +75,13 @@ void load_resource_package(LuaEnvironment& env)
 	env.load_module_function("ResourcePackage", "unload",     resource_package_unload);
 	env.load_module_function("ResourcePackage", "flush",      resource_package_flush);
 	env.load_module_function("ResourcePackage", "has_loaded", resource_package_has_loaded);
+	env.load_module_function("ResourcePackage", "progress",   resource_package_progress);
 	env.load_module_function("ResourcePackage", "__index",    "ResourcePackage");
 	env.load_module_function("ResourcePackage", "__tostring", resource_package_tostring);
+
+	env.load_module_enum("ResourcePackage", "LOW",    ResourcePriority::LOW);
+	env.load_module_enum("ResourcePackage", "NORMAL", ResourcePriority::NORMAL);
+	env.load_module_enum("ResourcePackage", "HIGH",   ResourcePriority::HIGH);
 }
 
 } // namespace crown
@@ -12,6 +12,7 @@
 #include "matrix4x4.h"
 #include "string_utils.h"
 #include "color4.h"
+#include "resource_types.h"
 #include <lua.hpp>
 
 #if CROWN_DEBUG
@@ -236,6 +237,30 @@ struct LuaStack
 		return StringId64(CHECKSTRING(L, i));
 	}
 
+	bool is_resource_handle(int i)
+	{
+		if (lua_type(L, i) != LUA_TLIGHTUSERDATA)
+			return false;
+
+		// Pointers are light userdata too, handles fit in 32 bits and are tagged
+		const uintptr_t enc = (uintptr_t)lua_touserdata(L, i);
+		return enc == (uint32_t)enc && (enc & ResourceHandle::TAG) != 0;
+	}
+
+	void push_resource_handle(ResourceHandle handle)
+	{
+		uintptr_t enc = handle.encode();
+		lua_pushlightuserdata(L, (void*)enc);
+	}
+
+	ResourceHandle get_resource_handle(int i)
+	{
+		uint32_t enc = (uintptr_t) CHECKLIGHTDATA(L, i, always_true, "ResourceHandle");
+		ResourceHandle handle;
+		handle.decode(enc);
+		return handle;
+	}
+
 	void push_resource_package(ResourcePackage* package)
 	{
 		ResourcePackage** p = (ResourcePackage**) lua_newuserdata(L, sizeof(ResourcePackage*));
@@ -20,13 +20,23 @@ static int world_spawn_unit(lua_State* L)
 {
 	LuaStack stack(L);
 	World* world = stack.get_world(1);
-	const StringId64 name = stack.get_resource_id(2);
 	const Vector3& pos = stack.num_args() > 2 ? stack.get_vector3(3) : VECTOR3_ZERO;
 	const Quaternion& rot = stack.num_args() > 3 ? stack.get_quaternion(4) : QUATERNION_IDENTITY;
 
-	LUA_ASSERT(device()->resource_manager()->can_get(UNIT_TYPE, name), stack, "Unit not found");
+	UnitId unit;
+	if (stack.is_resource_handle(2))
+	{
+		const ResourceHandle handle = stack.get_resource_handle(2);
+		LUA_ASSERT(device()->resource_manager()->can_get(UNIT_TYPE, handle), stack, "Unit not found");
+		unit = world->spawn_unit(handle, pos, rot);
+	}
+	else
+	{
+		const StringId64 name = stack.get_resource_id(2);
+		LUA_ASSERT(device()->resource_manager()->can_get(UNIT_TYPE, name), stack, "Unit not found");
+		unit = world->spawn_unit(name, pos, rot);
+	}
 
-	UnitId unit = world->spawn_unit(name, pos, rot);
 	stack.push_unit(world->get_unit(unit));
 	return 1;
 }
@@ -104,16 +114,27 @@ static int world_play_sound(lua_State* L)
 {
 	LuaStack stack(L);
 	World* world = stack.get_world(1);
-	const StringId64 name = stack.get_resource_id(2);
 	const int32_t nargs = stack.num_args();
 	const bool loop = nargs > 2 ? stack.get_bool(3) : false;
 	const float volume = nargs > 3 ? stack.get_float(4) : 1.0f;
 	const Vector3& pos = nargs > 4 ? stack.get_vector3(5) : VECTOR3_ZERO;
 	const float range = nargs > 5 ? stack.get_float(6) : 1000.0f;
 
-	LUA_ASSERT(device()->resource_manager()->can_get(SOUND_TYPE, name), stack, "Sound not found");
+	SoundInstanceId id;
+	if (stack.is_resource_handle(2))
+	{
+		const ResourceHandle handle = stack.get_resource_handle(2);
+		LUA_ASSERT(device()->resource_manager()->can_get(SOUND_TYPE, handle), stack, "Sound not found");
+		id = world->play_sound(handle, loop, volume, pos, range);
+	}
+	else
+	{
+		const StringId64 name = stack.get_resource_id(2);
+		LUA_ASSERT(device()->resource_manager()->can_get(SOUND_TYPE, name), stack, "Sound not found");
+		id = world->play_sound(name, loop, volume, pos, range);
+	}
 
-	stack.push_sound_instance_id(world->play_sound(name, loop, volume, pos, range));
+	stack.push_sound_instance_id(id);
 	return 1;
 }
 
@@ -16,6 +16,8 @@
 #include "console_server.h"
 #include "bundle_compiler.h"
 #include "disk_filesystem.h"
+#include "network_filesystem.h"
+#include "file_server.h"
 #include <bgfxplatform.h>
 #include <winsock2.h>
 #ifndef WIN32_LEAN_AND_MEAN
@@ -337,9 +339,20 @@ int main(int argc, char** argv)
 	bool do_continue = true;
 	int exitcode = EXIT_SUCCESS;
 
-	do_continue = bundle_compiler::main(cs.do_compile, cs.do_continue, cs.platform);
+	do_continue = bundle_compiler::main(cs.do_compile, cs.do_continue, cs.do_pack, cs.platform);
 
-	if (do_continue)
+	if (cs.file_server_port != 0)
+	{
+		DiskFilesystem bundle_fs(cs.bundle_dir);
+		FileServer server(bundle_fs, cs.file_server_port);
+		server.run();
+	}
+	else if (do_continue && cs.use_bundle_server)
+	{
+		NetworkFilesystem dst_fs(cs.bundle_server_address, cs.bundle_server_port);
+		exitcode = crown::s_wdvc.run(&dst_fs, &cs);
+	}
+	else if (do_continue)
 	{
 		DiskFilesystem dst_fs(cs.bundle_dir);
 		exitcode = crown::s_wdvc.run(&dst_fs, &cs);
@@ -26,6 +26,7 @@ void Material::create(const MaterialResource* mr, MaterialManager& mm)
 	data = (char*) default_allocator().allocate(size);
 	memcpy(data, base, size);
 	resource = mr;
+	shader_handle.decode(0);
 }
 
 void Material::destroy() const
@@ -33,10 +34,16 @@ void Material::destroy() const
 	default_allocator().deallocate(data);
 }
 
-void Material::bind() const
+void Material::bind()
 {
-	Shader* shader = (Shader*) device()->resource_manager()->get(SHADER_TYPE, material_resource::shader(resource));
-	bgfx::setProgram(shader->program);
+	ResourceManager* rm = device()->resource_manager();
+
+	// Look the resources up again only if they have been unloaded
+	if (!rm->can_get(SHADER_TYPE, shader_handle))
+		shader_handle = rm->get_handle(SHADER_TYPE, material_resource::shader(resource));
+
+	const Shader* sh = (const Shader*) rm->get(SHADER_TYPE, shader_handle);
+	bgfx::setProgram(sh->program);
 
 	// Set samplers
 	for (uint32_t i = 0; i < num_textures(resource); i++)
@@ -48,7 +55,16 @@ void Material::bind() const
 		bgfx::TextureHandle texture;
 		sampler.idx = th->sampler_handle;
 
-		TextureResource* teximg = (TextureResource*) device()->resource_manager()->get(TEXTURE_TYPE, td->id);
+		// The texture handle slot caches the texture resource handle
+		ResourceHandle rh;
+		rh.decode(th->texture_handle);
+		if (!rm->can_get(TEXTURE_TYPE, rh))
+		{
+			rh = rm->get_handle(TEXTURE_TYPE, td->id);
+			th->texture_handle = rh.encode();
+		}
+
+		const TextureResource* teximg = (const TextureResource*) rm->get(TEXTURE_TYPE, rh);
 		texture.idx = teximg->handle.idx;
 
 		bgfx::setTexture(i, sampler, texture);
@@ -18,7 +18,7 @@ struct Material
 {
 	void create(const MaterialResource* mr, MaterialManager& mm);
 	void destroy() const;
-	void bind() const;
+	void bind();
 
 	void set_float(const char* name, float val);
 	void set_vector2(const char* name, const Vector2& val);
@@ -26,6 +26,7 @@ struct Material
 
 	const MaterialResource* resource;
 	char* data;
+	ResourceHandle shader_handle; // Resolved on first bind()
 };
 
 } // namespace crown
@@ -11,6 +11,12 @@
 #include "reader_writer.h"
 #include "resource_manager.h"
 #include "compile_options.h"
+#include "shader_cache.h"
+#include "murmur.h"
+#include "hash.h"
+#include "vector.h"
+#include "path.h"
+#include <string.h> // strlen, strncmp, memcpy
 
 #if CROWN_DEBUG
 #	define SHADERC_NAME "shaderc-debug-"
@@ -39,6 +45,140 @@ namespace shader_resource
 		"android"
 	};
 
+#if CROWN_PLATFORM_LINUX
+	static const char* _vs_profile = "120";
+	static const char* _fs_profile = "120";
+#elif CROWN_PLATFORM_WINDOWS
+	static const char* _vs_profile = "vs_3_0";
+	static const char* _fs_profile = "ps_3_0";
+#endif
+
+	// Hashes the shader @a code together with the files it includes from the
+	// source directory, which are recorded as inputs of the shader. Files which
+	// are not found (e.g. the ones shipped with shaderc) only contribute their name.
+	static uint64_t hash_source(const char* code, uint32_t size, uint64_t seed, Hash<bool>& visited, CompileOptions& opts)
+	{
+		uint64_t hash = murmur64(code, size, seed);
+
+		const char* end = code + size;
+		for (const char* ch = code; ch < end; )
+		{
+			const char* line = ch;
+			while (ch < end && *ch != '\n')
+				ch++;
+			const char* line_end = ch++;
+
+			while (line < line_end && (*line == ' ' || *line == '\t'))
+				line++;
+			if (line == line_end || *line++ != '#')
+				continue;
+			while (line < line_end && (*line == ' ' || *line == '\t'))
+				line++;
+			if (line_end - line < 8 || strncmp(line, "include", 7) != 0)
+				continue;
+			line += 7;
+			while (line < line_end && (*line == ' ' || *line == '\t'))
+				line++;
+			if (line == line_end || (*line != '"' && *line != '<'))
+				continue;
+
+			const char close = *line++ == '"' ? '"' : '>';
+			const char* name_end = line;
+			while (name_end < line_end && *name_end != close)
+				name_end++;
+
+			char name[256];
+			const uint32_t len = uint32_t(name_end - line) < sizeof(name) - 1 ? uint32_t(name_end - line) : sizeof(name) - 1;
+			memcpy(name, line, len);
+			name[len] = '\0';
+
+			const uint64_t name_hash = murmur64(name, len, 0);
+			if (hash::has(visited, name_hash))
+				continue;
+			hash::set(visited, name_hash, true);
+
+			if (len == 0 || path::is_absolute_path(name) || !opts.exists(name))
+			{
+				hash = murmur64(name, len, hash);
+				continue;
+			}
+
+			Buffer buf = opts.read(name);
+			hash = hash_source(array::begin(buf), array::size(buf), hash, visited, opts);
+		}
+
+		return hash;
+	}
+
+	// Compiles the @a code of the shader stage @a type ("vertex" or "fragment")
+	// and returns the shaderc output. Outputs are looked up in the shader cache by
+	// the hash of everything shaderc reads, so identical stages are compiled once.
+	static Buffer compile_stage(const char* type, const char* profile, const DynamicString& code
+		, const DynamicString& varying_def, const DynamicString& defines, CompileOptions& opts)
+	{
+		const char* platform = _scplatform[opts.platform()];
+
+		Hash<bool> visited(default_allocator());
+		uint64_t key = shader_cache::compiler_hash(SHADERC_PATH);
+		key = murmur64(type, strlen(type), key);
+		key = murmur64(platform, strlen(platform), key);
+		key = murmur64(profile, strlen(profile), key);
+		key = murmur64(defines.c_str(), defines.length(), key);
+		key = murmur64(varying_def.c_str(), varying_def.length(), key);
+		key = hash_source(code.c_str(), code.length(), key, visited, opts);
+
+		Buffer bin(default_allocator());
+		if (shader_cache::find(key, bin))
+			return bin;
+
+		char code_suffix[32];
+		char varying_suffix[32];
+		char bin_suffix[32];
+		snprintf(code_suffix, sizeof(code_suffix), "%s_code", type);
+		snprintf(varying_suffix, sizeof(varying_suffix), "%s_varying", type);
+		snprintf(bin_suffix, sizeof(bin_suffix), "%s_bin", type);
+
+		DynamicString code_path;
+		DynamicString varying_def_path;
+		DynamicString bin_path;
+		opts.get_temporary_path(code_suffix, code_path);
+		opts.get_temporary_path(varying_suffix, varying_def_path);
+		opts.get_temporary_path(bin_suffix, bin_path);
+
+		File* code_file = opts._fs.open(code_path.c_str(), FOM_WRITE);
+		code_file->write(code.c_str(), code.length());
+		opts._fs.close(code_file);
+
+		File* varying_file = opts._fs.open(varying_def_path.c_str(), FOM_WRITE);
+		varying_file->write(varying_def.c_str(), varying_def.length());
+		opts._fs.close(varying_file);
+
+		const char* compile[] =
+		{
+			SHADERC_PATH,
+			"-f", code_path.c_str(),
+			"-o", bin_path.c_str(),
+			"--varyingdef", varying_def_path.c_str(),
+			"--type", type,
+			"--platform", platform,
+			"--profile", profile,
+			defines.length() ? "--define" : NULL, defines.c_str(),
+			NULL
+		};
+		const int exitcode = os::execute_process(compile);
+
+		opts.delete_file(code_path.c_str());
+		opts.delete_file(varying_def_path.c_str());
+		CE_ASSERT(exitcode == 0, "Failed to compile %s shader", type);
+		CE_UNUSED(exitcode);
+
+		bin = opts.read(bin_path.c_str());
+		opts.delete_file(bin_path.c_str());
+
+		shader_cache::store(key, bin);
+		return bin;
+	}
+
 	void compile(const char* path, CompileOptions& opts)
 	{
 		Buffer buf = opts.read(path);
@@ -59,6 +199,20 @@ namespace shader_resource
 		root.key("vs_in_out").to_string(vs_in_out);
 		root.key("fs_in_out").to_string(fs_in_out);
 
+		// Optional list of macros, passed to shaderc separated by ';'
+		DynamicString defines;
+		if (root.has_key("defines"))
+		{
+			Vector<DynamicString> names(default_allocator());
+			root.key("defines").to_array(names);
+			for (uint32_t i = 0; i < vector::size(names); i++)
+			{
+				if (i > 0)
+					defines += ';';
+				defines += names[i];
+			}
+		}
+
 		DynamicString vs_code;
 		DynamicString fs_code;
 		vs_code += vs_in_out;
@@ -68,86 +222,14 @@ namespace shader_resource
 		fs_code += common_code;
 		fs_code += fs_code2;
 
-		DynamicString vs_code_path;
-		DynamicString fs_code_path;
-		DynamicString varying_def_path;
-		DynamicString tmpvs_path;
-		DynamicString tmpfs_path;
-
-		opts.get_absolute_path("vs_code.tmp", vs_code_path);
-		opts.get_absolute_path("fs_code.tmp", fs_code_path);
-		opts.get_absolute_path("varying.tmp", varying_def_path);
-		opts.get_absolute_path("tmpvs", tmpvs_path);
-		opts.get_absolute_path("tmpfs", tmpfs_path);
-
-		File* vs_file = opts._fs.open(vs_code_path.c_str(), FOM_WRITE);
-		vs_file->write(vs_code.c_str(), vs_code.length());
-		opts._fs.close(vs_file);
-
-		File* fs_file = opts._fs.open(fs_code_path.c_str(), FOM_WRITE);
-		fs_file->write(fs_code.c_str(), fs_code.length());
-		opts._fs.close(fs_file);
-
-		File* varying_file = opts._fs.open(varying_def_path.c_str(), FOM_WRITE);
-		varying_file->write(varying_def.c_str(), varying_def.length());
-		opts._fs.close(varying_file);
-
-		const char* compile_vs[] =
-		{
-			SHADERC_PATH,
-			"-f", vs_code_path.c_str(),
-			"-o", tmpvs_path.c_str(),
-			"--varyingdef", varying_def_path.c_str(),
-			"--type", "vertex",
-			"--platform", _scplatform[opts.platform()],
-			"--profile",
-#if CROWN_PLATFORM_LINUX
-			"120",
-#elif CROWN_PLATFORM_WINDOWS
-			"vs_3_0",
-#endif
-			NULL
-		};
-		int exitcode = os::execute_process(compile_vs);
-		CE_ASSERT(exitcode == 0, "Failed to compile vertex shader");
-
-		const char* compile_fs[] =
-		{
-			SHADERC_PATH,
-			"-f", fs_code_path.c_str(),
-			"-o", tmpfs_path.c_str(),
-			"--varyingdef", varying_def_path.c_str(),
-			"--type", "fragment",
-			"--platform", _scplatform[opts.platform()],
-			"--profile",
-#if CROWN_PLATFORM_LINUX
-			"120",
-#elif CROWN_PLATFORM_WINDOWS
-			"ps_3_0",
-#endif
-			NULL
-		};
-		exitcode = os::execute_process(compile_fs);
-		if (exitcode)
-		{
-			opts.delete_file(tmpvs_path.c_str());
-			CE_ASSERT(exitcode == 0, "Failed to compile fragment shader");
-		}
-
-		Buffer tmpvs = opts.read(tmpvs_path.c_str());
-		Buffer tmpfs = opts.read(tmpfs_path.c_str());
+		Buffer tmpvs = compile_stage("vertex", _vs_profile, vs_code, varying_def, defines, opts);
+		Buffer tmpfs = compile_stage("fragment", _fs_profile, fs_code, varying_def, defines, opts);
 
 		opts.write(uint32_t(1)); // version
 		opts.write(uint32_t(array::size(tmpvs)));
 		opts.write(array::begin(tmpvs), array::size(tmpvs));
 		opts.write(uint32_t(array::size(tmpfs)));
 		opts.write(array::begin(tmpfs), array::size(tmpfs));
-
-		opts.delete_file(vs_code_path.c_str());
-		opts.delete_file(fs_code_path.c_str());
-		opts.delete_file(varying_def_path.c_str());
-		opts.delete_file(tmpvs_path.c_str());
-		opts.delete_file(tmpfs_path.c_str());
 	}
 
 	void* load(File& file, Allocator& a)
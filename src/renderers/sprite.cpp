@@ -6,6 +6,7 @@
 #include "sprite.h"
 #include "vector3.h"
 #include "quaternion.h"
+#include "matrix4x4.h"
 #include "sprite_resource.h"
 #include "allocator.h"
 #include "scene_graph.h"
@@ -58,7 +59,8 @@ void Sprite::render()
 	bgfx::setVertexBuffer(m_resource->vb);
 	bgfx::setIndexBuffer(m_resource->ib, m_frame * 6, 6);
 	TransformInstance ti = m_scene_graph.get(_unit_id);
-	bgfx::setTransform(to_float_ptr(m_scene_graph.world_pose(ti)));
+	const Matrix4x4 pose = sprite_resource::position_transform(m_resource) * m_scene_graph.world_pose(ti);
+	bgfx::setTransform(to_float_ptr(pose));
 	bgfx::submit(0, _depth);
 }
 
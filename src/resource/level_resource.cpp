@@ -212,6 +212,11 @@ namespace level_resource
 			}
 		}
 
+		for (uint32_t i = 0; i < array::size(units); i++)
+			opts.add_dependency(UNIT_TYPE, units[i].name);
+		for (uint32_t i = 0; i < array::size(sounds); i++)
+			opts.add_dependency(SOUND_TYPE, sounds[i].name);
+
 		LevelResource lr;
 		lr.version = LEVEL_VERSION;
 		lr.num_units = array::size(units);
@@ -6,48 +6,133 @@
 #include "config.h"
 #include "dynamic_string.h"
 #include "lua_resource.h"
-#include "os.h"
 #include "temp_allocator.h"
 #include "array.h"
 #include "compile_options.h"
+#include "mutex.h"
+#include "macros.h"
+#include "string_utils.h"
+#include <lua.hpp>
 
 #if CROWN_DEBUG
-	#define LUAJIT_FLAGS "-bg" // Keep debug info
+	#define LUAJIT_STRIP false // Keep debug info
 #else
-	#define LUAJIT_FLAGS "-b"
+	#define LUAJIT_STRIP true
 #endif // CROWN_DEBUG
 
 namespace crown
 {
 namespace lua_resource
 {
+	// Lua states used to compile the scripts, shared by the compiler threads.
+	// They are created on demand and live until the program exits.
+	struct CompilerPool
+	{
+		CompilerPool()
+			: num_free(0)
+		{
+		}
+
+		~CompilerPool()
+		{
+			for (uint32_t i = 0; i < num_free; i++)
+				lua_close(free[i]);
+		}
+
+		Mutex mutex;
+		lua_State* free[CROWN_MAX_COMPILER_THREADS];
+		uint32_t num_free;
+	};
+
+	static CompilerPool s_pool;
+
+	static lua_State* acquire_compiler()
+	{
+		{
+			ScopedMutex sm(s_pool.mutex);
+			if (s_pool.num_free > 0)
+				return s_pool.free[--s_pool.num_free];
+		}
+
+		lua_State* L = luaL_newstate();
+		CE_ASSERT(L != NULL, "Unable to create lua state");
+		luaL_openlibs(L);
+		return L;
+	}
+
+	static void release_compiler(lua_State* L)
+	{
+		lua_settop(L, 0);
+
+		ScopedMutex sm(s_pool.mutex);
+		if (s_pool.num_free < CE_COUNTOF(s_pool.free))
+			s_pool.free[s_pool.num_free++] = L;
+		else
+			lua_close(L);
+	}
+
+	// Compiles the @a source chunk to bytecode the same way `luajit -b` does.
+	// The bytecode is produced by string.dump() rather than lua_dump()
+	// because the latter always keeps the debug info.
+	// Returns false and writes the error to @a error if the chunk is not valid.
+	static bool compile_chunk(lua_State* L, const char* source, size_t size, const char* chunkname
+		, Buffer& bytecode, char* error, size_t len)
+	{
+		bool ok = luaL_loadbuffer(L, source, size, chunkname) == 0;
+		if (ok)
+		{
+			lua_getfield(L, LUA_GLOBALSINDEX, "string");
+			lua_getfield(L, -1, "dump");
+			lua_remove(L, -2);
+			lua_insert(L, -2);
+			lua_pushboolean(L, LUAJIT_STRIP);
+			ok = lua_pcall(L, 2, 1, 0) == 0;
+		}
+
+		if (ok)
+		{
+			size_t bytecode_size;
+			const char* bc = lua_tolstring(L, -1, &bytecode_size);
+			array::push(bytecode, bc, uint32_t(bytecode_size));
+		}
+		else
+		{
+			const char* msg = lua_tostring(L, -1);
+			strncpy(error, msg != NULL ? msg : "unknown error", len - 1);
+			error[len - 1] = '\0';
+		}
+
+		lua_settop(L, 0);
+		return ok;
+	}
+
 	void compile(const char* path, CompileOptions& opts)
 	{
 		TempAllocator1024 alloc;
 		DynamicString res_abs_path(alloc);
-		TempAllocator1024 alloc2;
-		DynamicString bc_abs_path(alloc2);
 		opts.get_absolute_path(path, res_abs_path);
-		opts.get_absolute_path("bc.tmp", bc_abs_path);
 
-		const char* luajit[] =
-		{
-#if CROWN_PLATFORM_LINUX
-			"./luajit",
-#else
-			"luajit.exe",
-#endif // CROWN_PLATFORM_LINUX
-			LUAJIT_FLAGS,
-			res_abs_path.c_str(),
-			bc_abs_path.c_str(),
-			NULL
-		};
-
-		int exitcode = os::execute_process(luajit);
-		CE_ASSERT(exitcode == 0, "Failed to compile lua");
-
-		Buffer blob = opts.read(bc_abs_path.c_str());
-		opts.delete_file(bc_abs_path.c_str());
+		// Named like luaL_loadfile() does so that the debug info matches
+		DynamicString chunkname(alloc);
+		chunkname += "@";
+		chunkname += res_abs_path;
+
+		Buffer source = opts.read(path);
+		Buffer blob(default_allocator());
+		char error[1024];
+
+		lua_State* L = acquire_compiler();
+		const bool ok = compile_chunk(L
+			, array::begin(source)
+			, array::size(source)
+			, chunkname.c_str()
+			, blob
+			, error
+			, sizeof(error)
+			);
+		release_compiler(L);
+		CE_ASSERT(ok, "Failed to compile lua: %s", error);
+		CE_UNUSED(ok);
 
 		LuaResource lr;
 		lr.version = SCRIPT_VERSION;
@@ -160,6 +160,10 @@ namespace material_resource
 		parse_textures(root, texdata, names, dynblob);
 		parse_uniforms(root, unidata, names, dynblob);
 
+		opts.add_dependency(SHADER_TYPE, shader);
+		for (uint32_t i = 0; i < array::size(texdata); i++)
+			opts.add_dependency(TEXTURE_TYPE, texdata[i].id);
+
 		MaterialResource mr;
 		mr.version = MATERIAL_VERSION;
 		mr.shader = shader;
@@ -12,6 +12,14 @@
 #include "vector3.h"
 #include "resource_manager.h"
 #include "compile_options.h"
+#include "mesh_optimizer.h"
+#include "vertex_format.h"
+#include "vector2.h"
+#include "aabb.h"
+#include "matrix4x4.h"
+#include "array.h"
+#include "hash.h"
+#include "murmur.h"
 
 namespace crown
 {
@@ -23,7 +31,7 @@ namespace mesh_resource
 		Vector3 normal;
 		Vector2 texcoord;
 
-		bool operator==(const MeshVertex& other)
+		bool operator==(const MeshVertex& other) const
 		{
 			return position == other.position &&
 					normal == other.normal &&
@@ -31,6 +39,24 @@ namespace mesh_resource
 		}
 	};
 
+	// Returns @a f with -0.0f turned to 0.0f, so that vertices
+	// which compare equal have the same bytes and thus the same hash.
+	static float canonical(float f)
+	{
+		return f == 0.0f ? 0.0f : f;
+	}
+
+	static uint64_t vertex_hash(const MeshVertex& v)
+	{
+		const float data[] =
+		{
+			canonical(v.position.x), canonical(v.position.y), canonical(v.position.z),
+			canonical(v.normal.x), canonical(v.normal.y), canonical(v.normal.z),
+			canonical(v.texcoord.x), canonical(v.texcoord.y)
+		};
+		return murmur64(data, sizeof(data), 0);
+	}
+
 	void compile(const char* path, CompileOptions& opts)
 	{
 		Buffer buf = opts.read(path);
@@ -43,6 +69,15 @@ namespace mesh_resource
 		JSONElement normal = root.key_or_nil("normal");
 		JSONElement texcoord = root.key_or_nil("texcoord");
 
+		// Reorder triangles and vertices for the GPU caches
+		const bool optimize = root.key_or_nil("optimize").to_bool(true);
+
+		const VertexFormat::Enum position_format = vertex_format::read(root, "position_format");
+		const VertexFormat::Enum normal_format = vertex_format::read(root, "normal_format");
+		const VertexFormat::Enum texcoord_format = vertex_format::read(root, "texcoord_format");
+		CE_ASSERT(position_format != VertexFormat::OCTAHEDRAL, "Bad mesh: positions can not be octahedral");
+		CE_ASSERT(texcoord_format != VertexFormat::OCTAHEDRAL, "Bad mesh: texcoords can not be octahedral");
+
 		Array<float> positions(default_allocator());
 		Array<float> normals(default_allocator());
 		Array<float> texcoords(default_allocator());
@@ -67,9 +102,9 @@ namespace mesh_resource
 		// Read index arrays
 		JSONElement index = root.key("index");
 
-		Array<uint16_t> position_index(default_allocator());
-		Array<uint16_t> normal_index(default_allocator());
-		Array<uint16_t> texcoord_index(default_allocator());
+		Array<uint32_t> position_index(default_allocator());
+		Array<uint32_t> normal_index(default_allocator());
+		Array<uint32_t> texcoord_index(default_allocator());
 
 		int ii = 0;
 		index[ii].to_array(position_index);
@@ -88,82 +123,139 @@ namespace mesh_resource
 		}
 
 		Array<MeshVertex> vertices(default_allocator());
-		Array<uint16_t> indices(default_allocator());
+		Array<uint32_t> indices(default_allocator());
+
+		// Vertices by hash, to weld the ones which are equal
+		Hash<uint32_t> lookup(default_allocator());
+		hash::reserve(lookup, array::size(position_index));
 
 		// Generate vb/ib
-		uint32_t idx = 0;
 		for (uint32_t i = 0; i < array::size(position_index); i++)
 		{
 			MeshVertex v;
+			v.normal = VECTOR3_ZERO;
+			v.texcoord = VECTOR2_ZERO;
 
-			uint16_t p_idx = position_index[i] * 3;
+			uint32_t p_idx = position_index[i] * 3;
+			CE_ASSERT(p_idx + 2 < array::size(positions), "Bad mesh: position index out of bounds");
 			v.position = vector3(positions[p_idx], positions[p_idx + 1], positions[p_idx + 2]);
 
 			if (has_normal)
 			{
-				uint16_t n_idx = normal_index[i] * 3;
+				uint32_t n_idx = normal_index[i] * 3;
+				CE_ASSERT(n_idx + 2 < array::size(normals), "Bad mesh: normal index out of bounds");
 				v.normal = vector3(normals[n_idx], normals[n_idx + 1], normals[n_idx + 2]);
 			}
 			if (has_texcoord)
 			{
-				uint16_t t_idx = texcoord_index[i] * 2;
+				uint32_t t_idx = texcoord_index[i] * 2;
+				CE_ASSERT(t_idx + 1 < array::size(texcoords), "Bad mesh: texcoord index out of bounds");
 				v.texcoord = vector2(texcoords[t_idx], texcoords[t_idx + 1]);
 			}
 
-			uint32_t f_idx = 0;
-			bool found = false;
-			for (; f_idx < array::size(vertices); f_idx++)
-			{
-				if (vertices[f_idx] == v)
-				{
-					found = true;
-					break;
-				}
-			}
+			const uint64_t key = vertex_hash(v);
 
-			if (found)
+			const Hash<uint32_t>::Entry* e = multi_hash::find_first(lookup, key);
+			while (e != NULL && !(vertices[e->value] == v))
+				e = multi_hash::find_next(lookup, e);
+
+			if (e != NULL)
 			{
-				array::push_back(indices, (uint16_t) f_idx);
+				array::push_back(indices, e->value);
 			}
 			else
 			{
+				multi_hash::insert(lookup, key, array::size(vertices));
+				array::push_back(indices, array::size(vertices));
 				array::push_back(vertices, v);
-				array::push_back(indices, (uint16_t) idx);
-				idx++;
 			}
 		}
 
+		if (optimize)
+		{
+			const uint32_t num_vertices = array::size(vertices);
+			const uint32_t num_indices = array::size(indices);
+			const float acmr = mesh_optimizer::average_cache_miss_ratio(array::begin(indices), num_indices, num_vertices, 16);
+
+			mesh_optimizer::optimize_vertex_cache(array::begin(indices), num_indices, num_vertices);
+
+			Array<uint32_t> remap(default_allocator());
+			array::resize(remap, num_vertices);
+			mesh_optimizer::optimize_vertex_fetch(array::begin(indices), num_indices, num_vertices, array::begin(remap));
+
+			Array<MeshVertex> ordered(default_allocator());
+			array::resize(ordered, num_vertices);
+			for (uint32_t i = 0; i < num_vertices; i++)
+				ordered[remap[i]] = vertices[i];
+			vertices = ordered;
+
+			CE_LOGD("%s: ACMR %.3f -> %.3f", path, acmr
+				, mesh_optimizer::average_cache_miss_ratio(array::begin(indices), num_indices, num_vertices, 16));
+		}
+
+		// Quantized positions are stored normalized to [-1, 1] within the bounding box
+		Vector3 position_offset = VECTOR3_ZERO;
+		Vector3 position_scale = vector3(1.0f, 1.0f, 1.0f);
+		if (position_format != VertexFormat::FLOAT && array::size(vertices) > 0)
+		{
+			AABB bounds;
+			bounds.min = vertices[0].position;
+			bounds.max = vertices[0].position;
+			for (uint32_t i = 1; i < array::size(vertices); ++i)
+				aabb::add_points(bounds, 1, &vertices[i].position);
+
+			position_offset = aabb::center(bounds);
+			position_scale = (bounds.max - bounds.min) * 0.5f;
+			position_scale.x = position_scale.x > 0.0f ? position_scale.x : 1.0f;
+			position_scale.y = position_scale.y > 0.0f ? position_scale.y : 1.0f;
+			position_scale.z = position_scale.z > 0.0f ? position_scale.z : 1.0f;
+		}
+
 		bgfx::VertexDecl decl;
 		decl.begin();
-		decl.add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float);
+		vertex_format::add(decl, bgfx::Attrib::Position, 3, position_format);
 
 		if (has_normal)
-			decl.add(bgfx::Attrib::Normal, 3, bgfx::AttribType::Float, false);
+			vertex_format::add(decl, bgfx::Attrib::Normal, 3, normal_format);
 
 		if (has_texcoord)
-			decl.add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Float);
+			vertex_format::add(decl, bgfx::Attrib::TexCoord0, 2, texcoord_format);
 
 		decl.end();
 
 		// Write
 		opts.write(MESH_VERSION);
 		opts.write(decl);
+		opts.write(position_offset);
+		opts.write(position_scale);
 		opts.write(array::size(vertices));
 		for (uint32_t i = 0; i < array::size(vertices); ++i)
 		{
-			opts.write(vertices[i].position);
+			const MeshVertex& v = vertices[i];
+
+			const Vector3 p = vector3((v.position.x - position_offset.x) / position_scale.x
+				, (v.position.y - position_offset.y) / position_scale.y
+				, (v.position.z - position_offset.z) / position_scale.z
+				);
+			vertex_format::write(opts, to_float_ptr(p), 3, position_format);
 
 			if (has_normal)
-				opts.write(vertices[i].normal);
+				vertex_format::write(opts, to_float_ptr(v.normal), 3, normal_format);
 
 			if (has_texcoord)
-				opts.write(vertices[i].texcoord);
+				vertex_format::write(opts, to_float_ptr(v.texcoord), 2, texcoord_format);
 		}
 
+		// 16-bit indices unless there are too many vertices
+		const uint32_t index_size = array::size(vertices) > 65535 ? sizeof(uint32_t) : sizeof(uint16_t);
+		opts.write(index_size);
 		opts.write(array::size(indices));
 		for (uint32_t i = 0; i < array::size(indices); ++i)
 		{
-			opts.write(indices[i]);
+			if (index_size == sizeof(uint32_t))
+				opts.write(indices[i]);
+			else
+				opts.write(uint16_t(indices[i]));
 		}
 	}
 
@@ -177,20 +269,30 @@ namespace mesh_resource
 		bgfx::VertexDecl decl;
 		br.read(decl);
 
+		Vector3 position_offset;
+		Vector3 position_scale;
+		br.read(position_offset);
+		br.read(position_scale);
+
 		uint32_t num_verts;
 		br.read(num_verts);
 		const bgfx::Memory* vbmem = bgfx::alloc(num_verts * decl.getStride());
 		br.read(vbmem->data, num_verts * decl.getStride());
 
+		uint32_t index_size;
+		br.read(index_size);
 		uint32_t num_inds;
 		br.read(num_inds);
-		const bgfx::Memory* ibmem = bgfx::alloc(num_inds * sizeof(uint16_t));
-		br.read(ibmem->data, num_inds * sizeof(uint16_t));
+		const bgfx::Memory* ibmem = bgfx::alloc(num_inds * index_size);
+		br.read(ibmem->data, num_inds * index_size);
 
 		MeshResource* mr = (MeshResource*)a.allocate(sizeof(MeshResource));
 		mr->decl = decl;
+		mr->position_offset = position_offset;
+		mr->position_scale = position_scale;
 		mr->vbmem = vbmem;
 		mr->ibmem = ibmem;
+		mr->index_size = index_size;
 
 		return mr;
 	}
@@ -200,7 +302,7 @@ namespace mesh_resource
 		MeshResource* mr = (MeshResource*)rm.get(MESH_TYPE, id);
 
 		mr->vb = bgfx::createVertexBuffer(mr->vbmem, mr->decl);
-		mr->ib = bgfx::createIndexBuffer(mr->ibmem);
+		mr->ib = bgfx::createIndexBuffer(mr->ibmem, mr->index_size == sizeof(uint32_t) ? BGFX_BUFFER_INDEX32 : BGFX_BUFFER_NONE);
 	}
 
 	void offline(StringId64 id, ResourceManager& rm)
@@ -215,5 +317,14 @@ namespace mesh_resource
 	{
 		a.deallocate(res);
 	}
+
+	Matrix4x4 position_transform(const MeshResource* mr)
+	{
+		return matrix4x4(vector3(mr->position_scale.x, 0.0f, 0.0f)
+			, vector3(0.0f, mr->position_scale.y, 0.0f)
+			, vector3(0.0f, 0.0f, mr->position_scale.z)
+			, mr->position_offset
+			);
+	}
 } // namespace mesh_resource
 } // namespace crown
@@ -9,6 +9,7 @@
 #include "resource_types.h"
 #include "filesystem_types.h"
 #include "compiler_types.h"
+#include "math_types.h"
 #include <bgfx.h>
 
 namespace crown
@@ -17,8 +18,11 @@ namespace crown
 struct MeshResource
 {
 	bgfx::VertexDecl decl;
+	Vector3 position_offset; // Quantized positions are position_offset + position * position_scale
+	Vector3 position_scale;
 	const bgfx::Memory* vbmem;
 	const bgfx::Memory* ibmem;
+	uint32_t index_size; // Size in bytes of an index, 2 or 4
 	bgfx::VertexBufferHandle vb;
 	bgfx::IndexBufferHandle ib;
 };
@@ -30,5 +34,10 @@ namespace mesh_resource
 	void online(StringId64 /*id*/, ResourceManager& /*rm*/);
 	void offline(StringId64 /*id*/, ResourceManager& /*rm*/);
 	void unload(Allocator& a, void* res);
+
+	/// Returns the matrix which transforms the positions stored in the
+	/// vertex buffer of @a mr to the mesh space.
+	/// It is the identity unless the positions are quantized.
+	Matrix4x4 position_transform(const MeshResource* mr);
 }
 } // namespace crown
@@ -10,138 +10,146 @@
 #include "temp_allocator.h"
 #include "reader_writer.h"
 #include "compile_options.h"
+#include "hash.h"
+#include "murmur.h"
+#include "log.h"
+#include "macros.h"
 
 namespace crown
 {
 namespace package_resource
 {
+	struct PackageKey
+	{
+		const char* key;
+		StringId64 type;
+	};
+
+	// Keys of the .package file and the type of the resources they list
+	static const PackageKey PACKAGE_KEYS[] =
+	{
+		{ "texture",          TEXTURE_TYPE          },
+		{ "lua",              SCRIPT_TYPE           },
+		{ "sound",            SOUND_TYPE            },
+		{ "mesh",             MESH_TYPE             },
+		{ "unit",             UNIT_TYPE             },
+		{ "sprite",           SPRITE_TYPE           },
+		{ "physics",          PHYSICS_TYPE          },
+		{ "material",         MATERIAL_TYPE         },
+		{ "font",             FONT_TYPE             },
+		{ "level",            LEVEL_TYPE            },
+		{ "physics_config",   PHYSICS_CONFIG_TYPE   },
+		{ "shader",           SHADER_TYPE           },
+		{ "sprite_animation", SPRITE_ANIMATION_TYPE }
+	};
+
+	struct Closure
+	{
+		Closure()
+			: entries(default_allocator())
+			, dependencies(default_allocator())
+			, visited(default_allocator())
+		{
+		}
+
+		Array<PackageEntry> entries;
+		Array<ResourceDependency> dependencies;
+		Hash<uint32_t> visited; // VISITING or the index in entries
+	};
+
+	static const uint32_t VISITING = 0xffffffffu;
+
+	static uint64_t resource_key(StringId64 type, StringId64 name)
+	{
+		const uint64_t id = name.id();
+		return murmur64(&id, sizeof(id), type.id());
+	}
+
+	// Adds the resource (@a type, @a name) to the closure
+	// after all the resources it depends on.
+	static void add_resource(StringId64 type, StringId64 name, CompileOptions& opts, Closure& c)
+	{
+		const uint64_t key = resource_key(type, name);
+		if (hash::has(c.visited, key))
+			return;
+
+		hash::set(c.visited, key, VISITING);
+
+		Array<ResourceDependency> deps(default_allocator());
+		opts.dependencies(type, name, deps);
+
+		for (uint32_t i = 0; i < array::size(deps); i++)
+			add_resource(deps[i].type, deps[i].name, opts, c);
+
+		PackageEntry pe;
+		pe.type = type;
+		pe.name = name;
+		pe.num_dependencies = 0;
+		pe.first_dependency = array::size(c.dependencies);
+		pe.size = opts.resource_size(type, name);
+		pe._pad = 0;
+
+		for (uint32_t i = 0; i < array::size(deps); i++)
+		{
+			if (hash::get(c.visited, resource_key(deps[i].type, deps[i].name), VISITING) == VISITING)
+			{
+				char type_buf[StringId64::STRING_LENGTH];
+				char name_buf[StringId64::STRING_LENGTH];
+				CE_LOGW("Ignoring cyclic dependency #ID(%s-%s)", deps[i].type.to_string(type_buf), deps[i].name.to_string(name_buf));
+				continue;
+			}
+
+			array::push_back(c.dependencies, deps[i]);
+			pe.num_dependencies++;
+		}
+
+		hash::set(c.visited, key, array::size(c.entries));
+		array::push_back(c.entries, pe);
+	}
+
 	void compile(const char* path, CompileOptions& opts)
 	{
 		Buffer buf = opts.read(path);
 		JSONParser json(buf);
 		JSONElement root = json.root();
 
-		JSONElement texture  = root.key_or_nil("texture");
-		JSONElement script   = root.key_or_nil("lua");
-		JSONElement sound    = root.key_or_nil("sound");
-		JSONElement mesh     = root.key_or_nil("mesh");
-		JSONElement unit     = root.key_or_nil("unit");
-		JSONElement sprite   = root.key_or_nil("sprite");
-		JSONElement physics  = root.key_or_nil("physics");
-		JSONElement material = root.key_or_nil("material");
-		JSONElement font     = root.key_or_nil("font");
-		JSONElement level    = root.key_or_nil("level");
-		JSONElement phyconf  = root.key_or_nil("physics_config");
-		JSONElement shader   = root.key_or_nil("shader");
-		JSONElement sprite_animation = root.key_or_nil("sprite_animation");
-
-		const uint32_t num_textures  = texture.is_nil() ? 0 : texture.size();
-		const uint32_t num_scripts   = script.is_nil() ? 0 : script.size();
-		const uint32_t num_sounds    = sound.is_nil() ? 0 : sound.size();
-		const uint32_t num_meshes    = mesh.is_nil() ? 0 : mesh.size();
-		const uint32_t num_units     = unit.is_nil() ? 0 : unit.size();
-		const uint32_t num_sprites   = sprite.is_nil() ? 0 : sprite.size();
-		const uint32_t num_physics   = physics.is_nil() ? 0 : physics.size();
-		const uint32_t num_materials = material.is_nil() ? 0 : material.size();
-		const uint32_t num_fonts     = font.is_nil() ? 0 : font.size();
-		const uint32_t num_levels    = level.is_nil() ? 0 : level.size();
-		const uint32_t num_phyconfs  = phyconf.is_nil() ? 0 : phyconf.size();
-		const uint32_t num_shaders   = shader.is_nil() ? 0 : shader.size();
-		const uint32_t num_sprite_animations = sprite_animation.is_nil() ? 0 : sprite_animation.size();
-
-		// Write header
-		opts.write(PACKAGE_VERSION);
-		opts.write(num_textures);
-		uint32_t offt = sizeof(PackageResource);
-		opts.write(offt);
-
-		opts.write(num_scripts);
-		offt += sizeof(StringId64) * num_textures;
-		opts.write(offt);
-
-		opts.write(num_sounds);
-		offt += sizeof(StringId64) * num_scripts;
-		opts.write(offt);
-
-		opts.write(num_meshes);
-		offt += sizeof(StringId64) * num_sounds;
-		opts.write(offt);
-
-		opts.write(num_units);
-		offt += sizeof(StringId64) * num_meshes;
-		opts.write(offt);
-
-		opts.write(num_sprites);
-		offt += sizeof(StringId64) * num_units;
-		opts.write(offt);
-
-		opts.write(num_physics);
-		offt += sizeof(StringId64) * num_sprites;
-		opts.write(offt);
-
-		opts.write(num_materials);
-		offt += sizeof(StringId64) * num_physics;
-		opts.write(offt);
-
-		opts.write(num_fonts);
-		offt += sizeof(StringId64) * num_materials;
-		opts.write(offt);
-
-		opts.write(num_levels);
-		offt += sizeof(StringId64) * num_fonts;
-		opts.write(offt);
-
-		opts.write(num_phyconfs);
-		offt += sizeof(StringId64) * num_levels;
-		opts.write(offt);
-
-		opts.write(num_shaders);
-		offt += sizeof(StringId64) * num_phyconfs;
-		opts.write(offt);
-
-		opts.write(num_sprite_animations);
-		offt += sizeof(StringId64) * num_shaders;
-		opts.write(offt);
-
-		// Write resource ids
-		for (uint32_t i = 0; i < num_textures; i++)
-			opts.write(texture[i].to_resource_id());
-
-		for (uint32_t i = 0; i < num_scripts; i++)
-			opts.write(script[i].to_resource_id());
-
-		for (uint32_t i = 0; i < num_sounds; i++)
-			opts.write(sound[i].to_resource_id());
-
-		for (uint32_t i = 0; i < num_meshes; i++)
-			opts.write(mesh[i].to_resource_id());
-
-		for (uint32_t i = 0; i < num_units; i++)
-			opts.write(unit[i].to_resource_id());
-
-		for (uint32_t i = 0; i < num_sprites; i++)
-			opts.write(sprite[i].to_resource_id());
-
-		for (uint32_t i = 0; i < num_physics; i++)
-			opts.write(physics[i].to_resource_id());
-
-		for (uint32_t i = 0; i < num_materials; i++)
-			opts.write(material[i].to_resource_id());
-
-		for (uint32_t i = 0; i < num_fonts; i++)
-			opts.write(font[i].to_resource_id());
-
-		for (uint32_t i = 0; i < num_levels; i++)
-			opts.write(level[i].to_resource_id());
-
-		for (uint32_t i = 0; i < num_phyconfs; i++)
-			opts.write(phyconf[i].to_resource_id());
-
-		for (uint32_t i = 0; i < num_shaders; i++)
-			opts.write(shader[i].to_resource_id());
-
-		for (uint32_t i = 0; i < num_sprite_animations; i++)
-			opts.write(sprite_animation[i].to_resource_id());
+		Closure c;
+
+		for (uint32_t i = 0; i < CE_COUNTOF(PACKAGE_KEYS); i++)
+		{
+			JSONElement list = root.key_or_nil(PACKAGE_KEYS[i].key);
+			const uint32_t num = list.is_nil() ? 0 : list.size();
+
+			for (uint32_t j = 0; j < num; j++)
+				add_resource(PACKAGE_KEYS[i].type, list[j].to_resource_id(), opts, c);
+		}
+
+		PackageResource pr;
+		pr.version = PACKAGE_VERSION;
+		pr.num_resources = array::size(c.entries);
+		pr.resources_offset = sizeof(PackageResource);
+		pr.dependencies_offset = pr.resources_offset + sizeof(PackageEntry) * pr.num_resources;
+
+		opts.write(pr.version);
+		opts.write(pr.num_resources);
+		opts.write(pr.resources_offset);
+		opts.write(pr.dependencies_offset);
+
+		for (uint32_t i = 0; i < array::size(c.entries); i++)
+		{
+			opts.write(c.entries[i].type);
+			opts.write(c.entries[i].name);
+			opts.write(c.entries[i].num_dependencies);
+			opts.write(c.entries[i].first_dependency);
+			opts.write(c.entries[i].size);
+			opts.write(c.entries[i]._pad);
+		}
+
+		for (uint32_t i = 0; i < array::size(c.dependencies); i++)
+		{
+			opts.write(c.dependencies[i].type);
+			opts.write(c.dependencies[i].name);
+		}
 	}
 
 	void* load(File& file, Allocator& a)
@@ -165,160 +173,22 @@ namespace package_resource
 		allocator.deallocate(resource);
 	}
 
-	uint32_t num_textures(const PackageResource* pr)
-	{
-		return pr->num_textures;
-	}
-
-	uint32_t num_scripts(const PackageResource* pr)
-	{
-		return pr->num_scripts;
-	}
-
-	uint32_t num_sounds(const PackageResource* pr)
-	{
-		return pr->num_sounds;
-	}
-
-	uint32_t num_meshes(const PackageResource* pr)
-	{
-		return pr->num_meshes;
-	}
-
-	uint32_t num_units(const PackageResource* pr)
-	{
-		return pr->num_units;
-	}
-
-	uint32_t num_sprites(const PackageResource* pr)
-	{
-		return pr->num_sprites;
-	}
-
-	uint32_t num_physics(const PackageResource* pr)
-	{
-		return pr->num_physics;
-	}
-
-	uint32_t num_materials(const PackageResource* pr)
-	{
-		return pr->num_materials;
-	}
-
-	uint32_t num_fonts(const PackageResource* pr)
-	{
-		return pr->num_fonts;
-	}
-
-	uint32_t num_levels(const PackageResource* pr)
-	{
-		return pr->num_levels;
-	}
-
-	uint32_t num_physics_configs(const PackageResource* pr)
-	{
-		return pr->num_physics_configs;
-	}
-
-	uint32_t num_shaders(const PackageResource* pr)
-	{
-		return pr->num_shaders;
-	}
-
-	uint32_t num_sprite_animations(const PackageResource* pr)
-	{
-		return pr->num_sprite_animations;
-	}
-
-	StringId64 get_texture_id(const PackageResource* pr, uint32_t i)
-	{
-		CE_ASSERT(i < num_textures(pr), "Index out of bounds");
-		StringId64* begin = (StringId64*) ((char*)pr + pr->textures_offset);
-		return begin[i];
-	}
-
-	StringId64 get_script_id(const PackageResource* pr, uint32_t i)
-	{
-		CE_ASSERT(i < num_scripts(pr), "Index out of bounds");
-		StringId64* begin = (StringId64*) ((char*)pr + pr->scripts_offset);
-		return begin[i];
-	}
-
-	StringId64 get_sound_id(const PackageResource* pr, uint32_t i)
-	{
-		CE_ASSERT(i < num_sounds(pr), "Index out of bounds");
-		StringId64* begin = (StringId64*) ((char*)pr + pr->sounds_offset);
-		return begin[i];
-	}
-
-	StringId64 get_mesh_id(const PackageResource* pr, uint32_t i)
-	{
-		CE_ASSERT(i < num_meshes(pr), "Index out of bounds");
-		StringId64* begin = (StringId64*) ((char*)pr + pr->meshes_offset);
-		return begin[i];
-	}
-
-	StringId64 get_unit_id(const PackageResource* pr, uint32_t i)
-	{
-		CE_ASSERT(i < num_units(pr), "Index out of bounds");
-		StringId64* begin = (StringId64*) ((char*)pr + pr->units_offset);
-		return begin[i];
-	}
-
-	StringId64 get_sprite_id(const PackageResource* pr, uint32_t i)
-	{
-		CE_ASSERT(i < num_sprites(pr), "Index out of bounds");
-		StringId64* begin = (StringId64*) ((char*)pr + pr->sprites_offset);
-		return begin[i];
-	}
-
-	StringId64 get_physics_id(const PackageResource* pr, uint32_t i)
-	{
-		CE_ASSERT(i < num_physics(pr), "Index out of bounds");
-		StringId64* begin = (StringId64*) ((char*)pr + pr->physics_offset);
-		return begin[i];
-	}
-
-	StringId64 get_material_id(const PackageResource* pr, uint32_t i)
-	{
-		CE_ASSERT(i < num_materials(pr), "Index out of bounds");
-		StringId64* begin = (StringId64*) ((char*)pr + pr->materials_offset);
-		return begin[i];
-	}
-
-	StringId64 get_font_id(const PackageResource* pr, uint32_t i)
-	{
-		CE_ASSERT(i < num_fonts(pr), "Index out of bounds");
-		StringId64* begin = (StringId64*) ((char*)pr + pr->fonts_offset);
-		return begin[i];
-	}
-
-	StringId64 get_level_id(const PackageResource* pr, uint32_t i)
-	{
-		CE_ASSERT(i < num_levels(pr), "Index out of bounds");
-		StringId64* begin = (StringId64*) ((char*)pr + pr->levels_offset);
-		return begin[i];
-	}
-
-	StringId64 get_physics_config_id(const PackageResource* pr, uint32_t i)
+	uint32_t num_resources(const PackageResource* pr)
 	{
-		CE_ASSERT(i < num_physics_configs(pr), "Index out of bounds");
-		StringId64* begin = (StringId64*) ((char*)pr + pr->physics_configs_offset);
-		return begin[i];
+		return pr->num_resources;
 	}
 
-	StringId64 get_shader_id(const PackageResource* pr, uint32_t i)
+	const PackageEntry* get_resource(const PackageResource* pr, uint32_t i)
 	{
-		CE_ASSERT(i < num_shaders(pr), "Index out of bounds");
-		StringId64* begin = (StringId64*) ((char*)pr + pr->shaders_offset);
-		return begin[i];
+		CE_ASSERT(i < num_resources(pr), "Index out of bounds");
+		const PackageEntry* begin = (const PackageEntry*) ((const char*)pr + pr->resources_offset);
+		return &begin[i];
 	}
 
-	StringId64 get_sprite_animation_id(const PackageResource* pr, uint32_t i)
+	const ResourceDependency* get_dependencies(const PackageResource* pr, const PackageEntry* pe)
 	{
-		CE_ASSERT(i < num_sprite_animations(pr), "Index out of bounds");
-		StringId64* begin = (StringId64*) ((char*)pr + pr->sprite_animations_offset);
-		return begin[i];
+		const ResourceDependency* begin = (const ResourceDependency*) ((const char*)pr + pr->dependencies_offset);
+		return &begin[pe->first_dependency];
 	}
 } // namespace package_resource
 } // namespace crown
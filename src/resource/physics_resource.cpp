@@ -419,7 +419,9 @@ namespace actor_resource
 
 namespace physics_config_resource
 {
-	static Map<DynamicString, uint32_t>* s_ftm = NULL;
+	// Per thread, physics configs might be compiled in parallel
+	static CE_THREAD Map<DynamicString, uint32_t>* s_ftm = NULL;
+	static CE_THREAD uint32_t s_filter_mask = 1;
 
 	struct ObjectName
 	{
@@ -525,10 +527,9 @@ namespace physics_config_resource
 
 	uint32_t new_filter_mask()
 	{
-		static uint32_t mask = 1;
-		CE_ASSERT(mask != 0x80000000u, "Too many collision filters");
-		uint32_t tmp = mask;
-		mask = mask << 1;
+		CE_ASSERT(s_filter_mask != 0x80000000u, "Too many collision filters");
+		uint32_t tmp = s_filter_mask;
+		s_filter_mask = s_filter_mask << 1;
 		return tmp;
 	}
 
@@ -592,6 +593,7 @@ namespace physics_config_resource
 
 		typedef Map<DynamicString, uint32_t> FilterMap;
 		s_ftm = CE_NEW(default_allocator(), FilterMap)(default_allocator());
+		s_filter_mask = 1;
 
 		Array<ObjectName> material_names(default_allocator());
 		Array<PhysicsMaterial> material_objects(default_allocator());
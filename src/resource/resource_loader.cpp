@@ -7,49 +7,202 @@
 #include "memory.h"
 #include "resource_registry.h"
 #include "queue.h"
+#include "priority_queue.h"
 #include "filesystem.h"
 #include "temp_allocator.h"
 #include "path.h"
+#include "compressed_file.h"
+#include "memory_file.h"
+#include "array.h"
+#include "os.h"
+#include "hash.h"
+#include "murmur.h"
+#include <algorithm>
+#include <string.h> // memset, memcpy
 
 namespace crown
 {
 
-ResourceLoader::ResourceLoader(Filesystem& fs, Allocator& resource_heap)
-	: _fs(fs)
+// Maximum number of requests the I/O thread sorts at once.
+static const uint32_t IO_BATCH_SIZE = 64;
+
+// Number of files prefetched ahead of the one being read.
+static const uint32_t PREFETCH_DEPTH = 4;
+
+// Returns the path of the compiled resource (@a type, @a name).
+static void resource_path(StringId64 type, StringId64 name, DynamicString& path)
+{
+	char buf[1 + 2*StringId64::STRING_LENGTH];
+	type.to_string(buf);
+	buf[16] = '-';
+	name.to_string(buf + 17);
+
+	path::join(CROWN_DATA_DIRECTORY, buf, path);
+}
+
+// Adds @a n to the counter at @a key in @a h, counters at zero are removed.
+static void add_count(Hash<uint32_t>& h, uint64_t key, int32_t n)
+{
+	const uint32_t count = hash::get(h, key, 0u) + n;
+	if (count == 0)
+		hash::remove(h, key);
+	else
+		hash::set(h, key, count);
+}
+
+ResourceLoader::ResourceLoader(Filesystem& fs, Allocator& resource_heap, uint32_t num_threads)
+	: _num_threads(num_threads)
+	, _fs(fs)
 	, _resource_heap(resource_heap)
 	, _requests(default_allocator())
+	, _num_queued(default_allocator())
+	, _num_cancelled(default_allocator())
+	, _read(default_allocator())
 	, _loaded(default_allocator())
+	, _next_sequence(0)
+	, _num_pending(0)
+	, _num_waiting(0)
+	, _read_bytes(0)
+	, _read_ahead(CROWN_DEFAULT_READ_AHEAD)
+	, _io_waiting(false)
 	, _exit(false)
 {
-	_thread.start(ResourceLoader::thread_proc, this);
+	CE_ASSERT(num_threads > 0 && num_threads <= CROWN_MAX_LOADER_THREADS, "Bad number of threads: %d", num_threads);
+
+	_io_thread.start(ResourceLoader::io_thread_proc, this);
+	for (uint32_t i = 0; i < _num_threads; i++)
+		_threads[i].start(ResourceLoader::thread_proc, this);
 }
 
 ResourceLoader::~ResourceLoader()
 {
+	_mutex.lock();
 	_exit = true;
-	_thread.stop();
+	_mutex.unlock();
+
+	// Wake up all the threads so that they can notice _exit
+	_requests_sem.post();
+	_space_sem.post();
+	_read_sem.post(_num_threads);
+
+	_io_thread.stop();
+	for (uint32_t i = 0; i < _num_threads; i++)
+		_threads[i].stop();
+
+	while (!queue::empty(_read))
+	{
+		const ReadRequest& rr = queue::front(_read);
+		if (!rr.mapped)
+			default_allocator().deallocate((void*)rr.data);
+		default_allocator().deallocate(rr.request.dependencies);
+		queue::pop_front(_read);
+	}
+
+	for (uint32_t i = 0; i < priority_queue::size(_requests); i++)
+		default_allocator().deallocate(_requests._queue[i].dependencies);
+
+	for (uint32_t i = 0; i < queue::size(_loaded); i++)
+		default_allocator().deallocate(_loaded[i].dependencies);
+}
+
+void ResourceLoader::load(StringId64 type, StringId64 name, ResourcePriority::Enum priority, const ResourceDependency* dependencies, uint32_t num_dependencies)
+{
+	add_request(type, name, priority, dependencies, num_dependencies, false);
+}
+
+void ResourceLoader::reload(StringId64 type, StringId64 name)
+{
+	add_request(type, name, ResourcePriority::HIGH, NULL, 0, true);
+}
+
+bool ResourceLoader::cancel(StringId64 type, StringId64 name)
+{
+	const uint64_t key = request_key(type, name);
+
+	_mutex.lock();
+	if (hash::get(_num_queued, key, 0u) == 0)
+	{
+		_mutex.unlock();
+		return false;
+	}
+
+	// Which one of the requests for the resource is dropped does not matter
+	add_count(_num_queued, key, -1);
+	add_count(_num_cancelled, key, 1);
+	_mutex.unlock();
+
+	complete_request();
+	return true;
 }
 
-void ResourceLoader::load(StringId64 type, StringId64 name)
+void ResourceLoader::set_read_ahead(uint32_t bytes)
 {
-	add_request(type, name);
+	ScopedMutex sm(_mutex);
+	_read_ahead = bytes;
+	if (_io_waiting)
+	{
+		_io_waiting = false;
+		_space_sem.post();
+	}
 }
 
 void ResourceLoader::flush()
 {
-	while (num_requests()) {}
+	_mutex.lock();
+	if (_num_pending == 0)
+	{
+		_mutex.unlock();
+		return;
+	}
+	_num_waiting++;
+	_mutex.unlock();
+
+	_flush_sem.wait();
 }
 
-void ResourceLoader::add_request(StringId64 type, StringId64 name)
+uint32_t ResourceLoader::num_pending()
 {
 	ScopedMutex sm(_mutex);
-	queue::push_back(_requests, make_request(type, name));
+	return _num_pending;
+}
+
+void ResourceLoader::add_request(StringId64 type, StringId64 name, ResourcePriority::Enum priority, const ResourceDependency* dependencies, uint32_t num_dependencies, bool reload)
+{
+	ResourceRequest rr;
+	rr.type = type;
+	rr.name = name;
+	rr.priority = (uint32_t)priority;
+	rr.dependencies = NULL;
+	rr.num_dependencies = num_dependencies;
+	if (num_dependencies > 0)
+	{
+		// The caller's copy might be freed before the request completes
+		rr.dependencies = (ResourceDependency*) default_allocator().allocate(sizeof(ResourceDependency) * num_dependencies);
+		memcpy(rr.dependencies, dependencies, sizeof(ResourceDependency) * num_dependencies);
+	}
+	rr.reload = reload;
+	rr.enqueued = os::clocktime();
+
+	_mutex.lock();
+	rr.sequence = _next_sequence++;
+	priority_queue::push(_requests, rr);
+	if (!reload)
+		add_count(_num_queued, request_key(type, name), 1);
+	_num_pending++;
+	_mutex.unlock();
+
+	_requests_sem.post();
 }
 
-uint32_t ResourceLoader::num_requests()
+void ResourceLoader::complete_request()
 {
 	ScopedMutex sm(_mutex);
-	return queue::size(_requests);
+
+	if (--_num_pending == 0 && _num_waiting > 0)
+	{
+		_flush_sem.post(_num_waiting);
+		_num_waiting = 0;
+	}
 }
 
 void ResourceLoader::add_loaded(ResourceData data)
@@ -58,51 +211,233 @@ void ResourceLoader::add_loaded(ResourceData data)
 	queue::push_back(_loaded, data);
 }
 
-void ResourceLoader::get_loaded(Array<ResourceData>& loaded)
+void ResourceLoader::get_loaded(Queue<ResourceData>& loaded)
 {
 	ScopedMutex sm(_loaded_mutex);
 	uint32_t num = queue::size(_loaded);
 	for (uint32_t i = 0; i < num; i++)
 	{
-		array::push_back(loaded, queue::front(_loaded));
+		queue::push_back(loaded, queue::front(_loaded));
 		queue::pop_front(_loaded);
 	}
 }
 
-int32_t ResourceLoader::run()
+bool ResourceLoader::storage_order_less(const ResourceRequest& a, const ResourceRequest& b)
+{
+	return a.storage_order != b.storage_order
+		? a.storage_order < b.storage_order
+		: a.sequence < b.sequence
+		;
+}
+
+uint64_t ResourceLoader::request_key(StringId64 type, StringId64 name)
+{
+	const uint64_t id = name.id();
+	return murmur64(&id, sizeof(id), type.id());
+}
+
+bool ResourceLoader::pop_request(ResourceRequest& rr)
+{
+	rr = priority_queue::top(_requests);
+	priority_queue::pop(_requests);
+
+	if (rr.reload)
+		return true;
+
+	const uint64_t key = request_key(rr.type, rr.name);
+	if (hash::get(_num_cancelled, key, 0u) == 0)
+	{
+		add_count(_num_queued, key, -1);
+		return true;
+	}
+
+	add_count(_num_cancelled, key, -1);
+	default_allocator().deallocate(rr.dependencies);
+	return false;
+}
+
+ResourceLoader::ReadRequest ResourceLoader::read(const ResourceRequest& rr)
+{
+	TempAllocator256 alloc;
+	DynamicString path(alloc);
+	resource_path(rr.type, rr.name, path);
+
+	ReadRequest read;
+	read.request = rr;
+	memset(&read.sample, 0, sizeof(read.sample));
+	read.sample.enqueued = rr.enqueued;
+
+	const int64_t start = os::clocktime();
+	File* file = _fs.open(path.c_str(), FOM_READ);
+	const void* mapped = file->mapped_data();
+	read.size = (uint32_t)file->size();
+	read.mapped = mapped != NULL;
+
+	if (read.mapped)
+	{
+		// Already in memory, pages are brought in by prefetch()
+		read.data = mapped;
+	}
+	else
+	{
+		void* data = default_allocator().allocate(read.size);
+		file->read(data, read.size);
+		read.data = data;
+	}
+
+	_fs.close(file);
+
+	read.sample.ticks[LoadStage::QUEUE] = start - rr.enqueued;
+	read.sample.ticks[LoadStage::IO] = os::clocktime() - start;
+	read.sample.bytes = read.size;
+	return read;
+}
+
+int32_t ResourceLoader::io_run()
 {
-	while (!_exit)
+	TempAllocator4096 ta;
+	Array<ResourceRequest> batch(ta);
+
+	while (true)
 	{
+		// Sleep until there is something to read
+		_requests_sem.wait();
+
 		_mutex.lock();
-		if (queue::empty(_requests))
+		if (_exit)
 		{
 			_mutex.unlock();
+			break;
+		}
+
+		// Only requests with the same priority are reordered
+		array::clear(batch);
+		while (!priority_queue::empty(_requests)
+			&& array::size(batch) < IO_BATCH_SIZE
+			&& (array::empty(batch) || priority_queue::top(_requests).priority == batch[0].priority))
+		{
+			ResourceRequest rr;
+			if (pop_request(rr))
+				array::push_back(batch, rr);
+		}
+		_mutex.unlock();
+
+		// Either cancelled or taken by a previous batch
+		if (array::empty(batch))
 			continue;
+
+		for (uint32_t i = 0; i < array::size(batch); i++)
+		{
+			TempAllocator256 alloc;
+			DynamicString path(alloc);
+			resource_path(batch[i].type, batch[i].name, path);
+			batch[i].storage_order = _fs.storage_order(path.c_str());
+		}
+
+		std::sort(array::begin(batch), array::end(batch), storage_order_less);
+
+		uint32_t num_prefetched = 0;
+		for (uint32_t i = 0; i < array::size(batch); i++)
+		{
+			// Keep the next files coming while this one is being read
+			for (; num_prefetched < array::size(batch) && num_prefetched <= i + PREFETCH_DEPTH; num_prefetched++)
+			{
+				TempAllocator256 alloc;
+				DynamicString path(alloc);
+				resource_path(batch[num_prefetched].type, batch[num_prefetched].name, path);
+				_fs.prefetch(path.c_str());
+			}
+
+			ReadRequest rr = read(batch[i]);
+			const uint32_t size = rr.mapped ? 0 : rr.size;
+
+			// Do not read too far ahead of the workers
+			_mutex.lock();
+			while (_read_bytes != 0 && _read_bytes + size > _read_ahead && !_exit)
+			{
+				_io_waiting = true;
+				_mutex.unlock();
+				_space_sem.wait();
+				_mutex.lock();
+			}
+			_read_bytes += size;
+			queue::push_back(_read, rr);
+			_mutex.unlock();
+
+			_read_sem.post();
+		}
+	}
+
+	return 0;
+}
+
+int32_t ResourceLoader::run()
+{
+	while (true)
+	{
+		// Sleep until there is something to deserialize
+		_read_sem.wait();
+
+		_mutex.lock();
+		if (_exit)
+		{
+			_mutex.unlock();
+			break;
 		}
-		ResourceRequest id = queue::front(_requests);
+		ReadRequest rr = queue::front(_read);
+		queue::pop_front(_read);
 		_mutex.unlock();
 
+		const ResourceRequest& id = rr.request;
+
 		ResourceData rd;
 		rd.type = id.type;
 		rd.name = id.name;
+		rd.dependencies = id.dependencies;
+		rd.num_dependencies = id.num_dependencies;
+		rd.reload = id.reload;
+		rd.in_place = rr.mapped && resource_in_place(id.type);
+		rd.sample = rr.sample;
 
-		char name[1 + 2*StringId64::STRING_LENGTH];
-		id.type.to_string(name);
-		name[16] = '-';
-		id.name.to_string(name + 17);
+		const int64_t start = os::clocktime();
+		MemoryFile file(rr.data, rr.size);
 
-		TempAllocator256 alloc;
-		DynamicString path(alloc);
-		path::join(CROWN_DATA_DIRECTORY, name, path);
+		if (rd.in_place)
+		{
+			rd.size = rr.size;
+			rd.data = (void*)rr.data;
+		}
+		else if (compressed_file::is_compressed(file))
+		{
+			// Decompress on this thread straight into the resource
+			CompressedFile cf(file, default_allocator());
+			rd.size = (uint32_t)cf.size();
+			rd.data = resource_on_load(id.type, cf, _resource_heap);
+		}
+		else
+		{
+			rd.size = rr.size;
+			rd.data = resource_on_load(id.type, file, _resource_heap);
+		}
+
+		rd.sample.loaded = os::clocktime();
+		rd.sample.ticks[LoadStage::LOAD] = rd.sample.loaded - start;
 
-		File* file = _fs.open(path.c_str(), FOM_READ);
-		rd.data = resource_on_load(id.type, *file, _resource_heap);
-		_fs.close(file);
+		if (!rr.mapped)
+		{
+			default_allocator().deallocate((void*)rr.data);
+
+			ScopedMutex sm(_mutex);
+			_read_bytes -= rr.size;
+			if (_io_waiting)
+			{
+				_io_waiting = false;
+				_space_sem.post();
+			}
+		}
 
 		add_loaded(rd);
-		_mutex.lock();
-		queue::pop_front(_requests);
-		_mutex.unlock();
+		complete_request();
 	}
 
 	return 0;
@@ -5,12 +5,16 @@
 
 #pragma once
 
+#include "config.h"
 #include "types.h"
 #include "filesystem_types.h"
 #include "thread.h"
 #include "container_types.h"
 #include "mutex.h"
+#include "semaphore.h"
 #include "memory_types.h"
+#include "resource_types.h"
+#include "resource_stats.h"
 
 namespace crown
 {
@@ -20,9 +24,18 @@ struct ResourceData
 	StringId64 type;
 	StringId64 name;
 	void* data;
+	uint32_t size; // Size of the compiled resource in bytes
+	ResourceDependency* dependencies; // Copy of the ones passed to load(), owned by the receiver
+	uint32_t num_dependencies;
+	bool in_place; // Whether data points straight into a mapped file
+	bool reload; // Whether data is a new version of a resource already loaded
+	ResourceLoadSample sample; // Timings up to the LOAD stage
 };
 
-/// Loads resources in a background thread.
+/// Loads resources in a pool of background threads.
+/// A dedicated I/O thread reads the requested files in batches, ordered by
+/// their position on the storage device, and @a num_threads worker threads
+/// deserialize the data it has read.
 ///
 /// @ingroup Resource
 class ResourceLoader
@@ -31,26 +44,65 @@ public:
 
 	/// Reads the resources data from the given @a fs using
 	/// @a resource_heap to allocate memory for them.
-	ResourceLoader(Filesystem& fs, Allocator& resource_heap);
+	/// Requests are serviced by @a num_threads worker threads.
+	ResourceLoader(Filesystem& fs, Allocator& resource_heap, uint32_t num_threads = CROWN_DEFAULT_LOADER_THREADS);
 	~ResourceLoader();
 
 	/// Loads the @a resource in a background thread.
-	void load(StringId64 type, StringId64 name);
+	/// Requests with higher @a priority are serviced first.
+	/// A copy of the @a num_dependencies @a dependencies is handed back with the
+	/// loaded data, the receiver has to free it with default_allocator().
+	void load(StringId64 type
+		, StringId64 name
+		, ResourcePriority::Enum priority = ResourcePriority::NORMAL
+		, const ResourceDependency* dependencies = NULL
+		, uint32_t num_dependencies = 0
+		);
+
+	/// Loads again the @a resource in a background thread.
+	/// The loaded data is flagged as a reload so that it can replace the old one.
+	void reload(StringId64 type, StringId64 name);
+
+	/// Removes a queued load() request for the resource (@a type, @a name).
+	/// Returns false if there is no such request or if it is already being loaded.
+	/// The request is only marked as cancelled, it is dropped when it reaches the
+	/// front of the queue, so that cancelling many requests takes linear time.
+	bool cancel(StringId64 type, StringId64 name);
+
+	/// Sets the maximum number of @a bytes read ahead of the worker threads.
+	/// A single file larger than that is still read.
+	void set_read_ahead(uint32_t bytes);
 
 	/// Blocks until all pending requests have been processed.
 	void flush();
 
-	void get_loaded(Array<ResourceData>& loaded);
+	/// Returns the number of requests either queued or being loaded.
+	uint32_t num_pending();
+
+	/// Moves the resources loaded so far at the back of @a loaded.
+	void get_loaded(Queue<ResourceData>& loaded);
 
 private:
 
-	void add_request(StringId64 type, StringId64 name);
-	uint32_t num_requests();
+	void add_request(StringId64 type, StringId64 name, ResourcePriority::Enum priority, const ResourceDependency* dependencies, uint32_t num_dependencies, bool reload);
 	void add_loaded(ResourceData data);
 
-	// Loads resources in the loading queue.
+	// Marks a request as processed and wakes up flush() if
+	// there is nothing left to do.
+	void complete_request();
+
+	// Reads the files of the requests in the loading queue.
+	int32_t io_run();
+
+	// Deserializes the resources read by io_run().
 	int32_t run();
 
+	static int32_t io_thread_proc(void* thiz)
+	{
+		ResourceLoader* rl = (ResourceLoader*)thiz;
+		return rl->io_run();
+	}
+
 	static int32_t thread_proc(void* thiz)
 	{
 		ResourceLoader* rl = (ResourceLoader*)thiz;
@@ -63,22 +115,76 @@ private:
 	{
 		StringId64 type;
 		StringId64 name;
+		uint32_t priority;
+		uint32_t sequence; // Keeps requests with the same priority in FIFO order
+		ResourceDependency* dependencies; // Owned by the request
+		uint32_t num_dependencies;
+		uint64_t storage_order; // Filled in by the I/O thread
+		int64_t enqueued;
+		bool reload;
+
+		bool operator<(const ResourceRequest& other) const
+		{
+			return priority != other.priority
+				? priority < other.priority
+				: sequence > other.sequence
+				;
+		}
 	};
 
-	ResourceRequest make_request(StringId64 type, StringId64 name)
+	// Request whose file has been read and waits to be deserialized.
+	struct ReadRequest
 	{
-		ResourceRequest request = { type, name };
-		return request;
-	}
+		ResourceRequest request;
+		const void* data;
+		uint32_t size;
+		bool mapped; // Whether data is owned by the filesystem
+		ResourceLoadSample sample;
+	};
+
+	// Orders requests by their position on the storage device.
+	static bool storage_order_less(const ResourceRequest& a, const ResourceRequest& b);
+
+	// Returns the key used to count the requests for the resource (@a type, @a name).
+	static uint64_t request_key(StringId64 type, StringId64 name);
 
-	Thread _thread;
+	// Pops the request at the top of the queue into @a rr.
+	// Returns false if the request had been cancelled, in which case it is freed.
+	bool pop_request(ResourceRequest& rr);
+
+	// Reads the file of the request @a rr.
+	ReadRequest read(const ResourceRequest& rr);
+
+	Thread _io_thread;
+	Thread _threads[CROWN_MAX_LOADER_THREADS];
+	uint32_t _num_threads;
 	Filesystem& _fs;
 	Allocator& _resource_heap;
 
-	Queue<ResourceRequest> _requests;
+	PriorityQueue<ResourceRequest> _requests;
+	// Number of load() requests in _requests for each resource,
+	// either still wanted or cancelled but not yet dropped.
+	Hash<uint32_t> _num_queued;
+	Hash<uint32_t> _num_cancelled;
+	Queue<ReadRequest> _read;
 	Queue<ResourceData> _loaded;
 	Mutex _mutex;
 	Mutex _loaded_mutex;
+
+	uint32_t _next_sequence;
+	// Number of requests either queued or being loaded.
+	uint32_t _num_pending;
+	// Number of threads blocked in flush().
+	uint32_t _num_waiting;
+	// Size of the data read but not yet deserialized.
+	uint32_t _read_bytes;
+	uint32_t _read_ahead;
+	// Whether the I/O thread is waiting for _read_bytes to drop.
+	bool _io_waiting;
+	Semaphore _requests_sem;
+	Semaphore _read_sem;
+	Semaphore _space_sem;
+	Semaphore _flush_sem;
 	bool _exit;
 };
 
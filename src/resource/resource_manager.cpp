@@ -6,87 +6,154 @@
 #include "resource_manager.h"
 #include "resource_registry.h"
 #include "temp_allocator.h"
-#include "sort_map.h"
+#include "hash.h"
+#include "murmur.h"
 #include "array.h"
+#include "queue.h"
+#include "os.h"
 
 namespace crown
 {
 
-const ResourceManager::ResourceEntry ResourceManager::ResourceEntry::NOT_FOUND = { 0xffffffffu, NULL };
+// Returns the record of @a h which maps @a key to @a slot.
+static const Hash<uint32_t>::Entry* find_record(const Hash<uint32_t>& h, uint64_t key, uint32_t slot)
+{
+	const Hash<uint32_t>::Entry* e = multi_hash::find_first(h, key);
+	while (e != NULL && e->value != slot)
+		e = multi_hash::find_next(h, e);
+	return e;
+}
 
-ResourceManager::ResourceManager(Filesystem& fs)
+// Adds @a n to the counter at @a key in @a h, counters at zero are removed.
+static void add_count(Hash<uint32_t>& h, uint64_t key, int32_t n)
+{
+	const uint32_t count = hash::get(h, key, 0u) + n;
+	if (count == 0)
+		hash::remove(h, key);
+	else
+		hash::set(h, key, count);
+}
+
+ResourceManager::ResourceManager(Filesystem& fs, uint32_t num_loader_threads)
 	: _resource_heap("resource", default_allocator())
-	, _loader(fs, _resource_heap)
-	, _rm(default_allocator())
+	, _loader(fs, _resource_heap, num_loader_threads)
+	, _resources(default_allocator())
+	, _index(default_allocator())
+	, _slots(default_allocator())
+	, _free_slots(default_allocator())
+	, _pending(default_allocator())
+	, _pending_bytes(0)
+	, _num_pending_loads(default_allocator())
+	, _num_pending_cancelled(default_allocator())
+	, _num_cancelled(0)
+	, _online_time_budget(0.0f)
+	, _online_bytes_budget(0)
+	, _waiting(default_allocator())
+	, _memory_budget(0)
+	, _num_cached(0)
+	, _lru_head(NO_SLOT)
+	, _lru_tail(NO_SLOT)
+	, _reload_callback(NULL)
+	, _reload_user_data(NULL)
 	, _autoload(false)
 {
 }
 
 ResourceManager::~ResourceManager()
 {
-	const ResourceMap::Entry* begin = sort_map::begin(_rm);
-	const ResourceMap::Entry* end = sort_map::end(_rm);
+	_loader.flush();
+	_loader.get_loaded(_pending);
 
-	for (; begin != end; begin++)
+	while (!queue::empty(_pending))
 	{
-		resource_on_offline(begin->key.type, begin->key.name, *this);
-		resource_on_unload(begin->key.type, _resource_heap, begin->value.data);
+		const ResourceData& rd = queue::front(_pending);
+		if (!rd.in_place)
+			resource_on_unload(rd.type, _resource_heap, rd.data);
+		default_allocator().deallocate(rd.dependencies);
+		queue::pop_front(_pending);
+	}
+
+	for (uint32_t i = 0; i < array::size(_resources); i++)
+	{
+		const ResourceEntry& entry = _resources[i];
+		if (entry.online)
+			resource_on_offline(entry.type, entry.name, *this);
+		default_allocator().deallocate(entry.dependencies);
+		if (!entry.in_place)
+			resource_on_unload(entry.type, _resource_heap, entry.data);
 	}
 }
 
-void ResourceManager::load(StringId64 type, StringId64 name)
+void ResourceManager::load(StringId64 type, StringId64 name, ResourcePriority::Enum priority, const ResourceDependency* dependencies, uint32_t num_dependencies)
 {
-	ResourcePair id = make_pair(type, name);
-	ResourceEntry& entry = sort_map::get(_rm, id, ResourceEntry::NOT_FOUND);
+	const uint32_t i = find(type, name);
 
-	if (entry == ResourceEntry::NOT_FOUND)
+	if (i == NOT_FOUND)
 	{
-		_loader.load(type, name);
+		_loader.load(type, name, priority, dependencies, num_dependencies);
 		return;
 	}
 
-	entry.references++;
+	if (_resources[i].references++ == 0)
+		revive(i);
 }
 
 void ResourceManager::unload(StringId64 type, StringId64 name)
 {
+	// Every request still in flight accounts for one reference
+	if (_loader.cancel(type, name) || cancel_pending(type, name))
+		return;
+
 	flush();
 
-	ResourcePair id = make_pair(type, name);
-	ResourceEntry& entry = sort_map::get(_rm, id, ResourceEntry::NOT_FOUND);
+	const uint32_t i = find(type, name);
+	CE_ASSERT(i != NOT_FOUND && _resources[i].references > 0, "Resource not loaded");
 
-	if (--entry.references == 0)
+	if (--_resources[i].references == 0)
 	{
-		resource_on_offline(type, name, *this);
-		resource_on_unload(type, _resource_heap, entry.data);
+		if (_resources[i].online)
+			resource_on_offline(type, name, *this);
+		else
+			stop_waiting(i);
+		_resources[i].online = false;
+
+		if (_memory_budget == 0 || !resource_cacheable(type))
+		{
+			evict(i);
+			return;
+		}
 
-		sort_map::remove(_rm, id);
-		sort_map::sort(_rm);
+		// Resources used in place do not take space in the resource heap
+		if (!_resources[i].in_place)
+			lru_push_back(i);
+		_num_cached++;
+		trim_cache();
 	}
 }
 
 void ResourceManager::reload(StringId64 type, StringId64 name)
 {
-	const ResourcePair id = make_pair(type, name);
-	const ResourceEntry& entry = sort_map::get(_rm, id, ResourceEntry::NOT_FOUND);
-	const uint32_t old_refs = entry.references;
-
-	unload(type, name);
-	load(type, name);
-	flush();
+	CE_ASSERT(find(type, name) != NOT_FOUND, "Resource not loaded");
+	_loader.reload(type, name);
+}
 
-	ResourceEntry& new_entry = sort_map::get(_rm, id, ResourceEntry::NOT_FOUND);
-	new_entry.references = old_refs;
+void ResourceManager::set_reload_callback(ResourceReloadCallback callback, void* user_data)
+{
+	_reload_callback = callback;
+	_reload_user_data = user_data;
 }
 
 bool ResourceManager::can_get(StringId64 type, StringId64 name)
 {
-	return _autoload ? true : sort_map::has(_rm, make_pair(type, name));
+	if (_autoload)
+		return true;
+
+	const uint32_t i = find(type, name);
+	return i != NOT_FOUND && _resources[i].online;
 }
 
 const void* ResourceManager::get(StringId64 type, StringId64 name)
 {
-	const ResourcePair id = make_pair(type, name);
 	char type_buf[StringId64::STRING_LENGTH];
 	char name_buf[StringId64::STRING_LENGTH];
 
@@ -94,14 +161,45 @@ const void* ResourceManager::get(StringId64 type, StringId64 name)
 	CE_UNUSED(type_buf);
 	CE_UNUSED(name_buf);
 
-	if (_autoload && !sort_map::has(_rm, id))
+	uint32_t i = find(type, name);
+
+	if (_autoload && (i == NOT_FOUND || !_resources[i].online))
 	{
 		load(type, name);
 		flush();
+		i = find(type, name);
 	}
 
-	const ResourceEntry& entry = sort_map::get(_rm, id, ResourceEntry::NOT_FOUND);
-	return entry.data;
+	return _resources[i].data;
+}
+
+ResourceHandle ResourceManager::get_handle(StringId64 type, StringId64 name)
+{
+	if (_autoload)
+		get(type, name);
+
+	const uint32_t i = find(type, name);
+	CE_ASSERT(i != NOT_FOUND, "Resource not loaded");
+
+	ResourceHandle handle;
+	handle.index = _resources[i].slot;
+	handle.generation = _slots[handle.index].generation;
+	return handle;
+}
+
+bool ResourceManager::can_get(StringId64 type, ResourceHandle handle) const
+{
+	if (handle.index >= array::size(_slots) || _slots[handle.index].generation != handle.generation)
+		return false;
+
+	const ResourceEntry& entry = _resources[_slots[handle.index].entry];
+	return entry.type == type && entry.online;
+}
+
+const void* ResourceManager::get(StringId64 type, ResourceHandle handle) const
+{
+	CE_ASSERT(can_get(type, handle), "Bad resource handle");
+	return _resources[_slots[handle.index].entry].data;
 }
 
 void ResourceManager::enable_autoload(bool enable)
@@ -112,29 +210,485 @@ void ResourceManager::enable_autoload(bool enable)
 void ResourceManager::flush()
 {
 	_loader.flush();
-	complete_requests();
+	complete_requests(false);
 }
 
 void ResourceManager::complete_requests()
 {
+	complete_requests(true);
+}
+
+void ResourceManager::set_read_ahead(uint32_t bytes)
+{
+	_loader.set_read_ahead(bytes);
+}
+
+void ResourceManager::set_online_budget(float time, uint32_t bytes)
+{
+	_online_time_budget = time;
+	_online_bytes_budget = bytes;
+}
+
+void ResourceManager::set_memory_budget(uint32_t bytes)
+{
+	_memory_budget = bytes;
+
+	if (_memory_budget == 0)
+	{
+		// Drop the whole cache
+		for (uint32_t i = array::size(_resources); i > 0; i--)
+		{
+			if (_resources[i - 1].references == 0)
+				evict(i - 1);
+		}
+		_num_cached = 0;
+		return;
+	}
+
+	trim_cache();
+}
+
+uint32_t ResourceManager::num_cached() const
+{
+	return _num_cached;
+}
+
+uint32_t ResourceManager::resident_bytes()
+{
+	return _resource_heap.total_allocated();
+}
+
+uint32_t ResourceManager::num_pending_load()
+{
+	return _loader.num_pending();
+}
+
+uint32_t ResourceManager::num_pending_online() const
+{
+	return queue::size(_pending) - _num_cancelled;
+}
+
+uint32_t ResourceManager::bytes_pending_online() const
+{
+	return _pending_bytes;
+}
+
+const ResourceStats& ResourceManager::load_stats() const
+{
+	return _stats;
+}
+
+void ResourceManager::clear_load_stats()
+{
+	_stats.clear();
+}
+
+void ResourceManager::fetch_loaded()
+{
+	const uint32_t num_old = queue::size(_pending);
+	_loader.get_loaded(_pending);
+
+	for (uint32_t i = num_old; i < queue::size(_pending); i++)
+	{
+		_pending_bytes += _pending[i].size;
+		if (!_pending[i].reload)
+			add_count(_num_pending_loads, resource_key(_pending[i].type, _pending[i].name), 1);
+	}
+}
+
+bool ResourceManager::cancel_pending(StringId64 type, StringId64 name)
+{
+	fetch_loaded();
+
+	const uint64_t key = resource_key(type, name);
+	if (hash::get(_num_pending_loads, key, 0u) == 0)
+		return false;
+
+	// Which one of the loads of the resource is dropped does not matter
+	add_count(_num_pending_loads, key, -1);
+	add_count(_num_pending_cancelled, key, 1);
+	_num_cancelled++;
+	return true;
+}
+
+void ResourceManager::drop_cancelled()
+{
+	while (_num_cancelled > 0 && !queue::empty(_pending))
+	{
+		const ResourceData& rd = queue::front(_pending);
+		if (rd.reload)
+			return;
+
+		const uint64_t key = resource_key(rd.type, rd.name);
+		if (hash::get(_num_pending_cancelled, key, 0u) == 0)
+			return;
+
+		add_count(_num_pending_cancelled, key, -1);
+		_num_cancelled--;
+
+		_pending_bytes -= rd.size;
+		if (!rd.in_place)
+			resource_on_unload(rd.type, _resource_heap, rd.data);
+		default_allocator().deallocate(rd.dependencies);
+		queue::pop_front(_pending);
+	}
+}
+
+void ResourceManager::complete_requests(bool use_budget)
+{
+	online_waiting();
+	fetch_loaded();
+
+	if (queue::empty(_pending))
+		return;
+
+	const uint64_t start = os::clocktime();
+	const uint64_t max_ticks = use_budget && _online_time_budget > 0.0f
+		? uint64_t(_online_time_budget * os::clockfrequency())
+		: 0;
+	const uint32_t max_bytes = use_budget ? _online_bytes_budget : 0;
+
+	// Bring resources online in batches that fit the remaining budget.
+	// Each batch is committed before going online so that resources
+	// can reference each other when they are brought online.
 	TempAllocator1024 ta;
-	Array<ResourceData> loaded(ta);
-	_loader.get_loaded(loaded);
+	Array<ResourceData> batch(ta);
+	uint32_t bytes = 0;
+
+	while (!queue::empty(_pending))
+	{
+		if (max_ticks != 0 && os::clocktime() - start >= max_ticks)
+			break;
+
+		array::clear(batch);
+		do
+		{
+			drop_cancelled();
+			if (queue::empty(_pending))
+				break;
+
+			const ResourceData& rd = queue::front(_pending);
+			if (max_bytes != 0 && bytes != 0 && bytes + rd.size > max_bytes)
+				break;
+
+			bytes += rd.size;
+			_pending_bytes -= rd.size;
+			if (!rd.reload)
+				add_count(_num_pending_loads, resource_key(rd.type, rd.name), -1);
+			array::push_back(batch, rd);
+			queue::pop_front(_pending);
+		}
+		while (!queue::empty(_pending) && max_ticks == 0);
+
+		if (array::empty(batch))
+			break;
+
+		array::reserve(_resources, array::size(_resources) + array::size(batch));
+
+		uint32_t num_online = 0;
+		for (uint32_t i = 0; i < array::size(batch); i++)
+		{
+			const ResourceData& rd = batch[i];
 
-	for (uint32_t i = 0; i < array::size(loaded); i++)
-		complete_request(loaded[i].type, loaded[i].name, loaded[i].data);
+			if (rd.reload)
+			{
+				swap_reloaded(rd);
+				continue;
+			}
+
+			const uint32_t j = find(rd.type, rd.name);
+
+			if (j != NOT_FOUND)
+			{
+				// Requested more than once before it was available
+				if (_resources[j].references++ == 0)
+					revive(j);
+				if (!rd.in_place)
+					resource_on_unload(rd.type, _resource_heap, rd.data);
+				default_allocator().deallocate(rd.dependencies);
+				continue;
+			}
+
+			ResourceEntry entry;
+			entry.type = rd.type;
+			entry.name = rd.name;
+			entry.references = 1;
+			entry.data = rd.data;
+			entry.lru_prev = NO_SLOT;
+			entry.lru_next = NO_SLOT;
+			// Take the loader's copy, the dependencies are checked again
+			// whenever the resource is revived from the cache
+			entry.dependencies = rd.dependencies;
+			entry.num_dependencies = rd.num_dependencies;
+			entry.sample = rd.sample;
+			entry.in_place = rd.in_place;
+			entry.waiting = NOT_FOUND;
+			entry.online = dependencies_online(rd.dependencies, rd.num_dependencies);
+
+			add_entry(entry);
+
+			if (entry.online)
+				batch[num_online++] = rd;
+			else
+				start_waiting(array::size(_resources) - 1);
+		}
+
+		for (uint32_t i = 0; i < num_online; i++)
+		{
+			resource_on_online(batch[i].type, batch[i].name, *this);
+			record_online(batch[i].type, batch[i].sample);
+		}
+
+		online_waiting();
+	}
+
+	trim_cache();
+}
+
+bool ResourceManager::dependencies_online(const ResourceDependency* dependencies, uint32_t num) const
+{
+	for (uint32_t i = 0; i < num; i++)
+	{
+		const uint32_t j = find(dependencies[i].type, dependencies[i].name);
+		if (j == NOT_FOUND || !_resources[j].online)
+			return false;
+	}
+
+	return true;
+}
+
+void ResourceManager::start_waiting(uint32_t i)
+{
+	ResourceEntry& entry = _resources[i];
+	CE_ASSERT(entry.waiting == NOT_FOUND, "Resource already waiting");
+	entry.waiting = array::size(_waiting);
+	array::push_back(_waiting, entry.slot);
+}
+
+void ResourceManager::stop_waiting(uint32_t i)
+{
+	ResourceEntry& entry = _resources[i];
+	CE_ASSERT(entry.waiting != NOT_FOUND, "Resource not waiting");
+
+	// Move the last waiting resource into the hole
+	const uint16_t last = array::back(_waiting);
+	_waiting[entry.waiting] = last;
+	_resources[_slots[last].entry].waiting = entry.waiting;
+	array::pop_back(_waiting);
+	entry.waiting = NOT_FOUND;
+}
+
+void ResourceManager::online_waiting()
+{
+	// Dependencies are usually loaded before their dependents,
+	// so that a single pass is enough most of the time
+	bool progress = true;
+	while (!array::empty(_waiting) && progress)
+	{
+		progress = false;
+
+		for (uint32_t w = 0; w < array::size(_waiting); )
+		{
+			const uint32_t i = _slots[_waiting[w]].entry;
+			ResourceEntry& entry = _resources[i];
+
+			if (!dependencies_online(entry.dependencies, entry.num_dependencies))
+			{
+				w++;
+				continue;
+			}
+
+			// The last waiting resource takes its place
+			stop_waiting(i);
+			entry.online = true;
+			resource_on_online(entry.type, entry.name, *this);
+			record_online(_resources[i].type, _resources[i].sample);
+			progress = true;
+		}
+	}
+}
+
+void ResourceManager::record_online(StringId64 type, ResourceLoadSample sample)
+{
+	sample.ticks[LoadStage::ONLINE] = os::clocktime() - sample.loaded;
+	_stats.add(type, sample);
+}
+
+void ResourceManager::swap_reloaded(const ResourceData& rd)
+{
+	const uint32_t i = find(rd.type, rd.name);
+
+	if (i == NOT_FOUND)
+	{
+		// Unloaded while the new version was being loaded
+		if (!rd.in_place)
+			resource_on_unload(rd.type, _resource_heap, rd.data);
+		return;
+	}
+
+	const void* old_data = _resources[i].data;
+	const bool old_in_place = _resources[i].in_place;
+	const bool online = _resources[i].online;
+
+	if (online)
+		resource_on_offline(rd.type, rd.name, *this);
+
+	_resources[i].data = rd.data;
+	_resources[i].in_place = rd.in_place;
+
+	if (online)
+	{
+		resource_on_online(rd.type, rd.name, *this);
+		record_online(rd.type, rd.sample);
+
+		if (_reload_callback != NULL)
+			_reload_callback(rd.type, rd.name, old_data, rd.data, _reload_user_data);
+	}
+
+	if (!old_in_place)
+		resource_on_unload(rd.type, _resource_heap, (void*)old_data);
+}
+
+void ResourceManager::revive(uint32_t i)
+{
+	CE_ASSERT(_num_cached > 0, "Resource not cached");
+	_num_cached--;
+	lru_remove(i);
+
+	// The dependencies might have been evicted meanwhile, and be loading again
+	ResourceEntry& entry = _resources[i];
+	if (!dependencies_online(entry.dependencies, entry.num_dependencies))
+	{
+		start_waiting(i);
+		return;
+	}
+
+	entry.online = true;
+	resource_on_online(entry.type, entry.name, *this);
 }
 
-void ResourceManager::complete_request(StringId64 type, StringId64 name, void* data)
+void ResourceManager::evict(uint32_t i)
 {
-	ResourceEntry entry;
-	entry.references = 1;
-	entry.data = data;
+	const ResourceEntry& entry = _resources[i];
+	if (!entry.in_place)
+		resource_on_unload(entry.type, _resource_heap, entry.data);
+	default_allocator().deallocate(entry.dependencies);
+	lru_remove(i);
+	remove_entry(i);
+}
+
+void ResourceManager::lru_push_back(uint32_t i)
+{
+	ResourceEntry& entry = _resources[i];
+	entry.lru_prev = _lru_tail;
+	entry.lru_next = NO_SLOT;
 
-	sort_map::set(_rm, make_pair(type, name), entry);
-	sort_map::sort(_rm);
+	if (_lru_tail == NO_SLOT)
+		_lru_head = entry.slot;
+	else
+		_resources[_slots[_lru_tail].entry].lru_next = entry.slot;
+	_lru_tail = entry.slot;
+}
+
+void ResourceManager::lru_remove(uint32_t i)
+{
+	ResourceEntry& entry = _resources[i];
+	if (entry.lru_prev == NO_SLOT && _lru_head != entry.slot)
+		return;
+
+	if (entry.lru_prev == NO_SLOT)
+		_lru_head = entry.lru_next;
+	else
+		_resources[_slots[entry.lru_prev].entry].lru_next = entry.lru_next;
+
+	if (entry.lru_next == NO_SLOT)
+		_lru_tail = entry.lru_prev;
+	else
+		_resources[_slots[entry.lru_next].entry].lru_prev = entry.lru_prev;
+
+	entry.lru_prev = NO_SLOT;
+	entry.lru_next = NO_SLOT;
+}
+
+void ResourceManager::trim_cache()
+{
+	while (_lru_head != NO_SLOT && resident_bytes() > _memory_budget)
+	{
+		_num_cached--;
+		evict(_slots[_lru_head].entry);
+	}
+}
+
+uint64_t ResourceManager::resource_key(StringId64 type, StringId64 name)
+{
+	const uint64_t id = name.id();
+	return murmur64(&id, sizeof(id), type.id());
+}
+
+uint32_t ResourceManager::find(StringId64 type, StringId64 name) const
+{
+	const Hash<uint32_t>::Entry* e = multi_hash::find_first(_index, resource_key(type, name));
+
+	while (e != NULL)
+	{
+		const ResourceEntry& entry = _resources[e->value];
+		if (entry.type == type && entry.name == name)
+			return e->value;
+
+		e = multi_hash::find_next(_index, e);
+	}
+
+	return NOT_FOUND;
+}
+
+void ResourceManager::add_entry(const ResourceEntry& entry)
+{
+	uint16_t slot;
+	if (array::empty(_free_slots))
+	{
+		CE_ASSERT(array::size(_slots) < 0xffff, "Too many resources");
+		slot = (uint16_t)array::size(_slots);
+		ResourceSlot rs;
+		rs.generation = 1;
+		array::push_back(_slots, rs);
+	}
+	else
+	{
+		slot = array::back(_free_slots);
+		array::pop_back(_free_slots);
+	}
+	_slots[slot].entry = array::size(_resources);
+
+	multi_hash::insert(_index, resource_key(entry.type, entry.name), array::size(_resources));
+	array::push_back(_resources, entry);
+	array::back(_resources).slot = slot;
+}
+
+void ResourceManager::remove_entry(uint32_t i)
+{
+	const uint32_t last = array::size(_resources) - 1;
+
+	const ResourceEntry& removed = _resources[i];
+	multi_hash::remove(_index, find_record(_index, resource_key(removed.type, removed.name), i));
+
+	// Invalidate the handles to the removed resource, 0 is never a valid generation
+	ResourceSlot& rs = _slots[removed.slot];
+	if (++rs.generation > ResourceHandle::MAX_GENERATION)
+		rs.generation = 1;
+	array::push_back(_free_slots, removed.slot);
+
+	if (i != last)
+	{
+		// Move the last entry into the hole and update its record
+		const ResourceEntry& moved = _resources[last];
+		const uint64_t key = resource_key(moved.type, moved.name);
+		multi_hash::remove(_index, find_record(_index, key, last));
+		multi_hash::insert(_index, key, i);
+		_slots[moved.slot].entry = i;
+		_resources[i] = moved;
+	}
 
-	resource_on_online(type, name, *this);
+	array::pop_back(_resources);
 }
 
 } // namespace crown
@@ -13,6 +13,10 @@
 namespace crown
 {
 
+/// Called when the resource (@a type, @a name) has been reloaded.
+/// Both @a old_resource and @a new_resource are valid for the duration of the call.
+typedef void (*ResourceReloadCallback)(StringId64 type, StringId64 name, const void* old_resource, const void* new_resource, void* user_data);
+
 /// @defgroup Resource Resource
 
 /// Keeps track and manages resources loaded by ResourceLoader.
@@ -22,77 +26,236 @@ class ResourceManager
 {
 public:
 
-	/// The resources will be loaded from @a fs.
-	ResourceManager(Filesystem& fs);
+	/// The resources will be loaded from @a fs using
+	/// @a num_loader_threads background threads.
+	ResourceManager(Filesystem& fs, uint32_t num_loader_threads = CROWN_DEFAULT_LOADER_THREADS);
 	~ResourceManager();
 
 	/// Loads the resource (@a type, @a name).
+	/// Requests with higher @a priority are loaded first.
+	/// The resource is not brought online until the @a num_dependencies
+	/// @a dependencies are, which have to be loaded separately.
 	/// You can check whether the resource is available with can_get().
-	void load(StringId64 type, StringId64 name);
+	void load(StringId64 type
+		, StringId64 name
+		, ResourcePriority::Enum priority = ResourcePriority::NORMAL
+		, const ResourceDependency* dependencies = NULL
+		, uint32_t num_dependencies = 0
+		);
 
 	/// Unloads the resource @a type @a name.
+	/// If the resource has not been loaded yet, its load() request is cancelled.
+	/// When a memory budget is set, unreferenced resources are taken offline
+	/// but kept in memory, so that loading them again does not need any I/O.
 	void unload(StringId64 type, StringId64 name);
 
-	/// Reloads the resource (@a type, @a name).
-	/// @note The user has to manually update all the references to the old resource.
+	/// Reloads the resource (@a type, @a name) in the background.
+	/// The old data stays available until the new one has been loaded,
+	/// then complete_requests() swaps them and calls the reload callback.
 	void reload(StringId64 type, StringId64 name);
 
+	/// Sets the @a callback to call, with @a user_data, whenever
+	/// a reloaded resource replaces the old one.
+	/// The callback has to update all the references to the old resource.
+	void set_reload_callback(ResourceReloadCallback callback, void* user_data);
+
 	/// Returns whether the manager has the resource (@a type, @a name).
 	bool can_get(StringId64 type, StringId64 name);
 
 	/// Returns the data of the resource (@a type, @a name).
 	const void* get(StringId64 type, StringId64 name);
 
+	/// Returns a handle to the resource (@a type, @a name), which has to be loaded.
+	/// The handle keeps pointing to the new data when the resource is reloaded.
+	ResourceHandle get_handle(StringId64 type, StringId64 name);
+
+	/// Returns whether @a handle refers to a resource of the given
+	/// @a type which is still loaded.
+	bool can_get(StringId64 type, ResourceHandle handle) const;
+
+	/// Returns the data of the resource of the given @a type referred by @a handle.
+	const void* get(StringId64 type, ResourceHandle handle) const;
+
 	/// Sets whether resources should be automatically loaded when accessed.
 	void enable_autoload(bool enable);
 
 	/// Blocks until all load() requests have been completed.
 	void flush();
 
-	/// Completes all load() requests which have been loaded by ResourceLoader.
+	/// Completes the load() requests which have been loaded by ResourceLoader.
+	/// At most the online budget is spent bringing resources online, the
+	/// remaining ones are carried over to the next call.
 	void complete_requests();
 
-private:
+	/// Sets the maximum number of @a bytes read from disk ahead of
+	/// the threads which deserialize the resources.
+	void set_read_ahead(uint32_t bytes);
+
+	/// Sets the maximum amount of work complete_requests() does in a single call:
+	/// @a time is the number of seconds spent bringing resources online
+	/// and @a bytes the total size of the resources brought online.
+	/// A budget of 0 means unlimited. At least one resource is always
+	/// brought online so that loading can not stall.
+	void set_online_budget(float time, uint32_t bytes);
+
+	/// Sets the maximum number of @a bytes the resources may allocate
+	/// before the unreferenced ones are evicted, least recently used first.
+	/// A budget of 0 disables caching of unreferenced resources.
+	void set_memory_budget(uint32_t bytes);
+
+	/// Returns the number of unreferenced resources kept in memory.
+	uint32_t num_cached() const;
+
+	/// Returns the number of bytes allocated by the resources.
+	uint32_t resident_bytes();
+
+	/// Returns the number of load() requests which are still being
+	/// loaded by ResourceLoader.
+	uint32_t num_pending_load();
+
+	/// Returns the number of resources which have been loaded
+	/// but are waiting to be brought online.
+	uint32_t num_pending_online() const;
 
-	void complete_request(StringId64 type, StringId64 name, void* data);
+	/// Returns the size in bytes of the resources which have been
+	/// loaded but are waiting to be brought online.
+	uint32_t bytes_pending_online() const;
+
+	/// Returns the load timings of the resources brought online so far.
+	const ResourceStats& load_stats() const;
+
+	/// Forgets the load timings collected so far.
+	void clear_load_stats();
 
 private:
 
-	struct ResourcePair
+	struct ResourceEntry
 	{
 		StringId64 type;
 		StringId64 name;
-
-		bool operator<(const ResourcePair& a) const
-		{
-			return type < a.type || (type == a.type && name < a.name);
-		}
+		uint32_t references;
+		void* data;
+		ResourceDependency* dependencies; // Dependencies it waits for before going online
+		uint32_t num_dependencies;
+		uint16_t slot; // Slot handles refer to
+		uint32_t waiting; // Index in the waiting list or NOT_FOUND
+		uint16_t lru_prev; // Slots of the neighbours in the LRU list or NO_SLOT
+		uint16_t lru_next;
+		ResourceLoadSample sample; // Timings of the load, until it goes online
+		bool in_place;
+		bool online;
 	};
 
-	ResourcePair make_pair(StringId64 type, StringId64 name)
+	// Maps a handle to an entry in the resource table.
+	struct ResourceSlot
 	{
-		ResourcePair pair = { type, name };
-		return pair;
-	}
+		uint32_t entry;
+		uint16_t generation;
+	};
 
-	struct ResourceEntry
-	{
-		bool operator==(const ResourceEntry& e)
-		{
-			return references == e.references && data == e.data;
-		}
+	// Returns the key used to index the resource (@a type, @a name).
+	static uint64_t resource_key(StringId64 type, StringId64 name);
 
-		uint32_t references;
-		void* data;
+	// Returns the index of the resource (@a type, @a name) in the
+	// resource table or NOT_FOUND if the resource is not loaded.
+	uint32_t find(StringId64 type, StringId64 name) const;
 
-		static const ResourceEntry NOT_FOUND;
-	};
+	// Adds a resource to the table without bringing it online.
+	void add_entry(const ResourceEntry& entry);
 
-	typedef SortMap<ResourcePair, ResourceEntry> ResourceMap;
+	// Removes the resource at index @a i from the table.
+	void remove_entry(uint32_t i);
+
+	// Returns whether all the @a num @a dependencies are online.
+	bool dependencies_online(const ResourceDependency* dependencies, uint32_t num) const;
+
+	// Makes the resource at index @a i wait for its dependencies.
+	void start_waiting(uint32_t i);
+
+	// Stops the resource at index @a i from waiting for its dependencies.
+	void stop_waiting(uint32_t i);
+
+	// Brings online the resources whose dependencies have come online.
+	void online_waiting();
+
+	// Completes the @a sample of a resource of the given @a type
+	// which has just been brought online and records it.
+	void record_online(StringId64 type, ResourceLoadSample sample);
+
+	// Replaces the data of a loaded resource with the reloaded one in @a rd.
+	void swap_reloaded(const ResourceData& rd);
+
+	// Brings online again the cached resource at index @a i, or makes
+	// it wait if some of its dependencies are not online anymore.
+	void revive(uint32_t i);
+
+	// Frees the data of the offline resource at index @a i
+	// and removes it from the table.
+	void evict(uint32_t i);
+
+	// Appends the cached resource at index @a i to the LRU list.
+	void lru_push_back(uint32_t i);
+
+	// Removes the resource at index @a i from the LRU list, if it is there.
+	void lru_remove(uint32_t i);
+
+	// Evicts cached resources until the memory budget is met.
+	void trim_cache();
+
+	// Moves the resources loaded by ResourceLoader to the pending queue.
+	void fetch_loaded();
+
+	// Discards a resource which has been loaded but not yet brought online.
+	// Returns false if there is no such resource.
+	// The resource is only marked as cancelled, see drop_cancelled().
+	bool cancel_pending(StringId64 type, StringId64 name);
+
+	// Frees the cancelled resources at the front of the pending queue.
+	void drop_cancelled();
+
+	// Brings online the resources loaded by ResourceLoader, honoring
+	// the online budget if @a use_budget is true.
+	void complete_requests(bool use_budget);
+
+	static const uint32_t NOT_FOUND = 0xffffffffu;
+	static const uint16_t NO_SLOT = 0xffff;
 
 	ProxyAllocator _resource_heap;
 	ResourceLoader _loader;
-	ResourceMap _rm;
+	Array<ResourceEntry> _resources;
+	Hash<uint32_t> _index;
+
+	// Handle slots, these do not move when the table is compacted.
+	Array<ResourceSlot> _slots;
+	Array<uint16_t> _free_slots;
+
+	// Resources loaded but not yet online.
+	Queue<ResourceData> _pending;
+	uint32_t _pending_bytes;
+	// Number of resources in _pending for each resource key,
+	// either still wanted or cancelled but not yet dropped.
+	Hash<uint32_t> _num_pending_loads;
+	Hash<uint32_t> _num_pending_cancelled;
+	uint32_t _num_cancelled;
+	float _online_time_budget;
+	uint32_t _online_bytes_budget;
+
+	// Slots of the resources loaded but waiting for their dependencies.
+	Array<uint16_t> _waiting;
+
+	uint32_t _memory_budget;
+	uint32_t _num_cached;
+
+	// Slots of the cached resources which take space in the resource
+	// heap, from the least recently used.
+	uint16_t _lru_head;
+	uint16_t _lru_tail;
+
+	ResourceStats _stats;
+
+	ResourceReloadCallback _reload_callback;
+	void* _reload_user_data;
+
 	bool _autoload;
 };
 
@@ -8,10 +8,21 @@
 #include "types.h"
 #include "resource_manager.h"
 #include "package_resource.h"
+#include "array.h"
+#include "memory.h"
 
 namespace crown
 {
 
+/// Progress of a ResourcePackage load.
+struct PackageProgress
+{
+	uint32_t num_loaded;   // Number of resources loaded
+	uint32_t num_total;    // Number of resources in the package
+	uint32_t bytes_loaded; // Size of the resources loaded
+	uint32_t bytes_total;  // Size of the resources in the package
+};
+
 /// Collection of resources to load in a batch.
 struct ResourcePackage
 {
@@ -19,10 +30,17 @@ struct ResourcePackage
 		: _resman(&resman)
 		, _id(id)
 		, _package(NULL)
+		, _resources(default_allocator())
 	{
 		resman.load(PACKAGE_TYPE, _id);
 		resman.flush();
 		_package = (const PackageResource*) resman.get(PACKAGE_TYPE, _id);
+
+		for (uint32_t i = 0; i < package_resource::num_resources(_package); i++)
+		{
+			const PackageEntry* pe = package_resource::get_resource(_package, i);
+			add_resource(pe->type, pe->name, pe->size);
+		}
 	}
 
 	~ResourcePackage()
@@ -30,148 +48,33 @@ struct ResourcePackage
 		_resman->unload(PACKAGE_TYPE, _id);
 	}
 
-	/// Loads all the resources in the package.
+	/// Loads all the resources in the package and the resources they depend on.
+	/// Requests with higher @a priority are loaded first.
 	/// @note
 	/// The resources are not immediately available after the call is made,
-	/// instead, you have to poll for completion with has_loaded()
-	void load()
+	/// instead, you have to poll for completion with has_loaded().
+	/// Each resource is brought online as soon as its dependencies are.
+	void load(ResourcePriority::Enum priority = ResourcePriority::NORMAL)
 	{
-		using namespace package_resource;
-
-		for (uint32_t i = 0; i < num_textures(_package); i++)
+		for (uint32_t i = 0; i < package_resource::num_resources(_package); i++)
 		{
-			_resman->load(TEXTURE_TYPE, get_texture_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_scripts(_package); i++)
-		{
-			_resman->load(SCRIPT_TYPE, get_script_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_sounds(_package); i++)
-		{
-			_resman->load(SOUND_TYPE, get_sound_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_meshes(_package); i++)
-		{
-			_resman->load(MESH_TYPE, get_mesh_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_units(_package); i++)
-		{
-			_resman->load(UNIT_TYPE, get_unit_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_sprites(_package); i++)
-		{
-			_resman->load(SPRITE_TYPE, get_sprite_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_physics(_package); i++)
-		{
-			_resman->load(PHYSICS_TYPE, get_physics_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_materials(_package); i++)
-		{
-			_resman->load(MATERIAL_TYPE, get_material_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_fonts(_package); i++)
-		{
-			_resman->load(FONT_TYPE, get_font_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_levels(_package); i++)
-		{
-			_resman->load(LEVEL_TYPE, get_level_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_physics_configs(_package); i++)
-		{
-			_resman->load(PHYSICS_CONFIG_TYPE, get_physics_config_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_shaders(_package); i++)
-		{
-			_resman->load(SHADER_TYPE, get_shader_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_sprite_animations(_package); i++)
-		{
-			_resman->load(SPRITE_ANIMATION_TYPE, get_sprite_animation_id(_package, i));
+			const PackageEntry* pe = package_resource::get_resource(_package, i);
+			_resman->load(pe->type
+				, pe->name
+				, priority
+				, package_resource::get_dependencies(_package, pe)
+				, pe->num_dependencies
+				);
 		}
 	}
 
 	/// Unloads all the resources in the package.
+	/// The requests which have not been loaded yet are cancelled.
 	void unload()
 	{
-		using namespace package_resource;
-
-		for (uint32_t i = 0; i < num_sprite_animations(_package); i++)
-		{
-			_resman->unload(SPRITE_ANIMATION_TYPE, get_sprite_animation_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_shaders(_package); i++)
-		{
-			_resman->unload(SHADER_TYPE, get_shader_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_physics_configs(_package); i++)
-		{
-			_resman->unload(PHYSICS_CONFIG_TYPE, get_physics_config_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_levels(_package); i++)
-		{
-			_resman->unload(LEVEL_TYPE, get_level_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_fonts(_package); i++)
-		{
-			_resman->unload(FONT_TYPE, get_font_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_materials(_package); i++)
-		{
-			_resman->unload(MATERIAL_TYPE, get_material_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_physics(_package); i++)
-		{
-			_resman->unload(PHYSICS_TYPE, get_physics_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_sprites(_package); i++)
+		for (uint32_t i = array::size(_resources); i > 0; i--)
 		{
-			_resman->unload(SPRITE_TYPE, get_sprite_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_units(_package); i++)
-		{
-			_resman->unload(UNIT_TYPE, get_unit_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_meshes(_package); i++)
-		{
-			_resman->unload(MESH_TYPE, get_mesh_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_sounds(_package); i++)
-		{
-			_resman->unload(SOUND_TYPE, get_sound_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_scripts(_package); i++)
-		{
-			_resman->unload(SCRIPT_TYPE, get_script_id(_package, i));
-		}
-
-		for (uint32_t i = 0; i < num_textures(_package); i++)
-		{
-			_resman->unload(TEXTURE_TYPE, get_texture_id(_package, i));
+			_resman->unload(_resources[i - 1].type, _resources[i - 1].name);
 		}
 	}
 
@@ -184,94 +87,63 @@ struct ResourcePackage
 	/// Returns whether the package has been loaded.
 	bool has_loaded() const
 	{
-		using namespace package_resource;
-
-		for (uint32_t i = 0; i < num_textures(_package); i++)
+		for (uint32_t i = 0; i < array::size(_resources); i++)
 		{
-			if (!_resman->can_get(TEXTURE_TYPE, get_texture_id(_package, i)))
+			if (!_resman->can_get(_resources[i].type, _resources[i].name))
 				return false;
 		}
 
-		for (uint32_t i = 0; i < num_scripts(_package); i++)
-		{
-			if (!_resman->can_get(SCRIPT_TYPE, get_script_id(_package, i)))
-				return false;
-		}
-
-		for (uint32_t i = 0; i < num_sounds(_package); i++)
-		{
-			if (!_resman->can_get(SOUND_TYPE, get_sound_id(_package, i)))
-				return false;
-		}
-
-		for (uint32_t i = 0; i < num_meshes(_package); i++)
-		{
-			if (!_resman->can_get(MESH_TYPE, get_mesh_id(_package, i)))
-				return false;
-		}
-
-		for (uint32_t i = 0; i < num_units(_package); i++)
-		{
-			if (!_resman->can_get(UNIT_TYPE, get_unit_id(_package, i)))
-				return false;
-		}
-
-		for (uint32_t i = 0; i < num_sprites(_package); i++)
-		{
-			if (!_resman->can_get(SPRITE_TYPE, get_sprite_id(_package, i)))
-				return false;
-		}
-
-		for (uint32_t i = 0; i < num_physics(_package); i++)
-		{
-			if (!_resman->can_get(PHYSICS_TYPE, get_physics_id(_package, i)))
-				return false;
-		}
-
-		for (uint32_t i = 0; i < num_materials(_package); i++)
-		{
-			if (!_resman->can_get(MATERIAL_TYPE, get_material_id(_package, i)))
-				return false;
-		}
+		return true;
+	}
 
-		for (uint32_t i = 0; i < num_fonts(_package); i++)
-		{
-			if (!_resman->can_get(FONT_TYPE, get_font_id(_package, i)))
-				return false;
-		}
+	/// Returns how much of the package has been loaded.
+	PackageProgress progress() const
+	{
+		PackageProgress pp;
+		pp.num_loaded = 0;
+		pp.num_total = array::size(_resources);
+		pp.bytes_loaded = 0;
+		pp.bytes_total = 0;
 
-		for (uint32_t i = 0; i < num_levels(_package); i++)
+		for (uint32_t i = 0; i < array::size(_resources); i++)
 		{
-			if (!_resman->can_get(LEVEL_TYPE, get_level_id(_package, i)))
-				return false;
-		}
+			const Resource& res = _resources[i];
+			pp.bytes_total += res.size;
 
-		for (uint32_t i = 0; i < num_physics_configs(_package); i++)
-		{
-			if (!_resman->can_get(PHYSICS_CONFIG_TYPE, get_physics_config_id(_package, i)))
-				return false;
+			if (_resman->can_get(res.type, res.name))
+			{
+				pp.num_loaded++;
+				pp.bytes_loaded += res.size;
+			}
 		}
 
-		for (uint32_t i = 0; i < num_shaders(_package); i++)
-		{
-			if (!_resman->can_get(SHADER_TYPE, get_shader_id(_package, i)))
-				return false;
-		}
+		return pp;
+	}
 
-		for (uint32_t i = 0; i < num_sprite_animations(_package); i++)
-		{
-			if (!_resman->can_get(SPRITE_ANIMATION_TYPE, get_sprite_animation_id(_package, i)))
-				return false;
-		}
+private:
 
-		return true;
+	void add_resource(StringId64 type, StringId64 name, uint32_t size)
+	{
+		Resource res;
+		res.type = type;
+		res.name = name;
+		res.size = size;
+		array::push_back(_resources, res);
 	}
 
 private:
 
+	struct Resource
+	{
+		StringId64 type;
+		StringId64 name;
+		uint32_t size;
+	};
+
 	ResourceManager* _resman;
 	StringId64 _id;
 	const PackageResource* _package;
+	Array<Resource> _resources;
 };
 
 } // namespace crown
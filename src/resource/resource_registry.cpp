@@ -50,27 +50,39 @@ struct ResourceCallback
 	ResourceUnloadCallback on_unload;
 	ResourceOnlineCallback on_online;
 	ResourceOfflineCallback on_offline;
+
+	// Version of the compiled data. Bumping it makes the
+	// resources of this type compile again.
+	uint32_t version;
+
+	// Whether the compiled data can be used as-is, without being
+	// copied to the resource heap nor fixed up by on_load.
+	bool in_place;
+
+	// Whether the loaded data can be brought online again after going
+	// offline. It can not when on_online hands the data over to the renderer.
+	bool cacheable;
 };
 
 #define NULL_RESOURCE_TYPE StringId64(uint64_t(0))
 
 static const ResourceCallback RESOURCE_CALLBACK_REGISTRY[] =
 {
-	{ SCRIPT_TYPE,           lur::compile, lur::load, lur::unload, lur::online, lur::offline },
-	{ TEXTURE_TYPE,          txr::compile, txr::load, txr::unload, txr::online, txr::offline },
-	{ MESH_TYPE,             mhr::compile, mhr::load, mhr::unload, mhr::online, mhr::offline },
-	{ SOUND_TYPE,            sdr::compile, sdr::load, sdr::unload, sdr::online, sdr::offline },
-	{ UNIT_TYPE,             utr::compile, utr::load, utr::unload, utr::online, utr::offline },
-	{ SPRITE_TYPE,           spr::compile, spr::load, spr::unload, spr::online, spr::offline },
-	{ PACKAGE_TYPE,          pkr::compile, pkr::load, pkr::unload, pkr::online, pkr::offline },
-	{ PHYSICS_TYPE,          phr::compile, phr::load, phr::unload, phr::online, phr::offline },
-	{ MATERIAL_TYPE,         mtr::compile, mtr::load, mtr::unload, mtr::online, mtr::offline },
-	{ PHYSICS_CONFIG_TYPE,   pcr::compile, pcr::load, pcr::unload, pcr::online, pcr::offline },
-	{ FONT_TYPE,             ftr::compile, ftr::load, ftr::unload, ftr::online, ftr::offline },
-	{ LEVEL_TYPE,            lvr::compile, lvr::load, lvr::unload, lvr::online, lvr::offline },
-	{ SHADER_TYPE,           shr::compile, shr::load, shr::unload, shr::online, shr::offline },
-	{ SPRITE_ANIMATION_TYPE, sar::compile, sar::load, sar::unload, sar::online, sar::offline },
-	{ NULL_RESOURCE_TYPE,    NULL,         NULL,      NULL,        NULL,        NULL         }
+	{ SCRIPT_TYPE,           lur::compile, lur::load, lur::unload, lur::online, lur::offline, SCRIPT_VERSION,           true,  true  },
+	{ TEXTURE_TYPE,          txr::compile, txr::load, txr::unload, txr::online, txr::offline, TEXTURE_VERSION,          false, false },
+	{ MESH_TYPE,             mhr::compile, mhr::load, mhr::unload, mhr::online, mhr::offline, MESH_VERSION,             false, false },
+	{ SOUND_TYPE,            sdr::compile, sdr::load, sdr::unload, sdr::online, sdr::offline, SOUND_VERSION,            false, true  },
+	{ UNIT_TYPE,             utr::compile, utr::load, utr::unload, utr::online, utr::offline, UNIT_VERSION,             true,  true  },
+	{ SPRITE_TYPE,           spr::compile, spr::load, spr::unload, spr::online, spr::offline, SPRITE_VERSION,           false, false },
+	{ PACKAGE_TYPE,          pkr::compile, pkr::load, pkr::unload, pkr::online, pkr::offline, PACKAGE_VERSION,          true,  true  },
+	{ PHYSICS_TYPE,          phr::compile, phr::load, phr::unload, phr::online, phr::offline, PHYSICS_VERSION,          true,  true  },
+	{ MATERIAL_TYPE,         mtr::compile, mtr::load, mtr::unload, mtr::online, mtr::offline, MATERIAL_VERSION,         false, true  },
+	{ PHYSICS_CONFIG_TYPE,   pcr::compile, pcr::load, pcr::unload, pcr::online, pcr::offline, PHYSICS_CONFIG_VERSION,   true,  true  },
+	{ FONT_TYPE,             ftr::compile, ftr::load, ftr::unload, ftr::online, ftr::offline, FONT_VERSION,             true,  true  },
+	{ LEVEL_TYPE,            lvr::compile, lvr::load, lvr::unload, lvr::online, lvr::offline, LEVEL_VERSION,            true,  true  },
+	{ SHADER_TYPE,           shr::compile, shr::load, shr::unload, shr::online, shr::offline, SHADER_VERSION,           false, false },
+	{ SPRITE_ANIMATION_TYPE, sar::compile, sar::load, sar::unload, sar::online, sar::offline, SPRITE_ANIMATION_VERSION, true,  true  },
+	{ NULL_RESOURCE_TYPE,    NULL,         NULL,      NULL,        NULL,        NULL,         0,                        false, false }
 };
 
 static const ResourceCallback* find_callback(StringId64 type)
@@ -101,6 +113,21 @@ void resource_on_unload(StringId64 type, Allocator& allocator, void* resource)
 	return find_callback(type)->on_unload(allocator, resource);
 }
 
+uint32_t resource_version(StringId64 type)
+{
+	return find_callback(type)->version;
+}
+
+bool resource_in_place(StringId64 type)
+{
+	return find_callback(type)->in_place;
+}
+
+bool resource_cacheable(StringId64 type)
+{
+	return find_callback(type)->cacheable;
+}
+
 void resource_on_online(StringId64 type, StringId64 name, ResourceManager& rm)
 {
 	return find_callback(type)->on_online(name, rm);
@@ -20,4 +20,15 @@ void resource_on_online(StringId64 type, StringId64 name, ResourceManager& rm);
 void resource_on_offline(StringId64 type, StringId64 name, ResourceManager& rm);
 void resource_on_unload(StringId64 type, Allocator& allocator, void* resource);
 
+/// Returns the version of the compiled data of resources of the given @a type.
+uint32_t resource_version(StringId64 type);
+
+/// Returns whether resources of the given @a type are position-independent
+/// blobs that can be used straight from a memory-mapped file.
+bool resource_in_place(StringId64 type);
+
+/// Returns whether resources of the given @a type can be brought online
+/// again after going offline, so that they can be kept in memory unreferenced.
+bool resource_cacheable(StringId64 type);
+
 } // namespace crown
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#include "resource_stats.h"
+#include "resource_types.h"
+#include "array.h"
+#include "os.h"
+#include "profiler.h"
+
+namespace crown
+{
+
+#define RESOURCE_TYPE_INFO(type, ext)\
+	{\
+		type,\
+		ext,\
+		{ "resource." ext ".queue", "resource." ext ".io", "resource." ext ".load", "resource." ext ".online" },\
+		"resource." ext ".bytes"\
+	}
+
+// Names of the known resource types and of their profiler records.
+struct ResourceTypeInfo
+{
+	StringId64 type;
+	const char* name;
+	const char* stage_records[LoadStage::COUNT];
+	const char* bytes_record;
+};
+
+static const ResourceTypeInfo s_type_info[] =
+{
+	RESOURCE_TYPE_INFO(FONT_TYPE,             FONT_EXTENSION),
+	RESOURCE_TYPE_INFO(LEVEL_TYPE,            LEVEL_EXTENSION),
+	RESOURCE_TYPE_INFO(SCRIPT_TYPE,           SCRIPT_EXTENSION),
+	RESOURCE_TYPE_INFO(MATERIAL_TYPE,         MATERIAL_EXTENSION),
+	RESOURCE_TYPE_INFO(MESH_TYPE,             MESH_EXTENSION),
+	RESOURCE_TYPE_INFO(PACKAGE_TYPE,          PACKAGE_EXTENSION),
+	RESOURCE_TYPE_INFO(PHYSICS_CONFIG_TYPE,   PHYSICS_CONFIG_EXTENSION),
+	RESOURCE_TYPE_INFO(PHYSICS_TYPE,          PHYSICS_EXTENSION),
+	RESOURCE_TYPE_INFO(SHADER_TYPE,           SHADER_EXTENSION),
+	RESOURCE_TYPE_INFO(SOUND_TYPE,            SOUND_EXTENSION),
+	RESOURCE_TYPE_INFO(SPRITE_ANIMATION_TYPE, SPRITE_ANIMATION_EXTENSION),
+	RESOURCE_TYPE_INFO(SPRITE_TYPE,           SPRITE_EXTENSION),
+	RESOURCE_TYPE_INFO(TEXTURE_TYPE,          TEXTURE_EXTENSION),
+	RESOURCE_TYPE_INFO(UNIT_TYPE,             UNIT_EXTENSION),
+	RESOURCE_TYPE_INFO(StringId64(uint64_t(0)), "unknown")
+};
+
+static const uint32_t NUM_TYPE_INFO = CE_COUNTOF(s_type_info) - 1;
+
+static const char* s_stage_name[] =
+{
+	"queue",
+	"io",
+	"load",
+	"online"
+};
+
+static const ResourceTypeInfo& type_info(StringId64 type)
+{
+	uint32_t i = 0;
+	while (i < NUM_TYPE_INFO && s_type_info[i].type != type)
+		i++;
+	return s_type_info[i];
+}
+
+// Returns the histogram bucket of a sample which took @a ticks.
+static uint32_t histogram_bucket(int64_t ticks)
+{
+	int64_t us = ticks * 1000000 / os::clockfrequency();
+	uint32_t bucket = 0;
+	while (us > 1 && bucket < ResourceTypeStats::NUM_BUCKETS - 1)
+	{
+		us >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+static double to_milliseconds(int64_t ticks)
+{
+	return double(ticks) * 1000.0 / double(os::clockfrequency());
+}
+
+ResourceStats::ResourceStats()
+	: _types(default_allocator())
+{
+}
+
+void ResourceStats::add(StringId64 type, const ResourceLoadSample& sample)
+{
+	uint32_t i = 0;
+	while (i < array::size(_types) && _types[i].type != type)
+		i++;
+
+	if (i == array::size(_types))
+	{
+		ResourceTypeStats ts;
+		ts.type = type;
+		ts.count = 0;
+		ts.bytes = 0;
+		for (uint32_t s = 0; s < LoadStage::COUNT; s++)
+		{
+			ts.total_ticks[s] = 0;
+			ts.max_ticks[s] = 0;
+			for (uint32_t b = 0; b < ResourceTypeStats::NUM_BUCKETS; b++)
+				ts.histogram[s][b] = 0;
+		}
+		array::push_back(_types, ts);
+	}
+
+	ResourceTypeStats& ts = _types[i];
+	ts.count++;
+	ts.bytes += sample.bytes;
+
+	for (uint32_t s = 0; s < LoadStage::COUNT; s++)
+	{
+		const int64_t ticks = sample.ticks[s];
+		ts.total_ticks[s] += ticks;
+		ts.max_ticks[s] = ticks > ts.max_ticks[s] ? ticks : ts.max_ticks[s];
+		ts.histogram[s][histogram_bucket(ticks)]++;
+	}
+
+#if CROWN_DEBUG
+	const ResourceTypeInfo& info = type_info(type);
+	for (uint32_t s = 0; s < LoadStage::COUNT; s++)
+		RECORD_FLOAT(info.stage_records[s], float(to_milliseconds(sample.ticks[s])));
+	RECORD_FLOAT(info.bytes_record, float(sample.bytes));
+#endif // CROWN_DEBUG
+}
+
+void ResourceStats::clear()
+{
+	array::clear(_types);
+}
+
+uint32_t ResourceStats::num_types() const
+{
+	return array::size(_types);
+}
+
+const ResourceTypeStats& ResourceStats::type_stats(uint32_t i) const
+{
+	CE_ASSERT(i < array::size(_types), "Index out of bounds");
+	return _types[i];
+}
+
+void ResourceStats::to_json(StringStream& json) const
+{
+	using namespace string_stream;
+
+	json << "[";
+	for (uint32_t i = 0; i < array::size(_types); i++)
+	{
+		const ResourceTypeStats& ts = _types[i];
+
+		char buf[StringId64::STRING_LENGTH];
+		StringId64 type = ts.type;
+		const char* name = type_name(type);
+		if (name == NULL)
+			name = type.to_string(buf);
+
+		json << (i > 0 ? "," : "") << "{";
+		json << "\"type\":\"" << name << "\",";
+		json << "\"count\":" << ts.count << ",";
+		json << "\"bytes\":" << ts.bytes;
+
+		for (uint32_t s = 0; s < LoadStage::COUNT; s++)
+		{
+			json << ",\"" << s_stage_name[s] << "\":{";
+			json << "\"total_ms\":" << to_milliseconds(ts.total_ticks[s]) << ",";
+			json << "\"max_ms\":" << to_milliseconds(ts.max_ticks[s]) << ",";
+			json << "\"histogram\":[";
+			for (uint32_t b = 0; b < ResourceTypeStats::NUM_BUCKETS; b++)
+				json << (b > 0 ? "," : "") << ts.histogram[s][b];
+			json << "]}";
+		}
+
+		json << "}";
+	}
+	json << "]";
+}
+
+const char* ResourceStats::type_name(StringId64 type)
+{
+	const ResourceTypeInfo& info = type_info(type);
+	return info.type == type ? info.name : NULL;
+}
+
+} // namespace crown
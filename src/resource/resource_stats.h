@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2012-2015 Daniele Bartolini and individual contributors.
+ * License: https://github.com/taylor001/crown/blob/master/LICENSE
+ */
+
+#pragma once
+
+#include "types.h"
+#include "container_types.h"
+#include "string_stream.h"
+
+namespace crown
+{
+
+/// Enumerates the stages a resource goes through while loading.
+///
+/// @ingroup Resource
+struct LoadStage
+{
+	enum Enum
+	{
+		QUEUE,  // From load() to the start of the read
+		IO,     // Reading the file
+		LOAD,   // Decompressing and running the load callback
+		ONLINE, // From the end of LOAD until the resource is online
+
+		COUNT
+	};
+};
+
+/// Timings of a single resource load, in os::clocktime() ticks.
+///
+/// @ingroup Resource
+struct ResourceLoadSample
+{
+	int64_t enqueued; // Time load() has been called
+	int64_t loaded;   // Time the LOAD stage ended
+	int64_t ticks[LoadStage::COUNT];
+	uint32_t bytes;   // Size of the file read
+};
+
+/// Load statistics of all the resources of a type.
+///
+/// @ingroup Resource
+struct ResourceTypeStats
+{
+	/// Bucket i counts the samples which took less than 2^(i+1) microseconds,
+	/// the last one counts all the slower samples.
+	enum { NUM_BUCKETS = 24 };
+
+	StringId64 type;
+	uint32_t count;
+	uint64_t bytes;
+	int64_t total_ticks[LoadStage::COUNT];
+	int64_t max_ticks[LoadStage::COUNT];
+	uint32_t histogram[LoadStage::COUNT][NUM_BUCKETS];
+};
+
+/// Aggregates the ResourceLoadSample of the loaded resources by type.
+///
+/// @ingroup Resource
+class ResourceStats
+{
+public:
+
+	ResourceStats();
+
+	/// Adds the @a sample of a resource of the given @a type
+	/// and writes it to the profiler.
+	void add(StringId64 type, const ResourceLoadSample& sample);
+
+	/// Forgets all the samples.
+	void clear();
+
+	/// Returns the number of types with at least one sample.
+	uint32_t num_types() const;
+
+	/// Returns the statistics of the @a i-th type.
+	const ResourceTypeStats& type_stats(uint32_t i) const;
+
+	/// Writes the statistics to @a json as an array of objects, one for each type.
+	void to_json(StringStream& json) const;
+
+	/// Returns the name of the resource @a type, or NULL if it is not known.
+	static const char* type_name(StringId64 type);
+
+private:
+
+	Array<ResourceTypeStats> _types;
+};
+
+} // namespace crown
@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include "types.h"
+
 #define FONT_EXTENSION             "font"
 #define LEVEL_EXTENSION            "level"
 #define SCRIPT_EXTENSION           "lua"
@@ -39,15 +41,15 @@
 #define LEVEL_VERSION              uint32_t(1)
 #define SCRIPT_VERSION             uint32_t(1)
 #define MATERIAL_VERSION           uint32_t(1)
-#define MESH_VERSION               uint32_t(1)
-#define PACKAGE_VERSION            uint32_t(1)
+#define MESH_VERSION               uint32_t(2)
+#define PACKAGE_VERSION            uint32_t(3)
 #define PHYSICS_CONFIG_VERSION     uint32_t(1)
 #define PHYSICS_VERSION            uint32_t(1)
 #define SHADER_VERSION             uint32_t(1)
 #define SOUND_VERSION              uint32_t(1)
 #define SPRITE_ANIMATION_VERSION   uint32_t(1)
-#define SPRITE_VERSION             uint32_t(1)
-#define TEXTURE_VERSION            uint32_t(1)
+#define SPRITE_VERSION             uint32_t(2)
+#define TEXTURE_VERSION            uint32_t(2)
 #define UNIT_VERSION               uint32_t(1)
 
 namespace crown
@@ -55,6 +57,51 @@ namespace crown
 	class ResourceManager;
 	struct ResourcePackage;
 
+	/// Handle to a resource loaded by the ResourceManager.
+	/// Resolving it costs no lookup, and it stops being valid
+	/// once the resource is unloaded. A zeroed handle is never valid.
+	struct ResourceHandle
+	{
+		/// Set in every encoded handle to tell it apart from other values.
+		static const uint32_t TAG = 0x80000000u;
+		static const uint16_t MAX_GENERATION = 0x7fff;
+
+		uint16_t index;      // Slot in the resource manager
+		uint16_t generation; // Incremented each time the slot is freed
+
+		void decode(uint32_t handle)
+		{
+			generation = (handle & 0x7fff0000) >> 16;
+			index = handle & 0xffff;
+		}
+
+		uint32_t encode() const
+		{
+			return TAG | (uint32_t(generation) << 16) | uint32_t(index);
+		}
+	};
+
+	/// A resource which another resource depends on.
+	struct ResourceDependency
+	{
+		StringId64 type;
+		StringId64 name;
+	};
+
+	/// Enumerates the priorities of resource requests.
+	/// Requests with higher priority are loaded first.
+	struct ResourcePriority
+	{
+		enum Enum
+		{
+			LOW,
+			NORMAL,
+			HIGH,
+
+			COUNT
+		};
+	};
+
 	struct FontResource;
 	struct LevelResource;
 	struct LuaResource;
@@ -16,6 +16,12 @@
 #include "vector4.h"
 #include "resource_manager.h"
 #include "compile_options.h"
+#include "vertex_format.h"
+#include "sprite_atlas.h"
+#include "dynamic_string.h"
+#include "vector.h"
+#include "vector3.h"
+#include "matrix4x4.h"
 #include <cfloat>
 #include <cstring>
 #include <inttypes.h>
@@ -48,10 +54,52 @@ namespace sprite_resource
 		JSONElement root = json.root();
 
 		// Read width/height
-		const float width  = root.key("width" ).to_float();
-		const float height = root.key("height").to_float();
+		float width;
+		float height;
+		Vector2 origin = vector2(0.0f, 0.0f);
+		if (root.has_key("texture"))
+		{
+			// The regions are relative to the image inside the atlas
+			DynamicString texture_name;
+			root.key("texture").to_string(texture_name);
+			texture_name += ".texture";
+			DynamicString image_name;
+			root.key("image").to_string(image_name);
+
+			Buffer texture_buf = opts.read(texture_name.c_str());
+			JSONParser texture_json(texture_buf);
+			JSONElement texture = texture_json.root();
+
+			Array<AtlasRect> rects(default_allocator());
+			uint32_t atlas_width;
+			uint32_t atlas_height;
+			sprite_atlas::layout(texture, opts, rects, atlas_width, atlas_height);
+
+			Vector<DynamicString> images(default_allocator());
+			texture.key("atlas").to_array(images);
+
+			uint32_t image = 0;
+			while (image < vector::size(images) && !(images[image] == image_name))
+				image++;
+			CE_ASSERT(image < vector::size(images), "Image '%s' not in atlas '%s'", image_name.c_str(), texture_name.c_str());
+
+			width = float(atlas_width);
+			height = float(atlas_height);
+			origin = vector2(float(rects[image].x), float(rects[image].y));
+		}
+		else
+		{
+			width  = root.key("width" ).to_float();
+			height = root.key("height").to_float();
+		}
+
 		const uint32_t num_frames = root.key("frames").size();
 
+		const VertexFormat::Enum position_format = vertex_format::read(root, "position_format");
+		const VertexFormat::Enum texcoord_format = vertex_format::read(root, "texcoord_format");
+		CE_ASSERT(position_format != VertexFormat::OCTAHEDRAL, "Bad sprite: positions can not be octahedral");
+		CE_ASSERT(texcoord_format != VertexFormat::OCTAHEDRAL, "Bad sprite: texcoords can not be octahedral");
+
 		Array<float> vertices(default_allocator());
 		Array<uint16_t> indices(default_allocator());
 		uint32_t num_idx = 0;
@@ -65,10 +113,10 @@ namespace sprite_resource
 			const SpriteFrame& fd = frame;
 
 			// Compute uv coords
-			const float u0 = fd.region.x / width;
-			const float v0 = fd.region.y / height;
-			const float u1 = (fd.region.x + fd.region.z) / width;
-			const float v1 = (fd.region.y + fd.region.w) / height;
+			const float u0 = (origin.x + fd.region.x) / width;
+			const float v0 = (origin.y + fd.region.y) / height;
+			const float u1 = (origin.x + fd.region.x + fd.region.z) / width;
+			const float v1 = (origin.y + fd.region.y + fd.region.w) / height;
 
 			// Compute positions
 			const float w = fd.region.z / CROWN_DEFAULT_PIXELS_PER_METER;
@@ -99,13 +147,51 @@ namespace sprite_resource
 		const uint32_t num_vertices = array::size(vertices) / 4; // 4 components per vertex
 		const uint32_t num_indices = array::size(indices);
 
+		// Quantized positions are stored normalized to [-1, 1] within the bounding rectangle
+		Vector3 position_offset = VECTOR3_ZERO;
+		Vector3 position_scale = vector3(1.0f, 1.0f, 1.0f);
+		if (position_format != VertexFormat::FLOAT && num_vertices > 0)
+		{
+			Vector2 min = vector2(vertices[0], vertices[1]);
+			Vector2 max = min;
+			for (uint32_t i = 1; i < num_vertices; i++)
+			{
+				const float x = vertices[i*4 + 0];
+				const float y = vertices[i*4 + 1];
+				min.x = x < min.x ? x : min.x;
+				min.y = y < min.y ? y : min.y;
+				max.x = x > max.x ? x : max.x;
+				max.y = y > max.y ? y : max.y;
+			}
+
+			position_offset = vector3((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, 0.0f);
+			position_scale.x = max.x > min.x ? (max.x - min.x) * 0.5f : 1.0f;
+			position_scale.y = max.y > min.y ? (max.y - min.y) * 0.5f : 1.0f;
+		}
+
+		bgfx::VertexDecl decl;
+		decl.begin();
+		vertex_format::add(decl, bgfx::Attrib::Position, 2, position_format);
+		vertex_format::add(decl, bgfx::Attrib::TexCoord0, 2, texcoord_format);
+		decl.end();
+
 		// Write header
 		opts.write(SPRITE_VERSION);
+		opts.write(decl);
+		opts.write(position_offset);
+		opts.write(position_scale);
 
 		opts.write(num_vertices);
-		for (uint32_t i = 0; i < array::size(vertices); i++)
+		for (uint32_t i = 0; i < num_vertices; i++)
 		{
-			opts.write(vertices[i]);
+			const float* v = &vertices[i*4];
+			const float position[] =
+			{
+				(v[0] - position_offset.x) / position_scale.x,
+				(v[1] - position_offset.y) / position_scale.y
+			};
+			vertex_format::write(opts, position, 2, position_format);
+			vertex_format::write(opts, &v[2], 2, texcoord_format);
 		}
 
 		opts.write(num_indices);
@@ -122,10 +208,18 @@ namespace sprite_resource
 		uint32_t version;
 		br.read(version);
 
+		bgfx::VertexDecl decl;
+		br.read(decl);
+
+		Vector3 position_offset;
+		Vector3 position_scale;
+		br.read(position_offset);
+		br.read(position_scale);
+
 		uint32_t num_verts;
 		br.read(num_verts);
-		const bgfx::Memory* vbmem = bgfx::alloc(num_verts * sizeof(float) * 4);
-		br.read(vbmem->data, num_verts * sizeof(float) * 4);
+		const bgfx::Memory* vbmem = bgfx::alloc(num_verts * decl.getStride());
+		br.read(vbmem->data, num_verts * decl.getStride());
 
 		uint32_t num_inds;
 		br.read(num_inds);
@@ -133,6 +227,9 @@ namespace sprite_resource
 		br.read(ibmem->data, num_inds * sizeof(uint16_t));
 
 		SpriteResource* so = (SpriteResource*) a.allocate(sizeof(SpriteResource));
+		so->decl = decl;
+		so->position_offset = position_offset;
+		so->position_scale = position_scale;
 		so->vbmem = vbmem;
 		so->ibmem = ibmem;
 
@@ -143,13 +240,7 @@ namespace sprite_resource
 	{
 		SpriteResource* so = (SpriteResource*) rm.get(SPRITE_TYPE, id);
 
-		bgfx::VertexDecl decl;
-		decl.begin()
-			.add(bgfx::Attrib::Position, 2, bgfx::AttribType::Float)
-			.add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Float, false)
-			.end();
-
-		so->vb = bgfx::createVertexBuffer(so->vbmem, decl);
+		so->vb = bgfx::createVertexBuffer(so->vbmem, so->decl);
 		so->ib = bgfx::createIndexBuffer(so->ibmem);
 	}
 
@@ -165,6 +256,15 @@ namespace sprite_resource
 	{
 		a.deallocate(resource);
 	}
+
+	Matrix4x4 position_transform(const SpriteResource* sr)
+	{
+		return matrix4x4(vector3(sr->position_scale.x, 0.0f, 0.0f)
+			, vector3(0.0f, sr->position_scale.y, 0.0f)
+			, vector3(0.0f, 0.0f, sr->position_scale.z)
+			, sr->position_offset
+			);
+	}
 } // namespace sprite_resource
 
 namespace sprite_animation_resource
@@ -10,12 +10,16 @@
 #include "resource_types.h"
 #include "filesystem_types.h"
 #include "compiler_types.h"
+#include "math_types.h"
 #include <bgfx.h>
 
 namespace crown
 {
 
 // header
+// decl
+// position_offset
+// position_scale
 // num_verts
 // verts[num_verts]
 // num_inds
@@ -24,6 +28,9 @@ namespace crown
 struct SpriteResource
 {
 	uint32_t version;
+	bgfx::VertexDecl decl;
+	Vector3 position_offset; // Quantized positions are position_offset + position * position_scale
+	Vector3 position_scale;
 	const bgfx::Memory* vbmem;
 	const bgfx::Memory* ibmem;
 	bgfx::VertexBufferHandle vb;
@@ -37,6 +44,11 @@ namespace sprite_resource
 	void online(StringId64 id, ResourceManager& rm);
 	void offline(StringId64 id, ResourceManager& rm);
 	void unload(Allocator& a, void* resource);
+
+	/// Returns the matrix which transforms the positions stored in the
+	/// vertex buffer of @a sr to the sprite space.
+	/// It is the identity unless the positions are quantized.
+	Matrix4x4 position_transform(const SpriteResource* sr);
 } // namespace sprite_resource
 
 struct SpriteAnimationResource
@@ -11,6 +11,14 @@
 #include "resource_manager.h"
 #include "log.h"
 #include "compile_options.h"
+#include "memory_file.h"
+#include "array.h"
+#include "mip_generator.h"
+#include "dxt_encoder.h"
+#include "sprite_atlas.h"
+#include "vector.h"
+#include "config.h"
+#include <string.h> // memset
 
 namespace crown
 {
@@ -150,6 +158,16 @@ namespace pixel_format
 		return fmt < PixelFormat::R8G8B8;
 	}
 
+	/// Returns the size in bytes of an image of @a width x @a height pixels.
+	/// Compressed formats are made of blocks of 4x4 pixels.
+	inline uint32_t image_size(PixelFormat::Enum fmt, uint32_t width, uint32_t height)
+	{
+		if (is_compressed(fmt))
+			return ((width + 3) / 4) * ((height + 3) / 4) * size(fmt);
+
+		return width * height * size(fmt);
+	}
+
 	inline bool is_color(PixelFormat::Enum fmt)
 	{
 		return fmt >= PixelFormat::R8G8B8 && fmt < PixelFormat::D16;
@@ -192,7 +210,7 @@ namespace texture_resource
 
 		while (1)
 		{
-			const uint32_t size = width * height * pixel_format::size(image.format);
+			const uint32_t size = pixel_format::image_size(image.format, width, height);
 
 			if (cur_mip == mip)
 			{
@@ -274,12 +292,7 @@ namespace texture_resource
 			{
 				rle_id -= 127;
 
-				br.read(colors[0]);
-				br.read(colors[1]);
-				br.read(colors[2]);
-
-				if (channels == 4)
-					br.read(colors[3]);
+				br.read(colors, channels == 4 ? 4 : 3);
 
 				while (rle_id)
 				{
@@ -301,12 +314,7 @@ namespace texture_resource
 
 				while (rle_id)
 				{
-					br.read(colors[0]);
-					br.read(colors[1]);
-					br.read(colors[2]);
-
-					if (channels == 4)
-						br.read(colors[3]);
+					br.read(colors, channels == 4 ? 4 : 3);
 
 					image.data[colors_read + 0] = colors[2];
 					image.data[colors_read + 1] = colors[1];
@@ -321,8 +329,6 @@ namespace texture_resource
 				}
 			}
 		}
-
-		swap_red_blue(width, height, channels, image.data);
 	}
 
 	void parse_tga(BinaryReader& br, ImageData& image)
@@ -507,7 +513,7 @@ namespace texture_resource
 		bw.write(image.height); // dwHeight
 		bw.write(image.width); // dwWidth
 
-		const uint32_t pitch = pixel_format::is_compressed(image.format) ? 0 // fixme
+		const uint32_t pitch = pixel_format::is_compressed(image.format) ? pixel_format::image_size(image.format, image.width, image.height)
 								: (image.width * pixel_format::size(image.format) * 8 + 7) / 8;
 
 		bw.write(pitch); // dwPitchOrLinearSize
@@ -556,18 +562,114 @@ namespace texture_resource
 		}
 	}
 
-	void compile(const char* path, CompileOptions& opts)
+	MipFilter::Enum read_mip_filter(JSONElement root)
 	{
-		Buffer buf = opts.read(path);
-		JSONParser json(buf);
-		JSONElement root = json.root();
+		if (!root.has_key("mip_filter"))
+			return MipFilter::BOX;
 
 		DynamicString name;
-		root.key("source").to_string(name);
+		root.key("mip_filter").to_string(name);
 
-		File* source = opts._fs.open(name.c_str(), FOM_READ);
-		BinaryReader br(*source);
-		ImageData image;
+		if (name == "box")
+			return MipFilter::BOX;
+		if (name == "kaiser")
+			return MipFilter::KAISER;
+
+		CE_ASSERT(false, "Unknown mip filter '%s'", name.c_str());
+		return MipFilter::BOX;
+	}
+
+	PixelFormat::Enum read_format(JSONElement root, PixelFormat::Enum source)
+	{
+		if (!root.has_key("format"))
+			return source;
+
+		DynamicString name;
+		root.key("format").to_string(name);
+
+		if (name == "uncompressed")
+			return source;
+		if (name == "dxt1")
+			return PixelFormat::DXT1;
+		if (name == "dxt5")
+			return PixelFormat::DXT5;
+
+		CE_ASSERT(false, "Unknown texture format '%s'", name.c_str());
+		return source;
+	}
+
+	/// Replaces the pixels of @a image with the full mip chain if @a mips
+	/// and converts them to @a format. Mips are filtered in linear space
+	/// if the colors of @a image are @a srgb.
+	/// @a image must not be compressed, its blocks can not be filtered.
+	void convert_image(ImageData& image, bool mips, MipFilter::Enum filter, bool srgb, PixelFormat::Enum format)
+	{
+		CE_ASSERT(!pixel_format::is_compressed(image.format), "Compressed images do not support 'generate_mips' nor 'format', use an uncompressed source");
+
+		const uint32_t channels = pixel_format::size(image.format);
+		const uint32_t num_mips = mips ? mip_generator::num_mips(image.width, image.height) : 1;
+
+		uint32_t size = 0;
+		for (uint32_t i = 0, w = image.width, h = image.height; i < num_mips; i++, w = max(1u, w >> 1), h = max(1u, h >> 1))
+			size += pixel_format::image_size(format, w, h);
+
+		char* data = (char*) default_allocator().allocate(size);
+		char* dst = data;
+
+		Array<float> a(default_allocator());
+		Array<float> b(default_allocator());
+		Array<uint8_t> rgba(default_allocator());
+		Array<float>* cur = &a;
+		Array<float>* next = &b;
+
+		uint32_t width = image.width;
+		uint32_t height = image.height;
+		array::resize(*cur, width * height * 4);
+		mip_generator::to_float((const uint8_t*) image.data, width * height, channels, srgb, array::begin(*cur));
+
+		for (uint32_t i = 0; i < num_mips; i++)
+		{
+			// Each mip is filtered from the previous one
+			if (i > 0)
+			{
+				const uint32_t w = max(1u, width >> 1);
+				const uint32_t h = max(1u, height >> 1);
+				array::resize(*next, w * h * 4);
+				mip_generator::resize(array::begin(*cur), width, height, array::begin(*next), w, h, filter);
+
+				Array<float>* tmp = cur;
+				cur = next;
+				next = tmp;
+				width = w;
+				height = h;
+			}
+
+			if (pixel_format::is_compressed(format))
+			{
+				array::resize(rgba, width * height * 4);
+				mip_generator::to_uint8(array::begin(*cur), width * height, 4, srgb, array::begin(rgba));
+				dxt_encoder::encode(array::begin(rgba), width, height, format == PixelFormat::DXT5, (uint8_t*) dst);
+			}
+			else
+			{
+				mip_generator::to_uint8(array::begin(*cur), width * height, channels, srgb, (uint8_t*) dst);
+			}
+
+			dst += pixel_format::image_size(format, width, height);
+		}
+
+		default_allocator().deallocate(image.data);
+		image.format = format;
+		image.num_mips = num_mips;
+		image.data = data;
+	}
+
+	void read_image(const DynamicString& name, CompileOptions& opts, ImageData& image)
+	{
+		// Parse from memory, the readers do lots of tiny reads
+		Buffer src = opts.read(name.c_str());
+		MemoryFile source(array::begin(src), array::size(src));
+		BinaryReader br(source);
 
 		if (name.ends_with(".tga"))
 		{
@@ -589,8 +691,82 @@ namespace texture_resource
 		{
 			CE_FATAL("Source image not supported");
 		}
+	}
+
+	/// Packs the images listed in the "atlas" key of @a root into @a image, see sprite_atlas.
+	/// The padding around each image repeats its edges to avoid bleeding when filtering.
+	void compose_atlas(JSONElement root, CompileOptions& opts, ImageData& image)
+	{
+		Array<AtlasRect> rects(default_allocator());
+		uint32_t width;
+		uint32_t height;
+		sprite_atlas::layout(root, opts, rects, width, height);
+
+		Vector<DynamicString> names(default_allocator());
+		root.key("atlas").to_array(names);
+		const int32_t padding = root.key_or_nil("padding").to_int(CROWN_DEFAULT_ATLAS_PADDING);
+
+		image.width = width;
+		image.height = height;
+		image.pitch = 0;
+		image.format = PixelFormat::R8G8B8A8;
+		image.num_mips = 1;
+		image.data = (char*) default_allocator().allocate(width * height * 4);
+		memset(image.data, 0, width * height * 4);
+
+		for (uint32_t i = 0; i < vector::size(names); i++)
+		{
+			ImageData src;
+			read_image(names[i], opts, src);
+
+			const AtlasRect& r = rects[i];
+			const uint32_t channels = pixel_format::size(src.format);
+
+			for (int32_t y = -padding; y < int32_t(r.height) + padding; y++)
+			{
+				const uint32_t sy = uint32_t(clamp(0, int32_t(r.height) - 1, y));
+				for (int32_t x = -padding; x < int32_t(r.width) + padding; x++)
+				{
+					const uint32_t sx = uint32_t(clamp(0, int32_t(r.width) - 1, x));
+					const char* s = &src.data[(sy * src.width + sx) * channels];
+					char* d = &image.data[(uint32_t(int32_t(r.y) + y) * width + uint32_t(int32_t(r.x) + x)) * 4];
+					d[0] = s[0];
+					d[1] = s[1];
+					d[2] = s[2];
+					d[3] = channels == 4 ? s[3] : char(255);
+				}
+			}
+
+			default_allocator().deallocate(src.data);
+		}
+	}
+
+	void compile(const char* path, CompileOptions& opts)
+	{
+		Buffer buf = opts.read(path);
+		JSONParser json(buf);
+		JSONElement root = json.root();
+
+		ImageData image;
+		if (root.has_key("atlas"))
+		{
+			compose_atlas(root, opts, image);
+		}
+		else
+		{
+			DynamicString name;
+			root.key("source").to_string(name);
+			read_image(name, opts, image);
+		}
+
+		// Optional processing, the source image is written as is by default
+		const bool mips = root.key_or_nil("generate_mips").to_bool(false);
+		const MipFilter::Enum filter = read_mip_filter(root);
+		const bool srgb = root.key_or_nil("srgb").to_bool(true);
+		const PixelFormat::Enum format = read_format(root, image.format);
 
-		opts._fs.close(source);
+		if (mips || format != image.format)
+			convert_image(image, mips, filter, srgb, format);
 
 		// Write DDS
 		opts.write(TEXTURE_VERSION); // Version
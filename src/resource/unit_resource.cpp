@@ -267,7 +267,7 @@ namespace unit_resource
 		unit_name.strip_trailing(".unit");
 		DynamicString physics_name = unit_name;
 		physics_name += ".physics";
-		if (opts._fs.exists(physics_name.c_str()))
+		if (opts.exists(physics_name.c_str()))
 		{
 			m_physics_resource = ResourceId(unit_name.c_str());
 		}
@@ -280,6 +280,16 @@ namespace unit_resource
 		if (root.has_key("sprite_animation"))
 			sprite_anim = root.key("sprite_animation").to_resource_id();
 
+		opts.add_dependency(PHYSICS_TYPE, m_physics_resource);
+		opts.add_dependency(SPRITE_ANIMATION_TYPE, sprite_anim);
+		for (uint32_t i = 0; i < array::size(m_renderables); i++)
+		{
+			const StringId64 type = m_renderables[i].type == UnitRenderable::MESH ? MESH_TYPE : SPRITE_TYPE;
+			opts.add_dependency(type, m_renderables[i].resource);
+		}
+		for (uint32_t i = 0; i < array::size(m_materials); i++)
+			opts.add_dependency(MATERIAL_TYPE, m_materials[i].id);
+
 		UnitResource ur;
 		ur.version = UNIT_VERSION;
 		ur.name = StringId64(unit_name.c_str());
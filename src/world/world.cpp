@@ -73,6 +73,12 @@ UnitId World::spawn_unit(StringId64 name, const Vector3& pos, const Quaternion&
 	return spawn_unit(ur, pos, rot);
 }
 
+UnitId World::spawn_unit(ResourceHandle unit, const Vector3& pos, const Quaternion& rot)
+{
+	const UnitResource* ur = (const UnitResource*)_resource_manager->get(UNIT_TYPE, unit);
+	return spawn_unit(ur, pos, rot);
+}
+
 void World::destroy_unit(UnitId id)
 {
 	CE_DELETE(m_unit_pool, id_array::get(m_units, id));
@@ -184,6 +190,12 @@ SoundInstanceId World::play_sound(StringId64 name, const bool loop, const float
 	return play_sound(sr, loop, volume, pos, range);
 }
 
+SoundInstanceId World::play_sound(ResourceHandle sound, const bool loop, const float volume, const Vector3& pos, const float range)
+{
+	const SoundResource* sr = (const SoundResource*)_resource_manager->get(SOUND_TYPE, sound);
+	return play_sound(sr, loop, volume, pos, range);
+}
+
 void World::stop_sound(SoundInstanceId id)
 {
 	_sound_world->stop(id);
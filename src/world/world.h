@@ -42,6 +42,7 @@ public:
 	/// Spawns a new instance of the unit @a name at the given @a position and @a rotation.
 	UnitId spawn_unit(const UnitResource* ur, const Vector3& position = VECTOR3_ZERO, const Quaternion& rotation = QUATERNION_IDENTITY);
 	UnitId spawn_unit(StringId64 name, const Vector3& pos, const Quaternion& rot);
+	UnitId spawn_unit(ResourceHandle unit, const Vector3& pos, const Quaternion& rot);
 
 	/// Destroys the unit with the given @a id.
 	void destroy_unit(UnitId id);
@@ -89,6 +90,7 @@ public:
 	/// @a volume and @a range. @a loop controls whether the sound must loop or not.
 	SoundInstanceId play_sound(const SoundResource* sr, bool loop = false, float volume = 1.0f, const Vector3& position = VECTOR3_ZERO, float range = 50.0f);
 	SoundInstanceId play_sound(StringId64 name, const bool loop, const float volume, const Vector3& pos, const float range);
+	SoundInstanceId play_sound(ResourceHandle sound, const bool loop, const float volume, const Vector3& pos, const float range);
 
 	/// Stops the sound with the given @a id.
 	void stop_sound(SoundInstanceId id);